@@ -0,0 +1,218 @@
+#include "./async_file_writer.h"
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#if _WIN32
+#include <malloc.h>
+#endif
+
+static uint8_t* allocate_aligned(size_t alignment, size_t size) {
+#if _WIN32
+    return reinterpret_cast<uint8_t*>(_aligned_malloc(size, alignment));
+#else
+    return reinterpret_cast<uint8_t*>(aligned_alloc(alignment, size));
+#endif
+}
+
+static void free_aligned(uint8_t* data) {
+#if _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+Async_File::Async_File(Async_File_Writer& writer, std::string_view filepath, size_t worker_index, FILE* file)
+: m_writer(writer), m_filepath(filepath), m_worker_index(worker_index), m_file(file),
+  m_block(nullptr), m_block_length(0),
+  m_total_bytes_submitted(0), m_total_bytes_written(0), m_total_bytes_dropped(0),
+  m_total_write_ns(0), m_is_error(false)
+{}
+
+Async_File::~Async_File() {
+    if (m_block != nullptr) {
+        m_writer.release_block(m_block);
+        m_block = nullptr;
+    }
+    if (m_file != nullptr) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool Async_File::write(tcb::span<const uint8_t> data) {
+    const size_t block_size = m_writer.get_block_size();
+    size_t offset = 0;
+    while (offset < data.size()) {
+        if (m_block == nullptr) {
+            m_block = m_writer.acquire_block();
+            m_block_length = 0;
+            if (m_block == nullptr) {
+                m_total_bytes_dropped += data.size()-offset;
+                return false;
+            }
+        }
+        const size_t length = std::min(data.size()-offset, block_size-m_block_length);
+        memcpy(m_block + m_block_length, data.data() + offset, length);
+        m_block_length += length;
+        offset += length;
+        if (m_block_length == block_size) {
+            flush();
+        }
+    }
+    return true;
+}
+
+void Async_File::write_at(uint64_t offset, tcb::span<const uint8_t> data) {
+    flush();
+    Async_File_Writer::Job job;
+    job.file = shared_from_this();
+    job.is_patch = true;
+    job.patch_offset = offset;
+    job.patch_data.assign(data.begin(), data.end());
+    m_writer.push_job(m_worker_index, std::move(job));
+}
+
+void Async_File::flush() {
+    if (m_block == nullptr) return;
+    if (m_block_length == 0) return;
+    Async_File_Writer::Job job;
+    job.file = shared_from_this();
+    job.block = m_block;
+    job.length = m_block_length;
+    m_total_bytes_submitted += m_block_length;
+    m_block = nullptr;
+    m_block_length = 0;
+    m_writer.push_job(m_worker_index, std::move(job));
+}
+
+double Async_File::get_write_throughput() const {
+    const uint64_t total_ns = m_total_write_ns;
+    if (total_ns == 0) return 0.0;
+    return double(m_total_bytes_written) / (double(total_ns)*1e-9);
+}
+
+Async_File_Writer::Async_File_Writer(size_t block_size, size_t total_blocks, size_t total_threads)
+: m_block_size((block_size + BLOCK_ALIGNMENT-1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT),
+  m_total_blocks(total_blocks),
+  m_next_worker(0),
+  m_is_running(true)
+{
+    for (size_t i = 0; i < m_total_blocks; i++) {
+        auto* block = allocate_aligned(BLOCK_ALIGNMENT, m_block_size);
+        if (block == nullptr) break;
+        m_all_blocks.push_back(block);
+        m_free_blocks.push_back(block);
+    }
+    total_threads = std::max(total_threads, size_t(1));
+    for (size_t i = 0; i < total_threads; i++) {
+        auto worker = std::make_unique<Worker>();
+        auto* worker_ptr = worker.get();
+        worker->thread = std::make_unique<std::thread>([this, worker_ptr]() {
+            run_worker(*worker_ptr);
+        });
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+Async_File_Writer::~Async_File_Writer() {
+    for (auto& worker: m_workers) {
+        auto lock = std::unique_lock(worker->mutex);
+        m_is_running = false;
+        worker->cv.notify_one();
+    }
+    for (auto& worker: m_workers) {
+        worker->thread->join();
+    }
+    m_workers.clear();
+    for (auto* block: m_all_blocks) {
+        free_aligned(block);
+    }
+}
+
+std::shared_ptr<Async_File> Async_File_Writer::open(const std::string& filepath) {
+    FILE* file = fopen(filepath.c_str(), "wb+");
+    if (file == nullptr) return nullptr;
+    // NOTE: We write in large blocks so stdio buffering only adds another copy
+    setvbuf(file, nullptr, _IONBF, 0);
+    const size_t worker_index = m_next_worker++ % m_workers.size();
+    return std::make_shared<Async_File>(*this, filepath, worker_index, file);
+}
+
+void Async_File_Writer::close(std::shared_ptr<Async_File> file) {
+    if (file == nullptr) return;
+    file->flush();
+    Job job;
+    job.file = file;
+    job.is_close = true;
+    push_job(file->m_worker_index, std::move(job));
+}
+
+size_t Async_File_Writer::get_total_free_blocks() {
+    auto lock = std::unique_lock(m_mutex_blocks);
+    return m_free_blocks.size();
+}
+
+uint8_t* Async_File_Writer::acquire_block() {
+    auto lock = std::unique_lock(m_mutex_blocks);
+    if (m_free_blocks.empty()) return nullptr;
+    auto* block = m_free_blocks.back();
+    m_free_blocks.pop_back();
+    return block;
+}
+
+void Async_File_Writer::release_block(uint8_t* block) {
+    auto lock = std::unique_lock(m_mutex_blocks);
+    m_free_blocks.push_back(block);
+}
+
+void Async_File_Writer::push_job(size_t worker_index, Job job) {
+    auto& worker = *m_workers[worker_index];
+    auto lock = std::unique_lock(worker.mutex);
+    worker.jobs.push_back(std::move(job));
+    worker.cv.notify_one();
+}
+
+void Async_File_Writer::run_worker(Worker& worker) {
+    while (true) {
+        auto lock = std::unique_lock(worker.mutex);
+        worker.cv.wait(lock, [this, &worker]() { return !worker.jobs.empty() || !m_is_running; });
+        // NOTE: Finish all pending writes before shutting down
+        if (worker.jobs.empty()) return;
+        auto job = std::move(worker.jobs.front());
+        worker.jobs.pop_front();
+        lock.unlock();
+
+        auto& file = *job.file;
+        if (job.is_close) {
+            if (file.m_file != nullptr) {
+                fclose(file.m_file);
+                file.m_file = nullptr;
+            }
+            continue;
+        }
+        if (file.m_file == nullptr) {
+            if (job.block != nullptr) release_block(job.block);
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (job.is_patch) {
+            // NOTE: Patches are only used for headers near the start of the file
+            //       Writes are append only so we can return to the end afterwards
+            bool is_success = (fseek(file.m_file, long(job.patch_offset), SEEK_SET) == 0);
+            is_success = is_success && (fwrite(job.patch_data.data(), 1, job.patch_data.size(), file.m_file) == job.patch_data.size());
+            is_success = is_success && (fseek(file.m_file, 0, SEEK_END) == 0);
+            if (!is_success) file.m_is_error = true;
+        } else {
+            const size_t total_written = fwrite(job.block, 1, job.length, file.m_file);
+            if (total_written != job.length) file.m_is_error = true;
+            file.m_total_bytes_written += total_written;
+            release_block(job.block);
+        }
+        const auto dt = std::chrono::steady_clock::now() - start;
+        file.m_total_write_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count());
+    }
+}
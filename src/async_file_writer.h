@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+
+class Async_File_Writer;
+
+// Append only file that is written to by a pool of writer threads
+// - The producer copies data into large aligned blocks and never waits on disk
+// - If all blocks are in use the data is dropped and counted
+class Async_File: public std::enable_shared_from_this<Async_File>
+{
+private:
+    friend class Async_File_Writer;
+    Async_File_Writer& m_writer;
+    const std::string m_filepath;
+    const size_t m_worker_index;
+    FILE* m_file;
+    uint8_t* m_block;
+    size_t m_block_length;
+    std::atomic<uint64_t> m_total_bytes_submitted;
+    std::atomic<uint64_t> m_total_bytes_written;
+    std::atomic<uint64_t> m_total_bytes_dropped;
+    std::atomic<uint64_t> m_total_write_ns;
+    std::atomic<bool> m_is_error;
+public:
+    Async_File(Async_File_Writer& writer, std::string_view filepath, size_t worker_index, FILE* file);
+    ~Async_File();
+    Async_File(const Async_File&) = delete;
+    Async_File& operator=(const Async_File&) = delete;
+    // producer side
+    bool write(tcb::span<const uint8_t> data);
+    // overwrite bytes at an absolute offset after all previously submitted data is written
+    // this is used to patch headers with their final sizes
+    void write_at(uint64_t offset, tcb::span<const uint8_t> data);
+    // submit the partially filled block
+    void flush();
+    std::string_view get_filepath() const { return m_filepath; }
+    uint64_t get_total_bytes_submitted() const { return m_total_bytes_submitted; }
+    uint64_t get_total_bytes_written() const { return m_total_bytes_written; }
+    uint64_t get_total_bytes_dropped() const { return m_total_bytes_dropped; }
+    // average disk throughput while writing in bytes per second
+    double get_write_throughput() const;
+    bool is_error() const { return m_is_error; }
+};
+
+class Async_File_Writer
+{
+private:
+    friend class Async_File;
+    struct Job {
+        std::shared_ptr<Async_File> file;
+        uint8_t* block = nullptr;
+        size_t length = 0;
+        bool is_patch = false;
+        uint64_t patch_offset = 0;
+        std::vector<uint8_t> patch_data;
+        bool is_close = false;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Job> jobs;
+        std::unique_ptr<std::thread> thread;
+    };
+    const size_t m_block_size;
+    const size_t m_total_blocks;
+    std::mutex m_mutex_blocks;
+    std::vector<uint8_t*> m_free_blocks;
+    std::vector<uint8_t*> m_all_blocks;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_next_worker;
+    bool m_is_running;
+public:
+    static constexpr size_t BLOCK_ALIGNMENT = 4096;
+    Async_File_Writer(size_t block_size, size_t total_blocks, size_t total_threads);
+    ~Async_File_Writer();
+    Async_File_Writer(const Async_File_Writer&) = delete;
+    Async_File_Writer& operator=(const Async_File_Writer&) = delete;
+    // returns nullptr if the file could not be opened
+    std::shared_ptr<Async_File> open(const std::string& filepath);
+    // flushes the remaining data and closes the file once all its jobs are done
+    void close(std::shared_ptr<Async_File> file);
+    size_t get_block_size() const { return m_block_size; }
+    size_t get_total_blocks() const { return m_total_blocks; }
+    size_t get_total_free_blocks();
+private:
+    uint8_t* acquire_block();
+    void release_block(uint8_t* block);
+    void push_job(size_t worker_index, Job job);
+    void run_worker(Worker& worker);
+};
+
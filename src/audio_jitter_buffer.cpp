@@ -0,0 +1,100 @@
+#include "./audio_jitter_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include "./audio_resampler.h"
+
+// NOTE: The fill level has a sawtooth from the bursty input so it is averaged over several superframes
+constexpr float FILL_AVERAGE_SECONDS = 5.0f;
+// ratio trim per second of latency error, 100ms too much latency is trimmed at 500ppm
+constexpr double DRIFT_PROPORTIONAL_GAIN = 5e-3;
+constexpr double DRIFT_INTEGRAL_GAIN = DRIFT_PROPORTIONAL_GAIN / 30.0;
+// sound cards and transmitters are well within this
+constexpr double MAX_DRIFT = 1000e-6;
+constexpr double MAX_RATE_ADJUSTMENT = 2000e-6;
+// audio past this much extra latency is skipped instead of being slowly trimmed
+constexpr float MIN_OVERRUN_MARGIN_SECONDS = 0.5f;
+
+Audio_Jitter_Buffer::Audio_Jitter_Buffer(float input_rate, float output_rate, float target_latency_seconds)
+: m_input_rate(input_rate), m_target_latency_seconds(target_latency_seconds),
+  m_is_buffering(true), m_is_fill_average_init(false), m_fill_average_seconds(0.0f), m_drift_integral(0.0),
+  m_fill_seconds(0.0f), m_drift_ppm(0.0f), m_rate_adjustment_ppm(0.0f),
+  m_total_underruns(0), m_total_overruns(0), m_is_playing(false)
+{
+    m_resampler = std::make_unique<Audio_Resampler>(m_input_rate, output_rate);
+}
+
+Audio_Jitter_Buffer::~Audio_Jitter_Buffer() = default;
+
+void Audio_Jitter_Buffer::set_output_rate(float output_rate) {
+    if (m_resampler->get_output_rate() == output_rate) return;
+    m_resampler = std::make_unique<Audio_Resampler>(m_input_rate, output_rate);
+    m_resampler->set_rate_adjustment(1.0 + m_drift_integral);
+    m_is_buffering = true;
+    m_is_playing = false;
+    m_is_fill_average_init = false;
+}
+
+size_t Audio_Jitter_Buffer::get_max_fill_frames() const {
+    const float target = m_target_latency_seconds;
+    const float max_fill_seconds = target + std::max(target*2.0f, MIN_OVERRUN_MARGIN_SECONDS);
+    return size_t(max_fill_seconds*m_input_rate);
+}
+
+size_t Audio_Jitter_Buffer::get_total_free() const {
+    const size_t max_fill = get_max_fill_frames();
+    const size_t total_buffered = m_resampler->get_total_buffered();
+    return (max_fill > total_buffered) ? (max_fill - total_buffered) : 0;
+}
+
+void Audio_Jitter_Buffer::write(tcb::span<const Frame<float>> input) {
+    if (input.empty()) return;
+    m_resampler->process(input, {});
+    const size_t total_buffered = m_resampler->get_total_buffered();
+    if (total_buffered > get_max_fill_frames()) {
+        // the sink stalled or the pipeline caught up on a backlog so jump back to the target
+        const size_t target_frames = size_t(m_target_latency_seconds*m_input_rate);
+        m_resampler->discard(total_buffered - target_frames);
+        m_total_overruns++;
+        m_is_fill_average_init = false;
+    }
+    m_fill_seconds = float(m_resampler->get_total_buffered()) / m_input_rate;
+}
+
+size_t Audio_Jitter_Buffer::read(tcb::span<Frame<float>> output) {
+    const float fill_seconds = float(m_resampler->get_total_buffered()) / m_input_rate;
+    m_fill_seconds = fill_seconds;
+    if (m_is_buffering) {
+        if (fill_seconds < m_target_latency_seconds) return 0;
+        m_is_buffering = false;
+        m_is_playing = true;
+    }
+
+    const float elapsed_seconds = float(output.size()) / m_resampler->get_output_rate();
+    update_drift_control(fill_seconds, elapsed_seconds);
+    const size_t total_read = m_resampler->process({}, output);
+    if (total_read < output.size()) {
+        m_total_underruns++;
+        m_is_buffering = true;
+        m_is_playing = false;
+        m_is_fill_average_init = false;
+    }
+    m_fill_seconds = float(m_resampler->get_total_buffered()) / m_input_rate;
+    return total_read;
+}
+
+void Audio_Jitter_Buffer::update_drift_control(float fill_seconds, float elapsed_seconds) {
+    if (!m_is_fill_average_init) {
+        m_fill_average_seconds = fill_seconds;
+        m_is_fill_average_init = true;
+    } else {
+        const float alpha = elapsed_seconds / (FILL_AVERAGE_SECONDS + elapsed_seconds);
+        m_fill_average_seconds += alpha*(fill_seconds - m_fill_average_seconds);
+    }
+    // consume faster when there is too much latency and slower when there is too little
+    const double error = double(m_fill_average_seconds - m_target_latency_seconds);
+    m_drift_integral = std::clamp(m_drift_integral + DRIFT_INTEGRAL_GAIN*error*double(elapsed_seconds), -MAX_DRIFT, MAX_DRIFT);
+    const double adjustment = std::clamp(DRIFT_PROPORTIONAL_GAIN*error + m_drift_integral, -MAX_RATE_ADJUSTMENT, MAX_RATE_ADJUSTMENT);
+    m_resampler->set_rate_adjustment(1.0 + adjustment);
+    m_drift_ppm = float(m_drift_integral*1e6);
+    m_rate_adjustment_ppm = float(adjustment*1e6);
+}
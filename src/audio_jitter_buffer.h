@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include "audio/audio_pipeline.h"
+#include "utility/span.h"
+
+class Audio_Resampler;
+
+// Holds audio between the pipeline and the sink at a target latency
+// - Dab+ audio arrives in bursts of whole superframes while the sink reads it at the sound card's clock
+// - The smoothed fill level drives a PI loop that trims the resampling ratio by up to a few hundred ppm
+//   so the drift between the transmitter and sound card clocks never builds up into an under or overrun
+// - The integral term converges on the clock drift so it is reported as the drift estimate
+// - Playback only starts once the target has been buffered so an underrun costs one gap instead of many clicks
+// NOTE: Only the statistics can be used outside of the output thread
+class Audio_Jitter_Buffer
+{
+private:
+    const float m_input_rate;
+    std::unique_ptr<Audio_Resampler> m_resampler;
+    float m_target_latency_seconds;
+    bool m_is_buffering;
+    bool m_is_fill_average_init;
+    float m_fill_average_seconds;
+    double m_drift_integral;
+    // statistics
+    std::atomic<float> m_fill_seconds;
+    std::atomic<float> m_drift_ppm;
+    std::atomic<float> m_rate_adjustment_ppm;
+    std::atomic<size_t> m_total_underruns;
+    std::atomic<size_t> m_total_overruns;
+    std::atomic<bool> m_is_playing;
+public:
+    Audio_Jitter_Buffer(float input_rate, float output_rate, float target_latency_seconds);
+    ~Audio_Jitter_Buffer();
+    Audio_Jitter_Buffer(const Audio_Jitter_Buffer&) = delete;
+    Audio_Jitter_Buffer& operator=(const Audio_Jitter_Buffer&) = delete;
+    // NOTE: Changing the output rate drops the buffered audio
+    void set_output_rate(float output_rate);
+    // space left before the buffer is considered overrun
+    size_t get_total_free() const;
+    void write(tcb::span<const Frame<float>> input);
+    // returns the number of frames written which is zero while buffering up to the target latency
+    size_t read(tcb::span<Frame<float>> output);
+    void set_target_latency_seconds(float target_latency_seconds) { m_target_latency_seconds = target_latency_seconds; }
+    // statistics
+    float get_fill_seconds() const { return m_fill_seconds; }
+    float get_drift_ppm() const { return m_drift_ppm; }
+    float get_rate_adjustment_ppm() const { return m_rate_adjustment_ppm; }
+    size_t get_total_underruns() const { return m_total_underruns; }
+    size_t get_total_overruns() const { return m_total_overruns; }
+    bool get_is_playing() const { return m_is_playing; }
+private:
+    size_t get_max_fill_frames() const;
+    void update_drift_control(float fill_seconds, float elapsed_seconds);
+};
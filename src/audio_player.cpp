@@ -0,0 +1,149 @@
+#include "./audio_player.h"
+#include <algorithm>
+#include <chrono>
+#include "./audio_jitter_buffer.h"
+#include "./pipeline_telemetry.h"
+
+// NOTE: Only a fallback in case a source forgets to notify the data signal
+constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(500);
+
+Audio_Player_Tap::Audio_Player_Tap(Audio_Player_Stream& player)
+: m_player(player), m_callback(nullptr)
+{
+    m_player.attach_tap(this);
+}
+
+Audio_Player_Tap::~Audio_Player_Tap() {
+    m_player.detach_tap(this);
+}
+
+void Audio_Player_Tap::set_callback(AudioPipelineSink::Callback callback) {
+    auto lock = std::unique_lock(m_mutex_callback);
+    m_callback = callback;
+}
+
+size_t Audio_Player_Tap::read(tcb::span<Frame<float>> buf, float sample_rate) {
+    auto lock = std::unique_lock(m_mutex_callback);
+    if (m_callback == nullptr) return 0;
+    return m_callback(buf, sample_rate);
+}
+
+Audio_Player_Stream::Audio_Player_Stream(float sample_rate, float block_size_seconds)
+: m_sample_rate(sample_rate), m_block_size_seconds(block_size_seconds)
+{
+    m_is_running = false;
+    m_callback = nullptr;
+    m_output_thread = nullptr;
+    m_data_signal = std::make_shared<Event_Signal>();
+    m_target_latency_seconds = PROFILES[0].target_latency_seconds;
+    m_jitter_buffer = std::make_unique<Audio_Jitter_Buffer>(PIPELINE_SAMPLE_RATE, sample_rate, m_target_latency_seconds);
+    set_block_size_seconds(block_size_seconds);
+    m_output_stream.clearReadStop();
+    m_output_stream.clearWriteStop();
+}
+
+Audio_Player_Stream::~Audio_Player_Stream() {
+    m_output_stream.stopReader();
+    m_output_stream.stopWriter();
+    auto lock = std::unique_lock(m_mutex_callback);
+    stop_output_thread();
+};
+
+void Audio_Player_Stream::set_block_size_seconds(float block_size_seconds) {
+    m_block_size_seconds = std::clamp(block_size_seconds, MIN_BLOCK_SIZE_SECONDS, MAX_BLOCK_SIZE_SECONDS);
+}
+
+void Audio_Player_Stream::set_target_latency_seconds(float target_latency_seconds) {
+    m_target_latency_seconds = std::clamp(target_latency_seconds, MIN_TARGET_LATENCY_SECONDS, MAX_TARGET_LATENCY_SECONDS);
+}
+
+void Audio_Player_Stream::stop_output_thread() {
+    m_is_running = false;
+    if (m_output_thread == nullptr) return;
+    // wake the output thread if it is waiting for audio
+    m_data_signal->notify();
+    m_output_thread->join();
+    m_output_thread = nullptr;
+}
+
+void Audio_Player_Stream::set_callback(AudioPipelineSink::Callback callback) {
+    auto lock = std::unique_lock(m_mutex_callback);
+    stop_output_thread();
+    m_callback = callback;
+    if (m_callback == nullptr) return;
+    m_is_running = true;
+    m_output_thread = std::make_unique<std::thread>([this, callback]() {
+        Pipeline_Stage* stage = nullptr;
+        if (m_telemetry != nullptr) {
+            stage = &m_telemetry->get_stage(Pipeline_Telemetry::Stage::AUDIO_OUTPUT);
+        }
+        std::vector<Frame<float>> input_buf;
+        while (m_is_running) {
+            const float sample_rate = m_sample_rate;
+            const float block_size_seconds = m_block_size_seconds;
+            // NOTE: Sink rate and latency changes are applied between blocks
+            m_jitter_buffer->set_output_rate(sample_rate);
+            m_jitter_buffer->set_target_latency_seconds(m_target_latency_seconds);
+            const size_t block_size = std::max(size_t(sample_rate*block_size_seconds), size_t(1));
+            auto wr_buf = m_output_stream.writeBuf; // default buffer size is 1 million (we can avoid resizing)
+            static_assert(sizeof(Frame<float>) == sizeof(dsp::stereo_t));
+            auto frame_buf = tcb::span(reinterpret_cast<Frame<float>*>(wr_buf), block_size);
+            size_t total_written = 0;
+            {
+                auto timer = Scoped_Stage_Timer(stage);
+                // take everything the pipeline has so the drift shows up in the jitter buffer's fill level
+                input_buf.resize(m_jitter_buffer->get_total_free());
+                size_t total_read = callback(tcb::span(input_buf), PIPELINE_SAMPLE_RATE);
+                total_read = mix_taps(tcb::span(input_buf), total_read);
+                m_jitter_buffer->write(tcb::span(input_buf).first(total_read));
+                total_written = m_jitter_buffer->read(frame_buf);
+            }
+            // NOTE: This waits for the sink to read the previous block so it is what paces the thread
+            if (total_written > 0) {
+                const bool is_buffer_swapped = m_output_stream.swap(int(total_written));
+                // @fix(#9): https://github.com/williamyang98/SDRPlusPlus-DAB-Radio-Plugin/issues/9
+                // buffer swap fails if the writer was blocked which can occur if there is no reader
+                // and write operations have been disabled, so we sleep here to avoid consuming cpu cycles
+                if (!is_buffer_swapped) {
+                    const int64_t sleep_us = int64_t(block_size_seconds*1e6f);
+                    std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+                }
+            } else {
+                // the jitter buffer is waiting for more audio so sleep until a source writes some
+                m_data_signal->wait_for(IDLE_TIMEOUT);
+            }
+        }
+    });
+}
+
+void Audio_Player_Stream::attach_tap(Audio_Player_Tap* tap) {
+    auto lock = std::unique_lock(m_mutex_taps);
+    m_taps.push_back(tap);
+}
+
+void Audio_Player_Stream::detach_tap(Audio_Player_Tap* tap) {
+    auto lock = std::unique_lock(m_mutex_taps);
+    m_taps.erase(std::remove(m_taps.begin(), m_taps.end(), tap), m_taps.end());
+}
+
+size_t Audio_Player_Stream::mix_taps(tcb::span<Frame<float>> frames, size_t total_written) {
+    auto lock = std::unique_lock(m_mutex_taps);
+    if (m_taps.empty()) return total_written;
+    auto buf = tcb::span(reinterpret_cast<dsp::stereo_t*>(frames.data()), frames.size());
+    m_tap_buffer.resize(buf.size());
+    auto tap_buf = tcb::span(reinterpret_cast<Frame<float>*>(m_tap_buffer.data()), m_tap_buffer.size());
+    for (auto* tap: m_taps) {
+        // NOTE: Taps are mixed before resampling so they share the pipeline's rate
+        const size_t total_read = tap->read(tap_buf, PIPELINE_SAMPLE_RATE);
+        for (size_t i = 0; i < total_read; i++) {
+            if (i < total_written) {
+                buf[i].l += m_tap_buffer[i].l;
+                buf[i].r += m_tap_buffer[i].r;
+            } else {
+                buf[i] = m_tap_buffer[i];
+            }
+        }
+        total_written = std::max(total_written, total_read);
+    }
+    return total_written;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <dsp/stream.h>
+#include "audio/audio_pipeline.h"
+#include "utility/span.h"
+#include "./event_signal.h"
+
+class Audio_Player_Tap;
+class Audio_Jitter_Buffer;
+class Pipeline_Telemetry;
+
+struct Audio_Player_Profile {
+    const char* label;
+    float block_size_seconds;
+    float target_latency_seconds;
+};
+
+// Pulls audio from the pipeline at a fixed rate into a jitter buffer that resamples it to the rate of the sdr++ sink
+// - The output thread is paced by the sink since swapping a block waits for the previous one to be read
+// - When there is no audio the thread sleeps until the data signal is notified instead of polling
+class Audio_Player_Stream: public AudioPipelineSink
+{
+public:
+    // NOTE: Most dab+ services are 48kHz so they reach the resampler without being converted by the mixer
+    static constexpr float PIPELINE_SAMPLE_RATE = 48000.0f;
+    static constexpr float MIN_BLOCK_SIZE_SECONDS = 0.005f;
+    static constexpr float MAX_BLOCK_SIZE_SECONDS = 0.2f;
+    // NOTE: Dab+ audio arrives a 120ms superframe at a time so the latency can't go much lower than this
+    static constexpr float MIN_TARGET_LATENCY_SECONDS = 0.15f;
+    static constexpr float MAX_TARGET_LATENCY_SECONDS = 2.0f;
+    static constexpr Audio_Player_Profile PROFILES[] = {
+        { "Standard", 0.1f, 0.4f },
+        { "Low latency", 0.01f, 0.16f },
+    };
+private:
+    // NOTE: The output thread only reads these between blocks
+    std::atomic<float> m_sample_rate;
+    std::atomic<float> m_block_size_seconds;
+    std::atomic<float> m_target_latency_seconds;
+    dsp::stream<dsp::stereo_t> m_output_stream;
+    std::unique_ptr<std::thread> m_output_thread;
+    AudioPipelineSink::Callback m_callback;
+    std::mutex m_mutex_callback;
+    std::atomic<bool> m_is_running;
+    std::shared_ptr<Event_Signal> m_data_signal;
+    // NOTE: Only the output thread reads and writes audio to this
+    std::unique_ptr<Audio_Jitter_Buffer> m_jitter_buffer;
+    std::mutex m_mutex_taps;
+    std::vector<Audio_Player_Tap*> m_taps;
+    std::vector<dsp::stereo_t> m_tap_buffer;
+    std::shared_ptr<Pipeline_Telemetry> m_telemetry;
+public:
+    Audio_Player_Stream(float sample_rate, float block_size_seconds);
+    ~Audio_Player_Stream() override;
+    void set_callback(AudioPipelineSink::Callback callback) override;
+    std::string_view get_name() const override { return "sdr_audio_sink"; }
+public:
+    auto& get_output_stream() { return m_output_stream; }
+    void set_sample_rate(float sample_rate) { m_sample_rate = sample_rate; }
+    float get_sample_rate() const { return m_sample_rate; }
+    void set_block_size_seconds(float block_size_seconds);
+    float get_block_size_seconds() const { return m_block_size_seconds; }
+    void set_target_latency_seconds(float target_latency_seconds);
+    float get_target_latency_seconds() const { return m_target_latency_seconds; }
+    // fill level, drift estimate and underrun counts
+    const Audio_Jitter_Buffer& get_jitter_buffer() const { return *m_jitter_buffer; }
+    // notify this when audio is written into any pipeline that feeds the player
+    std::shared_ptr<Event_Signal> get_data_signal() { return m_data_signal; }
+    // NOTE: Must be set before the callback is given since the output thread reads this without a lock
+    void set_telemetry(std::shared_ptr<Pipeline_Telemetry> telemetry) { m_telemetry = telemetry; }
+    void attach_tap(Audio_Player_Tap* tap);
+    void detach_tap(Audio_Player_Tap* tap);
+private:
+    void stop_output_thread();
+    size_t mix_taps(tcb::span<Frame<float>> buf, size_t total_written);
+};
+
+// Lets other audio pipelines mix into the same sdr++ audio stream
+class Audio_Player_Tap: public AudioPipelineSink
+{
+private:
+    Audio_Player_Stream& m_player;
+    AudioPipelineSink::Callback m_callback;
+    std::mutex m_mutex_callback;
+public:
+    Audio_Player_Tap(Audio_Player_Stream& player);
+    ~Audio_Player_Tap() override;
+    void set_callback(AudioPipelineSink::Callback callback) override;
+    std::string_view get_name() const override { return "sdr_audio_tap"; }
+    size_t read(tcb::span<Frame<float>> buf, float sample_rate);
+};
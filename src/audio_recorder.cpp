@@ -0,0 +1,236 @@
+#include "./audio_recorder.h"
+#include <string.h>
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fmt/core.h>
+#include "./async_file_writer.h"
+
+constexpr size_t TOTAL_CHANNELS = 2;
+constexpr size_t BYTES_PER_FRAME = sizeof(Frame<int16_t>);
+constexpr size_t WAV_HEADER_SIZE = 44;
+static_assert(BYTES_PER_FRAME == TOTAL_CHANNELS*sizeof(int16_t));
+
+static void write_u32_le(uint8_t* dest, uint32_t value) {
+    dest[0] = uint8_t(value);
+    dest[1] = uint8_t(value >> 8);
+    dest[2] = uint8_t(value >> 16);
+    dest[3] = uint8_t(value >> 24);
+}
+
+static void write_u16_le(uint8_t* dest, uint16_t value) {
+    dest[0] = uint8_t(value);
+    dest[1] = uint8_t(value >> 8);
+}
+
+static void create_wav_header(uint8_t* dest, uint32_t sample_rate, uint64_t total_data_bytes) {
+    // NOTE: Sizes are clamped for recordings past 4GB which is over 6 hours of 48kHz audio
+    const uint32_t data_size = uint32_t(std::min(total_data_bytes, uint64_t(UINT32_MAX - WAV_HEADER_SIZE)));
+    memcpy(dest + 0, "RIFF", 4);
+    write_u32_le(dest + 4, data_size + uint32_t(WAV_HEADER_SIZE) - 8);
+    memcpy(dest + 8, "WAVE", 4);
+    memcpy(dest + 12, "fmt ", 4);
+    write_u32_le(dest + 16, 16);
+    write_u16_le(dest + 20, 1); // pcm
+    write_u16_le(dest + 22, uint16_t(TOTAL_CHANNELS));
+    write_u32_le(dest + 24, sample_rate);
+    write_u32_le(dest + 28, sample_rate*uint32_t(BYTES_PER_FRAME));
+    write_u16_le(dest + 32, uint16_t(BYTES_PER_FRAME));
+    write_u16_le(dest + 34, 16);
+    memcpy(dest + 36, "data", 4);
+    write_u32_le(dest + 40, data_size);
+}
+
+static std::string sanitise_filename(std::string_view name) {
+    std::string out;
+    out.reserve(name.size());
+    for (const char c: name) {
+        const bool is_valid =
+            ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+            ((c >= '0') && (c <= '9')) || (c == '-') || (c == '.');
+        out += is_valid ? c : '_';
+    }
+    return out;
+}
+
+Audio_Recording::Audio_Recording(subchannel_id_t subchannel_id)
+: m_subchannel_id(subchannel_id),
+  m_writer(nullptr), m_file(nullptr), m_total_parts(0),
+  m_sample_rate(0.0f), m_total_frames(0), m_total_data_bytes(0)
+{}
+
+Audio_Recording::~Audio_Recording() {
+    stop();
+}
+
+bool Audio_Recording::start(std::shared_ptr<Async_File_Writer> writer, const std::string& filepath) {
+    stop();
+    auto lock = std::unique_lock(m_mutex);
+    m_writer = writer;
+    m_filepath = filepath;
+    m_total_parts = 0;
+    m_sample_rate = 0.0f;
+    m_total_frames = 0;
+    // NOTE: The sample rate isn't known until the first block of audio arrives
+    //       so the header gets it when it is patched on close
+    if (!open_part()) {
+        m_writer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Audio_Recording::stop() {
+    auto lock = std::unique_lock(m_mutex);
+    close_part();
+    m_writer = nullptr;
+}
+
+bool Audio_Recording::is_recording() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_writer != nullptr;
+}
+
+bool Audio_Recording::open_part() {
+    m_total_parts++;
+    const auto filepath = (m_total_parts == 1) ?
+        fmt::format("{}.wav", m_filepath) :
+        fmt::format("{}_part{}.wav", m_filepath, m_total_parts);
+    m_file = m_writer->open(filepath);
+    if (m_file == nullptr) return false;
+    uint8_t header[WAV_HEADER_SIZE];
+    create_wav_header(header, uint32_t(m_sample_rate), 0);
+    m_file->write({ header, WAV_HEADER_SIZE });
+    m_total_data_bytes = 0;
+    return true;
+}
+
+void Audio_Recording::close_part() {
+    if (m_file == nullptr) return;
+    uint8_t header[WAV_HEADER_SIZE];
+    create_wav_header(header, uint32_t(m_sample_rate), m_total_data_bytes);
+    m_file->write_at(0, { header, WAV_HEADER_SIZE });
+    m_writer->close(m_file);
+    m_file = nullptr;
+}
+
+void Audio_Recording::process(tcb::span<const Frame<int16_t>> frames, float sample_rate) {
+    // NOTE: Only contended when starting or stopping a recording
+    auto lock = std::unique_lock(m_mutex);
+    if (m_writer == nullptr) return;
+    if (frames.empty()) return;
+
+    if (m_sample_rate != sample_rate) {
+        // the file opened by start() doesn't have a rate yet so it takes this one instead of starting a new part
+        if ((m_file != nullptr) && (m_sample_rate > 0.0f)) {
+            close_part();
+        }
+        m_sample_rate = sample_rate;
+        if ((m_file == nullptr) && !open_part()) {
+            m_writer = nullptr;
+            return;
+        }
+    }
+    if (m_file == nullptr) return;
+
+    // a previous write was cut short in the middle of a frame so pad it out to keep the channels aligned
+    const size_t misaligned_bytes = size_t(m_total_data_bytes % BYTES_PER_FRAME);
+    if (misaligned_bytes > 0) {
+        const uint8_t padding[BYTES_PER_FRAME] = {0};
+        const uint64_t total_dropped = m_file->get_total_bytes_dropped();
+        const size_t total_padding = BYTES_PER_FRAME - misaligned_bytes;
+        m_file->write({ padding, total_padding });
+        m_total_data_bytes += total_padding - (m_file->get_total_bytes_dropped() - total_dropped);
+    }
+
+    const auto data = tcb::span(reinterpret_cast<const uint8_t*>(frames.data()), frames.size()*BYTES_PER_FRAME);
+    const uint64_t total_dropped = m_file->get_total_bytes_dropped();
+    m_file->write(data);
+    m_total_data_bytes += data.size() - (m_file->get_total_bytes_dropped() - total_dropped);
+    m_total_frames += frames.size();
+}
+
+Audio_Recording_Stats Audio_Recording::get_stats() {
+    auto lock = std::unique_lock(m_mutex);
+    Audio_Recording_Stats stats;
+    stats.subchannel_id = m_subchannel_id;
+    stats.sample_rate = m_sample_rate;
+    stats.total_frames = m_total_frames;
+    if (m_file != nullptr) {
+        stats.filepath = std::string(m_file->get_filepath());
+        stats.total_bytes_written = m_file->get_total_bytes_written();
+        stats.total_bytes_dropped = m_file->get_total_bytes_dropped();
+        stats.write_throughput = m_file->get_write_throughput();
+        stats.is_error = m_file->is_error();
+    }
+    return stats;
+}
+
+Audio_Recorder::Audio_Recorder(std::shared_ptr<Async_File_Writer> writer, std::string_view directory)
+: m_writer(writer), m_directory(directory)
+{}
+
+Audio_Recorder::~Audio_Recorder() {
+    stop_all();
+}
+
+std::shared_ptr<Audio_Recording> Audio_Recorder::find_recording(subchannel_id_t subchannel_id) {
+    auto lock = std::unique_lock(m_mutex);
+    auto res = m_recordings.find(subchannel_id);
+    if (res == m_recordings.end()) return nullptr;
+    return res->second;
+}
+
+bool Audio_Recorder::start(subchannel_id_t subchannel_id, std::string_view name) {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    const std::time_t time = std::time(nullptr);
+    char time_str[32] = {0};
+    std::strftime(time_str, sizeof(time_str), "%Y%m%d_%H%M%S", std::localtime(&time));
+    const auto filename = fmt::format("dab_audio_{}_{}", sanitise_filename(name), time_str);
+    const auto filepath = (std::filesystem::path(m_directory) / filename).string();
+
+    std::shared_ptr<Audio_Recording> recording = nullptr;
+    {
+        auto lock = std::unique_lock(m_mutex);
+        auto& entry = m_recordings[subchannel_id];
+        if (entry == nullptr) entry = std::make_shared<Audio_Recording>(subchannel_id);
+        recording = entry;
+    }
+    return recording->start(m_writer, filepath);
+}
+
+void Audio_Recorder::stop(subchannel_id_t subchannel_id) {
+    auto recording = find_recording(subchannel_id);
+    if (recording == nullptr) return;
+    recording->stop();
+}
+
+void Audio_Recorder::stop_all() {
+    auto lock = std::unique_lock(m_mutex);
+    for (auto& [_, recording]: m_recordings) {
+        recording->stop();
+    }
+}
+
+bool Audio_Recorder::is_recording(subchannel_id_t subchannel_id) {
+    auto recording = find_recording(subchannel_id);
+    if (recording == nullptr) return false;
+    return recording->is_recording();
+}
+
+void Audio_Recorder::process(subchannel_id_t subchannel_id, tcb::span<const Frame<int16_t>> frames, float sample_rate) {
+    auto recording = find_recording(subchannel_id);
+    if (recording == nullptr) return;
+    recording->process(frames, sample_rate);
+}
+
+std::vector<Audio_Recording_Stats> Audio_Recorder::get_stats() {
+    auto lock = std::unique_lock(m_mutex);
+    std::vector<Audio_Recording_Stats> stats;
+    for (auto& [_, recording]: m_recordings) {
+        if (!recording->is_recording()) continue;
+        stats.push_back(recording->get_stats());
+    }
+    return stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "dab/database/dab_database_types.h"
+#include "audio/audio_pipeline.h"
+#include "utility/span.h"
+
+class Async_File;
+class Async_File_Writer;
+
+struct Audio_Recording_Stats {
+    subchannel_id_t subchannel_id = 0;
+    std::string filepath;
+    float sample_rate = 0.0f;
+    uint64_t total_frames = 0;
+    uint64_t total_bytes_written = 0;
+    uint64_t total_bytes_dropped = 0;
+    // disk throughput while writing in bytes per second
+    double write_throughput = 0.0;
+    bool is_error = false;
+};
+
+// Writes the decoded audio of a subchannel to a 16bit stereo wav file
+// - Called from the radio thread and never waits on disk since the async writer drops data instead
+// - The header sizes are patched in when the file is closed
+// - A change in sample rate starts a new file since a wav file only has one rate
+class Audio_Recording
+{
+private:
+    const subchannel_id_t m_subchannel_id;
+    std::mutex m_mutex;
+    std::shared_ptr<Async_File_Writer> m_writer;
+    std::shared_ptr<Async_File> m_file;
+    std::string m_filepath;
+    size_t m_total_parts;
+    float m_sample_rate;
+    uint64_t m_total_frames;
+    // bytes accepted by the writer after the header so dropped data can't misalign frames
+    uint64_t m_total_data_bytes;
+public:
+    explicit Audio_Recording(subchannel_id_t subchannel_id);
+    ~Audio_Recording();
+    Audio_Recording(const Audio_Recording&) = delete;
+    Audio_Recording& operator=(const Audio_Recording&) = delete;
+    // filepath is given without an extension
+    bool start(std::shared_ptr<Async_File_Writer> writer, const std::string& filepath);
+    void stop();
+    bool is_recording();
+    // called from the radio thread
+    void process(tcb::span<const Frame<int16_t>> frames, float sample_rate);
+    Audio_Recording_Stats get_stats();
+private:
+    bool open_part();
+    void close_part();
+};
+
+// Records any number of subchannels from one ensemble through a shared async writer pool
+class Audio_Recorder
+{
+private:
+    std::shared_ptr<Async_File_Writer> m_writer;
+    const std::string m_directory;
+    std::mutex m_mutex;
+    std::unordered_map<subchannel_id_t, std::shared_ptr<Audio_Recording>> m_recordings;
+public:
+    Audio_Recorder(std::shared_ptr<Async_File_Writer> writer, std::string_view directory);
+    ~Audio_Recorder();
+    Audio_Recorder(const Audio_Recorder&) = delete;
+    Audio_Recorder& operator=(const Audio_Recorder&) = delete;
+    // name is used for the filename along with the time
+    bool start(subchannel_id_t subchannel_id, std::string_view name);
+    void stop(subchannel_id_t subchannel_id);
+    void stop_all();
+    bool is_recording(subchannel_id_t subchannel_id);
+    // called from the radio thread
+    void process(subchannel_id_t subchannel_id, tcb::span<const Frame<int16_t>> frames, float sample_rate);
+    std::vector<Audio_Recording_Stats> get_stats();
+    std::string_view get_directory() const { return m_directory; }
+private:
+    std::shared_ptr<Audio_Recording> find_recording(subchannel_id_t subchannel_id);
+};
@@ -0,0 +1,120 @@
+#include "./audio_resampler.h"
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <volk/volk.h>
+
+constexpr float PI = 3.14159265358979323846f;
+// keep the passband a little below nyquist so the transition band doesn't alias
+constexpr float CUTOFF_SCALE = 0.9f;
+constexpr int FRACTION_BITS = 32;
+constexpr uint64_t FRACTION_MASK = (uint64_t(1) << FRACTION_BITS) - 1;
+
+static_assert(sizeof(Frame<float>) == sizeof(std::complex<float>));
+
+Audio_Resampler::Audio_Resampler(float input_rate, float output_rate, size_t taps_per_phase)
+: m_input_rate(input_rate), m_output_rate(output_rate), m_taps_per_phase(taps_per_phase)
+{
+    assert(m_taps_per_phase >= 2);
+    assert((m_input_rate > 0.0f) && (m_output_rate > 0.0f));
+    create_phase_taps();
+    set_rate_adjustment(1.0);
+    reset();
+}
+
+void Audio_Resampler::create_phase_taps() {
+    const size_t P = TOTAL_PHASES;
+    const size_t T = m_taps_per_phase;
+    // cutoff in cycles per input sample which also acts as the anti aliasing filter when decimating
+    const float ratio = std::min(m_output_rate / m_input_rate, 1.0f);
+    const float cutoff = 0.5f*ratio*CUTOFF_SCALE;
+    const float half_width = float(T)/2.0f;
+    m_phase_taps.resize((P+1)*T);
+    for (size_t p = 0; p <= P; p++) {
+        auto taps = tcb::span(m_phase_taps).subspan(p*T, T);
+        const float fraction = float(p) / float(P);
+        float sum = 0.0f;
+        for (size_t q = 0; q < T; q++) {
+            // distance from the input frame at q to the output frame in input samples
+            const float n = fraction + half_width - 1.0f - float(q);
+            const float x = 2.0f*cutoff*n;
+            const float sinc = (x == 0.0f) ? 1.0f : std::sin(PI*x)/(PI*x);
+            // blackman window over [-T/2,+T/2]
+            const float k = 2.0f*PI*(n + half_width)/float(T);
+            const float window = 0.42f - 0.5f*std::cos(k) + 0.08f*std::cos(2.0f*k);
+            taps[q] = sinc*window;
+            sum += taps[q];
+        }
+        // unity gain at DC for every phase so there is no ripple at the phase rate
+        for (auto& tap: taps) {
+            tap /= sum;
+        }
+    }
+}
+
+void Audio_Resampler::set_rate_adjustment(double adjustment) {
+    m_rate_adjustment = adjustment;
+    const double step = double(m_input_rate) / double(m_output_rate) * adjustment;
+    m_step = uint64_t(std::llround(std::ldexp(step, FRACTION_BITS)));
+}
+
+void Audio_Resampler::reset() {
+    m_history.clear();
+    m_window_start = 0;
+    m_fraction = 0;
+    // NOTE: Centre the first output on the first input frame
+    m_history.resize(m_taps_per_phase/2 - 1, std::complex<float>(0.0f, 0.0f));
+}
+
+size_t Audio_Resampler::get_input_required(size_t total_output) const {
+    if (total_output == 0) return 0;
+    const uint64_t last_position = m_fraction + uint64_t(total_output-1)*m_step;
+    const size_t last_window_end = m_window_start + size_t(last_position >> FRACTION_BITS) + m_taps_per_phase;
+    return (last_window_end > m_history.size()) ? (last_window_end - m_history.size()) : 0;
+}
+
+size_t Audio_Resampler::get_total_buffered() const {
+    // frames past the centre of the next output's window haven't been played yet
+    const size_t centre = m_window_start + m_taps_per_phase/2 - 1;
+    return (m_history.size() > centre) ? (m_history.size() - centre) : 0;
+}
+
+size_t Audio_Resampler::process(tcb::span<const Frame<float>> input, tcb::span<Frame<float>> output) {
+    const auto* input_samples = reinterpret_cast<const std::complex<float>*>(input.data());
+    m_history.insert(m_history.end(), input_samples, input_samples + input.size());
+    auto* output_samples = reinterpret_cast<std::complex<float>*>(output.data());
+
+    const size_t T = m_taps_per_phase;
+    size_t total_written = 0;
+    while ((total_written < output.size()) && (m_window_start + T <= m_history.size())) {
+        // select the two phases either side of the fractional position
+        const uint64_t phase_position = m_fraction * TOTAL_PHASES;
+        const size_t phase_index = size_t(phase_position >> FRACTION_BITS);
+        const float weight = float(phase_position & FRACTION_MASK) * (1.0f / float(uint64_t(1) << FRACTION_BITS));
+        const auto* window = reinterpret_cast<const lv_32fc_t*>(&m_history[m_window_start]);
+        lv_32fc_t y0;
+        lv_32fc_t y1;
+        volk_32fc_32f_dot_prod_32fc(&y0, window, &m_phase_taps[phase_index*T], (unsigned int)T);
+        volk_32fc_32f_dot_prod_32fc(&y1, window, &m_phase_taps[(phase_index+1)*T], (unsigned int)T);
+        output_samples[total_written] = std::complex<float>(y0) + weight*(std::complex<float>(y1) - std::complex<float>(y0));
+        total_written++;
+        m_fraction += m_step;
+        m_window_start += size_t(m_fraction >> FRACTION_BITS);
+        m_fraction &= FRACTION_MASK;
+    }
+
+    // drop frames that no future output depends on
+    const size_t total_consumed = std::min(m_window_start, m_history.size());
+    m_history.erase(m_history.begin(), m_history.begin() + total_consumed);
+    m_window_start -= total_consumed;
+    return total_written;
+}
+
+size_t Audio_Resampler::discard(size_t total_frames) {
+    const size_t total_skipped = std::min(total_frames, get_total_buffered());
+    m_window_start += total_skipped;
+    const size_t total_consumed = std::min(m_window_start, m_history.size());
+    m_history.erase(m_history.begin(), m_history.begin() + total_consumed);
+    m_window_start -= total_consumed;
+    return total_skipped;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <vector>
+#include "audio/audio_pipeline.h"
+#include "utility/span.h"
+
+// Polyphase windowed sinc resampler for interleaved stereo frames
+// - The read position is tracked in 32.32 fixed point so the ratio can be trimmed by a few ppm at any time
+// - Outputs between two of the TOTAL_PHASES filter phases are linearly interpolated
+// - Each phase is a single dot product over contiguous input frames
+//   where the left/right channels are treated as the real/imaginary parts of a complex sample
+// - Input that hasn't been consumed yet is buffered so this can also act as a fifo
+class Audio_Resampler
+{
+public:
+    static constexpr size_t TOTAL_PHASES = 256;
+    static constexpr size_t DEFAULT_TAPS_PER_PHASE = 32;
+private:
+    const float m_input_rate;
+    const float m_output_rate;
+    const size_t m_taps_per_phase;
+    std::vector<float> m_phase_taps; // [phase][tap] with an extra phase for interpolating past the last one
+    std::vector<std::complex<float>> m_history;
+    size_t m_window_start;
+    uint64_t m_fraction; // 0.32 fixed point
+    uint64_t m_step;     // 32.32 fixed point
+    double m_rate_adjustment;
+public:
+    Audio_Resampler(float input_rate, float output_rate, size_t taps_per_phase=DEFAULT_TAPS_PER_PHASE);
+    float get_input_rate() const { return m_input_rate; }
+    float get_output_rate() const { return m_output_rate; }
+    // consume input this much faster than the nominal ratio, e.g. 1.0001 for +100ppm
+    void set_rate_adjustment(double adjustment);
+    double get_rate_adjustment() const { return m_rate_adjustment; }
+    // number of new input frames needed to produce this many output frames
+    size_t get_input_required(size_t total_output) const;
+    // input frames that have been written but not consumed yet
+    size_t get_total_buffered() const;
+    // consumes as much of the input as fits into the output and returns the number of frames written
+    // NOTE: Input that doesn't fit into the output is kept for the next call
+    size_t process(tcb::span<const Frame<float>> input, tcb::span<Frame<float>> output);
+    // skips buffered input without resampling it and returns the number of frames skipped
+    size_t discard(size_t total_frames);
+    void reset();
+private:
+    void create_phase_taps();
+};
@@ -0,0 +1,79 @@
+#include "./audio_source_buffer.h"
+#include <assert.h>
+#include <algorithm>
+
+Audio_Source_Buffer::Audio_Source_Buffer(size_t capacity, Audio_Overflow_Policy overflow_policy)
+: m_buffer(capacity), m_write_index(0), m_read_index(0), m_sample_rate(0.0f),
+  m_overflow_policy(overflow_policy), m_total_frames_dropped(0), m_total_overflows(0)
+{
+    assert(capacity > 0);
+}
+
+size_t Audio_Source_Buffer::get_total_available() const {
+    const size_t read_index = m_read_index.load();
+    const size_t write_index = m_write_index.load();
+    return (write_index > read_index) ? (write_index - read_index) : 0;
+}
+
+size_t Audio_Source_Buffer::write(tcb::span<const Frame<int16_t>> src, float sample_rate) {
+    if (src.empty()) return 0;
+    m_sample_rate = sample_rate;
+    const size_t N = m_buffer.size();
+    const auto policy = m_overflow_policy.load();
+    size_t total_dropped = 0;
+    // only the newest frames can fit if there are more than the capacity
+    if (src.size() > N) {
+        const size_t excess = src.size() - N;
+        src = (policy == Audio_Overflow_Policy::DROP_OLDEST) ? src.last(N) : src.first(N);
+        total_dropped += excess;
+    }
+
+    const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+    size_t read_index = m_read_index.load(std::memory_order_acquire);
+    while (true) {
+        const size_t total_free = N - (write_index - read_index);
+        if (src.size() <= total_free) break;
+        const size_t excess = src.size() - total_free;
+        if (policy == Audio_Overflow_Policy::DROP_NEWEST) {
+            src = src.first(total_free);
+            total_dropped += excess;
+            break;
+        }
+        // NOTE: The consumer may have read some frames in the mean time so this only succeeds
+        //       if the frames being dropped are still the oldest ones
+        if (m_read_index.compare_exchange_weak(read_index, read_index + excess, std::memory_order_acq_rel)) {
+            total_dropped += excess;
+            break;
+        }
+    }
+
+    const size_t offset = write_index % N;
+    const size_t total_head = std::min(src.size(), N-offset);
+    std::copy_n(src.begin(), total_head, m_buffer.begin() + offset);
+    std::copy_n(src.begin() + total_head, src.size()-total_head, m_buffer.begin());
+    m_write_index.store(write_index + src.size(), std::memory_order_release);
+
+    if (total_dropped > 0) {
+        m_total_frames_dropped += total_dropped;
+        m_total_overflows++;
+    }
+    return total_dropped;
+}
+
+size_t Audio_Source_Buffer::read(tcb::span<Frame<int16_t>> dest) {
+    const size_t N = m_buffer.size();
+    size_t read_index = m_read_index.load(std::memory_order_acquire);
+    while (true) {
+        const size_t write_index = m_write_index.load(std::memory_order_acquire);
+        const size_t total_read = std::min(dest.size(), write_index - read_index);
+        if (total_read == 0) return 0;
+        const size_t offset = read_index % N;
+        const size_t total_head = std::min(total_read, N-offset);
+        std::copy_n(m_buffer.begin() + offset, total_head, dest.begin());
+        std::copy_n(m_buffer.begin(), total_read-total_head, dest.begin() + total_head);
+        // the producer dropped some of these frames while they were copied so read the newer ones instead
+        if (m_read_index.compare_exchange_strong(read_index, read_index + total_read, std::memory_order_acq_rel)) {
+            return total_read;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "audio/audio_pipeline.h"
+#include "utility/span.h"
+
+enum class Audio_Overflow_Policy: int {
+    DROP_OLDEST, DROP_NEWEST
+};
+
+// Lock free single producer single consumer ring between a decoder and the audio pipeline
+// - The producer never blocks, if the ring is full frames are dropped according to the overflow policy
+// - Dropping the oldest frames moves the read index from the producer's side so the consumer
+//   claims what it copied with a compare exchange and retries if the producer dropped those frames
+//   NOTE: A copy that overlaps frames being overwritten is always discarded by the failed compare exchange
+class Audio_Source_Buffer
+{
+private:
+    std::vector<Frame<int16_t>> m_buffer;
+    // monotonic counters so that full and empty are distinguishable
+    alignas(64) std::atomic<size_t> m_write_index;
+    alignas(64) std::atomic<size_t> m_read_index;
+    alignas(64) std::atomic<float> m_sample_rate;
+    std::atomic<Audio_Overflow_Policy> m_overflow_policy;
+    std::atomic<size_t> m_total_frames_dropped;
+    std::atomic<size_t> m_total_overflows;
+public:
+    Audio_Source_Buffer(size_t capacity, Audio_Overflow_Policy overflow_policy);
+    Audio_Source_Buffer(const Audio_Source_Buffer&) = delete;
+    Audio_Source_Buffer& operator=(const Audio_Source_Buffer&) = delete;
+    // producer, returns the number of frames that were dropped
+    size_t write(tcb::span<const Frame<int16_t>> src, float sample_rate);
+    // consumer, returns the number of frames read
+    size_t read(tcb::span<Frame<int16_t>> dest);
+    size_t get_capacity() const { return m_buffer.size(); }
+    size_t get_total_available() const;
+    float get_sample_rate() const { return m_sample_rate; }
+    void set_overflow_policy(Audio_Overflow_Policy policy) { m_overflow_policy = policy; }
+    Audio_Overflow_Policy get_overflow_policy() const { return m_overflow_policy; }
+    size_t get_total_frames_dropped() const { return m_total_frames_dropped; }
+    size_t get_total_overflows() const { return m_total_overflows; }
+};
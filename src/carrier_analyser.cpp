@@ -0,0 +1,232 @@
+#include "./carrier_analyser.h"
+#include <algorithm>
+#include <cmath>
+#include <volk/volk.h>
+
+// NOTE: Stop analysing if nothing has queried the analysis for this long
+constexpr auto REQUEST_TIMEOUT = std::chrono::seconds(2);
+// weight of the newest frame in the running average
+constexpr float AVERAGE_ALPHA = 0.2f;
+constexpr float MAX_MER_DB = 60.0f;
+constexpr float MIN_LEVEL_DB = -60.0f;
+// the guard interval is 246us so echoes past this aren't useful to show
+constexpr float MAX_IMPULSE_RESPONSE_US = 256.0f;
+// in a single frequency network the strongest path isn't always the first one
+constexpr float PRE_PEAK_IMPULSE_RESPONSE_US = 64.0f;
+// skip the main lobe when looking for echoes
+constexpr size_t ECHO_SEARCH_START = 4;
+// symbols copied out of each frame spread evenly over the frame
+constexpr size_t TOTAL_ANALYSED_SYMBOLS = 8;
+
+static int64_t get_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static float to_db(float x) {
+    return (x > 0.0f) ? std::max(10.0f*std::log10(x), MIN_LEVEL_DB) : MIN_LEVEL_DB;
+}
+
+Carrier_Analyser::Carrier_Analyser(size_t total_carriers, size_t fft_size, float sample_rate)
+: m_total_carriers(total_carriers), m_fft_size(fft_size), m_sample_rate(sample_rate),
+  m_pending_total_symbols(0), m_pending_impulse_response_size(0),
+  m_is_frame_pending(false), m_is_running(true), m_last_request_ns(0), m_is_reset_requested(false),
+  m_analysis(nullptr), m_total_symbols(0), m_impulse_response_size(0), m_total_frames(0)
+{
+    m_pending_frame.resize(m_total_carriers*TOTAL_ANALYSED_SYMBOLS);
+    m_pending_impulse_response.resize(m_fft_size);
+    m_frame.resize(m_total_carriers*TOTAL_ANALYSED_SYMBOLS);
+    m_impulse_response.resize(m_fft_size);
+    m_frame_amplitude_sum.resize(m_total_carriers);
+    m_frame_power_sum.resize(m_total_carriers);
+    m_amplitude_average.resize(m_total_carriers);
+    m_power_average.resize(m_total_carriers);
+    m_scratch.resize(m_total_carriers);
+    m_thread = std::make_unique<std::thread>([this]() { run(); });
+}
+
+Carrier_Analyser::~Carrier_Analyser() {
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_is_running = false;
+        m_cv.notify_all();
+    }
+    m_thread->join();
+}
+
+bool Carrier_Analyser::is_requested() const {
+    const int64_t timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(REQUEST_TIMEOUT).count();
+    return (get_now_ns() - m_last_request_ns) < timeout_ns;
+}
+
+void Carrier_Analyser::push_frame(tcb::span<const std::complex<float>> data, tcb::span<const float> impulse_response) {
+    if ((m_total_carriers == 0) || (data.size() < m_total_carriers) || !is_requested()) return;
+    {
+        auto lock = std::unique_lock(m_mutex);
+        // NOTE: Drop the frame if the worker hasn't picked up the last one
+        if (m_is_frame_pending) return;
+    }
+    // NOTE: The worker only touches the pending slot while it is marked as pending so it is filled without the lock
+    //       A few symbols per frame are enough since the averages are taken over many frames
+    const size_t K = m_total_carriers;
+    const size_t total_frame_symbols = data.size() / K;
+    const size_t total_symbols = std::min(total_frame_symbols, TOTAL_ANALYSED_SYMBOLS);
+    for (size_t i = 0; i < total_symbols; i++) {
+        const size_t symbol = i*total_frame_symbols/total_symbols;
+        std::copy_n(data.begin() + symbol*K, K, m_pending_frame.begin() + i*K);
+    }
+    m_pending_total_symbols = total_symbols;
+    m_pending_impulse_response_size = std::min(impulse_response.size(), m_pending_impulse_response.size());
+    std::copy_n(impulse_response.begin(), m_pending_impulse_response_size, m_pending_impulse_response.begin());
+    auto lock = std::unique_lock(m_mutex);
+    m_is_frame_pending = true;
+    m_cv.notify_one();
+}
+
+std::shared_ptr<const Carrier_Analysis> Carrier_Analyser::get_analysis() {
+    m_last_request_ns = get_now_ns();
+    return std::atomic_load(&m_analysis);
+}
+
+void Carrier_Analyser::run() {
+    while (true) {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_is_running || m_is_frame_pending; });
+            if (!m_is_running) break;
+            std::swap(m_frame, m_pending_frame);
+            std::swap(m_impulse_response, m_pending_impulse_response);
+            m_total_symbols = m_pending_total_symbols;
+            m_impulse_response_size = m_pending_impulse_response_size;
+            m_is_frame_pending = false;
+        }
+        process_frame();
+    }
+}
+
+void Carrier_Analyser::process_frame() {
+    const size_t K = m_total_carriers;
+    const size_t total_symbols = m_total_symbols;
+    if (total_symbols == 0) return;
+    if (m_is_reset_requested.exchange(false)) {
+        m_total_frames = 0;
+    }
+
+    // sum |I|+|Q| and |z|^2 of each carrier over every symbol
+    std::fill(m_frame_amplitude_sum.begin(), m_frame_amplitude_sum.end(), 0.0f);
+    std::fill(m_frame_power_sum.begin(), m_frame_power_sum.end(), 0.0f);
+    for (size_t symbol = 0; symbol < total_symbols; symbol++) {
+        const auto* row = &m_frame[symbol*K];
+        volk_32fc_magnitude_squared_32f(m_scratch.data(), reinterpret_cast<const lv_32fc_t*>(row), (unsigned int)K);
+        volk_32f_x2_add_32f(m_frame_power_sum.data(), m_frame_power_sum.data(), m_scratch.data(), (unsigned int)K);
+        const float* row_iq = reinterpret_cast<const float*>(row);
+        for (size_t k = 0; k < K; k++) {
+            m_frame_amplitude_sum[k] += std::abs(row_iq[2*k+0]) + std::abs(row_iq[2*k+1]);
+        }
+    }
+
+    const float frame_scale = 1.0f / float(total_symbols);
+    volk_32f_s32f_multiply_32f(m_frame_amplitude_sum.data(), m_frame_amplitude_sum.data(), frame_scale, (unsigned int)K);
+    volk_32f_s32f_multiply_32f(m_frame_power_sum.data(), m_frame_power_sum.data(), frame_scale, (unsigned int)K);
+    if (m_total_frames == 0) {
+        m_amplitude_average = m_frame_amplitude_sum;
+        m_power_average = m_frame_power_sum;
+    } else {
+        for (size_t k = 0; k < K; k++) {
+            m_amplitude_average[k] += AVERAGE_ALPHA*(m_frame_amplitude_sum[k] - m_amplitude_average[k]);
+            m_power_average[k] += AVERAGE_ALPHA*(m_frame_power_sum[k] - m_power_average[k]);
+        }
+    }
+    m_total_frames++;
+
+    auto previous_analysis = std::atomic_load(&m_analysis);
+    auto analysis = std::make_shared<Carrier_Analysis>();
+    analysis->version = (previous_analysis != nullptr) ? (previous_analysis->version+1) : 1;
+    analysis->total_frames = m_total_frames;
+    analysis->mer_db.resize(K);
+    analysis->magnitude_db.resize(K);
+
+    // NOTE: With A = E[|I|+|Q|] and P = E[|z|^2] the ideal point is at A/2 on each axis
+    //       so the signal power is A^2/2 and the error power is P - A^2/2
+    float mer_sum = 0.0f;
+    float amplitude_sum = 0.0f;
+    analysis->min_mer_db = MAX_MER_DB;
+    for (size_t k = 0; k < K; k++) {
+        const float A = m_amplitude_average[k];
+        const float signal_power = 0.5f*A*A;
+        const float error_power = std::max(m_power_average[k] - signal_power, signal_power*1e-6f);
+        const float mer = (signal_power > 0.0f) ? std::min(10.0f*std::log10(signal_power/error_power), MAX_MER_DB) : 0.0f;
+        analysis->mer_db[k] = mer;
+        mer_sum += mer;
+        amplitude_sum += A;
+        if (mer < analysis->min_mer_db) {
+            analysis->min_mer_db = mer;
+            analysis->min_mer_carrier = k;
+        }
+    }
+    analysis->average_mer_db = mer_sum / float(K);
+
+    // the differential output scales with |H|^2 so this is already a power ratio
+    const float amplitude_mean = amplitude_sum / float(K);
+    for (size_t k = 0; k < K; k++) {
+        analysis->magnitude_db[k] = (amplitude_mean > 0.0f) ? to_db(m_amplitude_average[k] / amplitude_mean) : MIN_LEVEL_DB;
+    }
+    m_scratch = analysis->magnitude_db;
+    const size_t low_index = K/20;
+    const size_t high_index = K - 1 - K/20;
+    std::nth_element(m_scratch.begin(), m_scratch.begin()+low_index, m_scratch.end());
+    const float low = m_scratch[low_index];
+    std::nth_element(m_scratch.begin(), m_scratch.begin()+high_index, m_scratch.end());
+    const float high = m_scratch[high_index];
+    analysis->magnitude_ripple_db = high - low;
+
+    update_impulse_response(*analysis);
+    std::atomic_store(&m_analysis, std::shared_ptr<const Carrier_Analysis>(analysis));
+}
+
+void Carrier_Analyser::update_impulse_response(Carrier_Analysis& analysis) {
+    const size_t N = m_impulse_response_size;
+    if (N == 0) return;
+    const float resolution_us = 1e6f / m_sample_rate;
+    const size_t total_pre_bins = std::min(N/4, size_t(PRE_PEAK_IMPULSE_RESPONSE_US / resolution_us));
+    const size_t total_post_bins = std::min(N/2, size_t(MAX_IMPULSE_RESPONSE_US / resolution_us));
+    const size_t total_bins = total_pre_bins + total_post_bins;
+
+    // NOTE: Each frame is aligned to its own main peak so timing drift doesn't smear the average
+    const auto impulse_response = tcb::span<const float>(m_impulse_response.data(), N);
+    const size_t peak_index = size_t(std::max_element(impulse_response.begin(), impulse_response.end()) - impulse_response.begin());
+    const float peak_db = impulse_response[peak_index];
+    const bool is_first_frame = (m_total_frames == 1) || (m_impulse_power_average.size() != total_bins);
+    m_impulse_power_average.resize(total_bins);
+    for (size_t i = 0; i < total_bins; i++) {
+        const size_t index = (peak_index + N - total_pre_bins + i) % N;
+        const float power = std::pow(10.0f, (impulse_response[index] - peak_db) / 10.0f);
+        if (is_first_frame) {
+            m_impulse_power_average[i] = power;
+        } else {
+            m_impulse_power_average[i] += AVERAGE_ALPHA*(power - m_impulse_power_average[i]);
+        }
+    }
+
+    analysis.impulse_response_start_us = -float(total_pre_bins) * resolution_us;
+    analysis.impulse_response_resolution_us = resolution_us;
+    analysis.impulse_response_db.resize(total_bins);
+    const float peak = m_impulse_power_average[total_pre_bins];
+    for (size_t i = 0; i < total_bins; i++) {
+        analysis.impulse_response_db[i] = (peak > 0.0f) ? to_db(m_impulse_power_average[i] / peak) : MIN_LEVEL_DB;
+    }
+
+    analysis.echo_delay_us = 0.0f;
+    analysis.echo_level_db = MIN_LEVEL_DB;
+    for (size_t i = 1; i < total_bins; i++) {
+        // skip the main lobe and only count local maxima so its tail isn't picked
+        const size_t distance = (i > total_pre_bins) ? (i - total_pre_bins) : (total_pre_bins - i);
+        if (distance < ECHO_SEARCH_START) continue;
+        const float level = analysis.impulse_response_db[i];
+        if (level < analysis.impulse_response_db[i-1]) continue;
+        if ((i+1 < total_bins) && (level < analysis.impulse_response_db[i+1])) continue;
+        if (level <= analysis.echo_level_db) continue;
+        analysis.echo_level_db = level;
+        analysis.echo_delay_us = (float(i) - float(total_pre_bins)) * resolution_us;
+    }
+}
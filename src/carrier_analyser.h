@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+
+// Per carrier view of the ofdm signal used to tell multipath, narrowband interference and frequency offsets apart
+struct Carrier_Analysis {
+    uint64_t version = 0;
+    uint64_t total_frames = 0;
+    // one value per data carrier ordered from the lowest to the highest frequency
+    std::vector<float> mer_db;
+    std::vector<float> magnitude_db; // normalised so the average carrier is 0dB
+    // channel impulse response from the correlation against the phase reference symbol
+    // in dB relative to the main peak, starting before the peak so that pre-echoes are shown
+    std::vector<float> impulse_response_db;
+    float impulse_response_start_us = 0.0f;
+    float impulse_response_resolution_us = 0.0f;
+    // summary
+    float average_mer_db = 0.0f;
+    float min_mer_db = 0.0f;
+    size_t min_mer_carrier = 0;
+    float magnitude_ripple_db = 0.0f; // spread between the 5th and 95th percentile magnitudes
+    float echo_delay_us = 0.0f;       // delay of the strongest echo relative to the main peak
+    float echo_level_db = 0.0f;
+};
+
+// Analyses demodulated frames on a worker thread
+// - The demodulator thread only copies a few evenly spaced symbols and the impulse response into a
+//   preallocated slot, and drops the frame if the worker is busy
+// - The impulse response is the demodulator's correlation against the phase reference symbol
+//   which it computes anyway for fine time sync
+// - Results are published as an immutable snapshot that is cheap to query from any thread
+// - Frames are ignored unless the analysis has been queried recently
+class Carrier_Analyser
+{
+private:
+    const size_t m_total_carriers;
+    const size_t m_fft_size;
+    const float m_sample_rate;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // NOTE: Preallocated so that the demodulator thread never allocates
+    std::vector<std::complex<float>> m_pending_frame;
+    size_t m_pending_total_symbols;
+    std::vector<float> m_pending_impulse_response;
+    size_t m_pending_impulse_response_size;
+    bool m_is_frame_pending;
+    bool m_is_running;
+    std::atomic<int64_t> m_last_request_ns;
+    std::atomic<bool> m_is_reset_requested;
+    // NOTE: Accessed with std::atomic_load/atomic_store
+    std::shared_ptr<const Carrier_Analysis> m_analysis;
+    std::unique_ptr<std::thread> m_thread;
+    // worker state
+    std::vector<std::complex<float>> m_frame;
+    size_t m_total_symbols;
+    std::vector<float> m_impulse_response;
+    size_t m_impulse_response_size;
+    std::vector<float> m_scratch;
+    std::vector<float> m_frame_amplitude_sum;
+    std::vector<float> m_frame_power_sum;
+    std::vector<float> m_amplitude_average;
+    std::vector<float> m_power_average;
+    std::vector<float> m_impulse_power_average;
+    uint64_t m_total_frames;
+public:
+    Carrier_Analyser(size_t total_carriers, size_t fft_size, float sample_rate);
+    ~Carrier_Analyser();
+    Carrier_Analyser(const Carrier_Analyser&) = delete;
+    Carrier_Analyser& operator=(const Carrier_Analyser&) = delete;
+    // called from the demodulator thread, never blocks on the analysis
+    // impulse_response is the demodulator's phase reference correlation in dB
+    void push_frame(tcb::span<const std::complex<float>> data, tcb::span<const float> impulse_response);
+    // returns nullptr until a frame has been analysed
+    std::shared_ptr<const Carrier_Analysis> get_analysis();
+    void reset() { m_is_reset_requested = true; }
+private:
+    bool is_requested() const;
+    void run();
+    void process_frame();
+    void update_impulse_response(Carrier_Analysis& analysis);
+};
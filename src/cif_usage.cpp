@@ -0,0 +1,35 @@
+#include "./cif_usage.h"
+#include <algorithm>
+#include "./radio_snapshot.h"
+
+static bool is_channel_in_use(const Radio_Channel_Snapshot& channel) {
+    if (channel.audio_channel == nullptr) return false;
+    return channel.is_decode_audio || channel.is_play_audio || channel.is_decode_data;
+}
+
+Cif_Usage create_cif_usage(const Radio_Snapshot& snapshot) {
+    Cif_Usage usage;
+    if (snapshot.database == nullptr) return usage;
+    std::bitset<Cif_Usage::TOTAL_CAPACITY_UNITS> multiplex;
+    std::bitset<Cif_Usage::TOTAL_CAPACITY_UNITS> data_packet;
+    for (const auto& subchannel: snapshot.database->subchannels) {
+        // NOTE: Subchannels are only complete once the fic has described their size
+        if (subchannel.length == 0) continue;
+        const size_t start = std::min(size_t(subchannel.start_address), Cif_Usage::TOTAL_CAPACITY_UNITS);
+        const size_t end = std::min(start + size_t(subchannel.length), Cif_Usage::TOTAL_CAPACITY_UNITS);
+        for (size_t i = start; i < end; i++) multiplex.set(i);
+
+        const auto* channel = snapshot.find_channel(subchannel.id);
+        if (channel == nullptr) continue;
+        if (channel->data_packet_channel != nullptr) {
+            for (size_t i = start; i < end; i++) data_packet.set(i);
+        }
+        if (!is_channel_in_use(*channel)) continue;
+        usage.subchannels.push_back(subchannel.id);
+        for (size_t i = start; i < end; i++) usage.capacity_units.set(i);
+    }
+    usage.total_capacity_units = usage.capacity_units.count();
+    usage.total_data_packet_capacity_units = data_packet.count();
+    usage.total_multiplex_capacity_units = multiplex.count();
+    return usage;
+}
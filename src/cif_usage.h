@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <bitset>
+#include <vector>
+#include "dab/database/dab_database_types.h"
+
+struct Radio_Snapshot;
+
+// Capacity units of the common interleaved frame that the subchannels in use occupy
+// NOTE: This is only shown in the gui, it doesn't change which subchannels the decoder processes
+// - Audio channels are in use if their audio or data is enabled in their channel controls
+// - Data packet channels have no controls so they are counted separately
+// NOTE: This uses the transmission mode I layout which is the only mode the plugin demodulates
+struct Cif_Usage {
+    static constexpr size_t TOTAL_CAPACITY_UNITS = 864;
+    static constexpr size_t CAPACITY_UNIT_BITS = 64;
+    std::vector<subchannel_id_t> subchannels;
+    std::bitset<TOTAL_CAPACITY_UNITS> capacity_units;
+    size_t total_capacity_units = 0;
+    // capacity units of data packet channels which are decoded regardless of the channel controls
+    size_t total_data_packet_capacity_units = 0;
+    // capacity units that were occupied by any subchannel in the multiplex
+    size_t total_multiplex_capacity_units = 0;
+};
+
+// NOTE: The snapshot's database and channels must already be filled in
+Cif_Usage create_cif_usage(const Radio_Snapshot& snapshot);
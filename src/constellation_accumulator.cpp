@@ -0,0 +1,168 @@
+#include "./constellation_accumulator.h"
+#include <algorithm>
+#include <cmath>
+#include <volk/volk.h>
+
+// NOTE: Stop accumulating if the gui hasn't asked for the image for this long
+constexpr auto REQUEST_TIMEOUT = std::chrono::seconds(1);
+constexpr float DEFAULT_DECAY = 0.85f;
+// ideal pi/4-DQPSK points sit on the diagonals at unit magnitude
+constexpr float IDEAL_AMPLITUDE = 0.70710678f;
+
+static int64_t get_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// black -> purple -> red -> orange -> pale yellow
+static uint32_t get_heatmap_colour(float x) {
+    constexpr int TOTAL_STOPS = 5;
+    constexpr uint8_t STOPS[TOTAL_STOPS][3] = {
+        {   0,   0,   0 },
+        {  80,  18, 123 },
+        { 200,  40,  70 },
+        { 250, 140,  10 },
+        { 252, 255, 164 },
+    };
+    x = std::clamp(x, 0.0f, 1.0f) * float(TOTAL_STOPS-1);
+    const int i = std::min(int(x), TOTAL_STOPS-2);
+    const float t = x - float(i);
+    uint32_t rgba = 0xFF000000;
+    for (int c = 0; c < 3; c++) {
+        const float v = float(STOPS[i][c])*(1.0f-t) + float(STOPS[i+1][c])*t;
+        rgba |= uint32_t(v) << (c*8);
+    }
+    return rgba;
+}
+
+Constellation_Accumulator::Constellation_Accumulator(size_t max_frame_points)
+: m_pending_frame_size(0), m_is_frame_pending(false), m_is_running(true), m_frame_size(0),
+  m_histogram(TOTAL_BINS*TOTAL_BINS, 0.0f), m_decay(DEFAULT_DECAY), m_last_request_ns(0), m_is_reset_requested(false),
+  m_error_power(0.0f), m_is_error_init(false)
+{
+    m_pending_frame.resize(max_frame_points);
+    m_frame.resize(max_frame_points);
+    m_scratch.resize(max_frame_points*2);
+    m_image.rgba.resize(TOTAL_BINS*TOTAL_BINS, 0xFF000000);
+    m_thread = std::make_unique<std::thread>([this]() { run(); });
+}
+
+Constellation_Accumulator::~Constellation_Accumulator() {
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_is_running = false;
+        m_cv.notify_all();
+    }
+    m_thread->join();
+}
+
+bool Constellation_Accumulator::is_requested() const {
+    const int64_t timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(REQUEST_TIMEOUT).count();
+    return (get_now_ns() - m_last_request_ns) < timeout_ns;
+}
+
+void Constellation_Accumulator::push_frame(tcb::span<const std::complex<float>> data) {
+    if (data.empty() || !is_requested()) return;
+    {
+        auto lock = std::unique_lock(m_mutex);
+        // NOTE: Drop the frame if the worker hasn't picked up the last one
+        if (m_is_frame_pending) return;
+    }
+    // NOTE: The worker only touches the pending slot while it is marked as pending so it is filled without the lock
+    m_pending_frame_size = std::min(data.size(), m_pending_frame.size());
+    std::copy_n(data.begin(), m_pending_frame_size, m_pending_frame.begin());
+    auto lock = std::unique_lock(m_mutex);
+    m_is_frame_pending = true;
+    m_cv.notify_one();
+}
+
+void Constellation_Accumulator::run() {
+    while (true) {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_is_running || m_is_frame_pending; });
+            if (!m_is_running) break;
+            std::swap(m_frame, m_pending_frame);
+            m_frame_size = m_pending_frame_size;
+            m_is_frame_pending = false;
+        }
+        process_frame();
+    }
+}
+
+void Constellation_Accumulator::process_frame() {
+    const size_t N = m_frame_size;
+    if (N == 0) return;
+    const auto data = tcb::span<const std::complex<float>>(m_frame.data(), N);
+
+    // normalise to unit rms power
+    volk_32fc_magnitude_squared_32f(m_scratch.data(), reinterpret_cast<const lv_32fc_t*>(data.data()), (unsigned int)N);
+    float total_power = 0.0f;
+    volk_32f_accumulator_s32f(&total_power, m_scratch.data(), (unsigned int)N);
+    const float mean_power = total_power / float(N);
+    if (!std::isfinite(mean_power) || (mean_power <= 0.0f)) return;
+    const float bin_scale = float(TOTAL_BINS) / (2.0f*RANGE);
+    // NOTE: Scale straight into bin units so the loop below is only an offset and a cast
+    volk_32f_s32f_multiply_32f(
+        m_scratch.data(), reinterpret_cast<const float*>(data.data()),
+        bin_scale / std::sqrt(mean_power), (unsigned int)(N*2)
+    );
+
+    if (m_is_reset_requested.exchange(false)) {
+        std::fill(m_histogram.begin(), m_histogram.end(), 0.0f);
+        m_is_error_init = false;
+    }
+    const float decay = m_decay;
+    volk_32f_s32f_multiply_32f(m_histogram.data(), m_histogram.data(), decay, (unsigned int)m_histogram.size());
+
+    const float bin_offset = float(TOTAL_BINS)*0.5f;
+    const float ideal_bin = IDEAL_AMPLITUDE*bin_scale;
+    float error_sum = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        const float I = m_scratch[2*i+0];
+        const float Q = m_scratch[2*i+1];
+        const float dI = std::abs(I) - ideal_bin;
+        const float dQ = std::abs(Q) - ideal_bin;
+        error_sum += dI*dI + dQ*dQ;
+        // NOTE: Y is flipped so positive Q is at the top of the image
+        const int x = int(std::floor(I + bin_offset));
+        const int y = int(std::floor(bin_offset - Q));
+        if ((x < 0) || (x >= int(TOTAL_BINS)) || (y < 0) || (y >= int(TOTAL_BINS))) continue;
+        m_histogram[size_t(y)*TOTAL_BINS + size_t(x)] += 1.0f;
+    }
+    // convert back from bin units where the ideal points have unit power
+    const float error_power = (error_sum / float(N)) / (bin_scale*bin_scale);
+    if (!m_is_error_init) {
+        m_error_power = error_power;
+        m_is_error_init = true;
+    } else {
+        m_error_power = m_error_power*decay + error_power*(1.0f-decay);
+    }
+    update_image(N, m_error_power);
+}
+
+void Constellation_Accumulator::update_image(size_t total_points, float error_power) {
+    const float max_density = *std::max_element(m_histogram.begin(), m_histogram.end());
+    const float norm = (max_density > 0.0f) ? (1.0f / std::log1p(max_density)) : 0.0f;
+    auto lock = std::unique_lock(m_mutex_image);
+    for (size_t i = 0; i < m_histogram.size(); i++) {
+        m_image.rgba[i] = get_heatmap_colour(std::log1p(m_histogram[i]) * norm);
+    }
+    m_image.version++;
+    m_image.total_points = total_points;
+    m_image.evm_rms = std::sqrt(error_power) * 100.0f;
+    m_image.mer_db = (error_power > 0.0f) ? (-10.0f*std::log10(error_power)) : 0.0f;
+}
+
+bool Constellation_Accumulator::get_image(Image& image, uint64_t last_version) {
+    m_last_request_ns = get_now_ns();
+    auto lock = std::unique_lock(m_mutex_image);
+    if (m_image.version == last_version) return false;
+    image = m_image;
+    return true;
+}
+
+void Constellation_Accumulator::reset() {
+    // NOTE: The histogram belongs to the worker thread so it is cleared on the next frame
+    m_is_reset_requested = true;
+}
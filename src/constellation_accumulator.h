@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+
+// Decaying 2D density histogram of every carrier of every symbol in the ofdm frame
+// - The demodulator thread only copies the frame into a preallocated slot and drops it if the worker is busy
+// - Frames are binned on a worker thread after being normalised to unit rms power
+// - The histogram is colour mapped into an rgba image on the worker so the gui only has to upload it
+// - Error vector magnitude is measured against the nearest ideal pi/4-DQPSK point
+// - Frames are ignored unless the gui has asked for the image recently so this costs nothing when hidden
+class Constellation_Accumulator
+{
+public:
+    static constexpr size_t TOTAL_BINS = 128;
+    // the histogram covers [-RANGE,+RANGE] on both axes where ideal points have a magnitude of 1
+    static constexpr float RANGE = 2.0f;
+    struct Image {
+        uint64_t version = 0;
+        std::vector<uint32_t> rgba;
+        float evm_rms = 0.0f;       // percentage
+        float mer_db = 0.0f;
+        size_t total_points = 0;    // in the last frame
+    };
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // NOTE: Preallocated so that the demodulator thread never allocates
+    std::vector<std::complex<float>> m_pending_frame;
+    size_t m_pending_frame_size;
+    bool m_is_frame_pending;
+    bool m_is_running;
+    std::unique_ptr<std::thread> m_thread;
+    // worker state
+    std::vector<std::complex<float>> m_frame;
+    size_t m_frame_size;
+    std::vector<float> m_histogram;
+    std::vector<float> m_scratch;
+    std::atomic<float> m_decay;
+    std::atomic<int64_t> m_last_request_ns;
+    std::atomic<bool> m_is_reset_requested;
+    std::mutex m_mutex_image;
+    Image m_image;
+    // average error power is smoothed with the same decay as the histogram
+    float m_error_power;
+    bool m_is_error_init;
+public:
+    // max_frame_points is the most carriers over every symbol that a frame can have
+    explicit Constellation_Accumulator(size_t max_frame_points);
+    ~Constellation_Accumulator();
+    Constellation_Accumulator(const Constellation_Accumulator&) = delete;
+    Constellation_Accumulator& operator=(const Constellation_Accumulator&) = delete;
+    // called from the demodulator thread after each frame, never blocks on the binning
+    void push_frame(tcb::span<const std::complex<float>> data);
+    // called by the gui to keep accumulating and to get the latest image
+    // returns false if the image hasn't changed since last_version
+    bool get_image(Image& image, uint64_t last_version);
+    void reset();
+    // fraction of the histogram kept each frame
+    void set_decay(float decay) { m_decay = decay; }
+    float get_decay() const { return m_decay; }
+private:
+    bool is_requested() const;
+    void run();
+    void process_frame();
+    void update_image(size_t total_points, float error_power);
+};
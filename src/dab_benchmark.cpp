@@ -0,0 +1,284 @@
+// Headless benchmark that pushes a recording through Radio_Block as fast as possible
+// Usage: dab_benchmark <recording.cf32|cs16|cs8> [options]
+//   --ofdm-threads 1,2,4   ofdm demodulator thread counts to test
+//   --dab-threads 1,2      dab decoder thread counts to test
+//   --subchannels 0,1,4    number of audio subchannels to decode
+//   --max-seconds N        only use the first N seconds of the recording
+//   --output <path>        write json results to a file instead of stdout
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include "./radio_block.h"
+#include "./thread_pool_controller.h"
+#include "./pipeline_telemetry.h"
+#include "./iq_replay_file.h"
+#include "ofdm/dab_ofdm_params_ref.h"
+#include "basic_radio/basic_audio_channel.h"
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+constexpr float OFDM_SAMPLE_RATE = 2.048e6f;
+constexpr int TRANSMISSION_MODE = 1;
+constexpr size_t IQ_BLOCK_SIZE = 65536;
+constexpr size_t AUDIO_BLOCK_SIZE = 4096;
+constexpr float AUDIO_SAMPLE_RATE = 48000.0f;
+
+struct Benchmark_Config {
+    size_t total_ofdm_threads = 1;
+    size_t total_dab_threads = 1;
+    size_t total_subchannels = 0;
+};
+
+// Pulls from the audio pipeline as fast as it can so that decoded audio is mixed but not played
+class Null_Audio_Sink: public AudioPipelineSink
+{
+private:
+    std::mutex m_mutex_callback;
+    std::atomic<bool> m_is_running;
+    std::unique_ptr<std::thread> m_thread;
+public:
+    Null_Audio_Sink(): m_is_running(false), m_thread(nullptr) {}
+    ~Null_Audio_Sink() override { set_callback(nullptr); }
+    void set_callback(AudioPipelineSink::Callback callback) override {
+        auto lock = std::unique_lock(m_mutex_callback);
+        m_is_running = false;
+        if (m_thread != nullptr) m_thread->join();
+        m_thread = nullptr;
+        if (callback == nullptr) return;
+        m_is_running = true;
+        m_thread = std::make_unique<std::thread>([this, callback]() {
+            auto buf = std::vector<Frame<float>>(AUDIO_BLOCK_SIZE);
+            while (m_is_running) {
+                const size_t total_read = callback(buf, AUDIO_SAMPLE_RATE);
+                if (total_read == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    std::string_view get_name() const override { return "null_sink"; }
+};
+
+static uint64_t get_peak_rss_bytes() {
+#if _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return uint64_t(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if __APPLE__
+    return uint64_t(usage.ru_maxrss);
+#else
+    // NOTE: Linux reports this in kilobytes
+    return uint64_t(usage.ru_maxrss)*1024;
+#endif
+#endif
+}
+
+static std::string escape_json_string(std::string_view str) {
+    std::string out;
+    for (const char c: str) {
+        if ((c == '"') || (c == '\\')) out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static std::vector<size_t> parse_list(std::string_view str) {
+    std::vector<size_t> values;
+    while (!str.empty()) {
+        const size_t index = str.find(',');
+        const auto token = std::string(str.substr(0, index));
+        values.push_back(size_t(strtoull(token.c_str(), nullptr, 10)));
+        if (index == std::string_view::npos) break;
+        str = str.substr(index+1);
+    }
+    return values;
+}
+
+static size_t enable_audio_subchannels(BasicRadio& radio, size_t total_subchannels) {
+    auto lock = std::unique_lock(radio.GetMutex());
+    auto& db = radio.GetDatabase();
+    size_t total_enabled = 0;
+    for (auto& subchannel: db.subchannels) {
+        if (total_enabled >= total_subchannels) break;
+        auto* channel = radio.Get_Audio_Channel(subchannel.id);
+        if (channel == nullptr) continue;
+        auto& controls = channel->GetControls();
+        if (!controls.GetIsPlayAudio() || !controls.GetIsDecodeData()) {
+            controls.RunAll();
+        }
+        total_enabled++;
+    }
+    return total_enabled;
+}
+
+static std::string run_benchmark(const IQ_Replay_File& file, size_t total_samples, const Benchmark_Config& config) {
+    auto controller = std::make_shared<Thread_Pool_Controller>();
+    controller->get_settings().is_adaptive = false;
+    controller->set_ofdm_total_threads(config.total_ofdm_threads);
+    controller->set_dab_total_threads(config.total_dab_threads);
+    auto block = std::make_unique<Radio_Block>(controller);
+    block->set_is_lossless(true);
+    block->set_audio_sink(std::make_unique<Null_Audio_Sink>());
+
+    // NOTE: Subchannels only show up once the fic has been decoded so keep enabling them as we go
+    const size_t subchannel_update_period = size_t(OFDM_SAMPLE_RATE);
+    size_t next_subchannel_update = 0;
+    size_t total_subchannels_enabled = 0;
+    std::vector<std::complex<float>> scratch;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < total_samples; offset += IQ_BLOCK_SIZE) {
+        const size_t length = std::min(IQ_BLOCK_SIZE, total_samples-offset);
+        auto samples = file.read(offset, length, scratch);
+        if (!block->process_iq_blocking(samples)) break;
+        if ((config.total_subchannels > 0) && (offset >= next_subchannel_update)) {
+            next_subchannel_update = offset + subchannel_update_period;
+            auto radio = block->get_basic_radio();
+            total_subchannels_enabled = enable_audio_subchannels(*radio, config.total_subchannels);
+        }
+    }
+    // wait for the pipeline to drain
+    while ((block->get_iq_buffer_available() >= block->get_iq_batch_size()) || (block->get_total_frames_queued() > 0)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double wall_seconds = std::chrono::duration<double>(end-start).count();
+    const double signal_seconds = double(total_samples) / double(OFDM_SAMPLE_RATE);
+
+    auto demod = block->get_ofdm_demodulator();
+    // NOTE: Peak rss covers the whole process so it only grows between runs
+    auto result = fmt::format(
+        "{{\"ofdm_threads\": {}, \"dab_threads\": {}, \"subchannels_requested\": {}, \"subchannels_enabled\": {}, "
+        "\"wall_seconds\": {:.3f}, \"signal_seconds\": {:.3f}, \"realtime_factor\": {:.3f}, "
+        "\"frames_read\": {}, \"frames_desynced\": {}, \"frames_dropped\": {}, \"iq_overruns\": {}, "
+        "\"peak_rss_bytes\": {}, \"telemetry\": {}}}",
+        config.total_ofdm_threads, config.total_dab_threads, config.total_subchannels, total_subchannels_enabled,
+        wall_seconds, signal_seconds, (wall_seconds > 0.0) ? (signal_seconds/wall_seconds) : 0.0,
+        demod->GetTotalFramesRead(), demod->GetTotalFramesDesync(),
+        block->get_total_frames_dropped(), block->get_total_iq_overruns(),
+        get_peak_rss_bytes(), block->get_telemetry()->to_json()
+    );
+    return result;
+}
+
+static void print_usage(const char* name) {
+    fprintf(stderr,
+        "Usage: %s <recording.cf32|cs16|cs8> [options]\n"
+        "  --ofdm-threads <list>   comma separated ofdm thread counts (default 1,2,4)\n"
+        "  --dab-threads <list>    comma separated dab thread counts (default 1,2)\n"
+        "  --subchannels <list>    comma separated number of audio subchannels (default 0,1,4)\n"
+        "  --max-seconds <N>       only use the first N seconds of the recording\n"
+        "  --output <path>         write json results to a file instead of stdout\n",
+        name
+    );
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string filepath = argv[1];
+    auto ofdm_threads = std::vector<size_t>{1,2,4};
+    auto dab_threads = std::vector<size_t>{1,2};
+    auto subchannels = std::vector<size_t>{0,1,4};
+    double max_seconds = 0.0;
+    std::string output_filepath;
+    for (int i = 2; i < argc; i++) {
+        const auto arg = std::string_view(argv[i]);
+        if (i+1 >= argc) {
+            fprintf(stderr, "Missing value for '%s'\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--ofdm-threads") {
+            ofdm_threads = parse_list(value);
+        } else if (arg == "--dab-threads") {
+            dab_threads = parse_list(value);
+        } else if (arg == "--subchannels") {
+            subchannels = parse_list(value);
+        } else if (arg == "--max-seconds") {
+            max_seconds = strtod(value, nullptr);
+        } else if (arg == "--output") {
+            output_filepath = value;
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", argv[i-1]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const auto ofdm_params = get_DAB_OFDM_params(TRANSMISSION_MODE);
+    IQ_Replay_File::Frame_Timing timing;
+    timing.null_period = size_t(ofdm_params.nb_null_period);
+    timing.frame_period = timing.null_period + size_t(ofdm_params.nb_symbol_period)*size_t(ofdm_params.nb_frame_symbols);
+    auto file = IQ_Replay_File::open(filepath, timing);
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open recording '%s'\n", filepath.c_str());
+        return 1;
+    }
+    size_t total_samples = file->get_total_samples();
+    if (max_seconds > 0.0) {
+        total_samples = std::min(total_samples, size_t(max_seconds*double(OFDM_SAMPLE_RATE)));
+    }
+
+    std::vector<std::string> results;
+    for (const size_t total_ofdm_threads: ofdm_threads) {
+        for (const size_t total_dab_threads: dab_threads) {
+            for (const size_t total_subchannels: subchannels) {
+                Benchmark_Config config;
+                config.total_ofdm_threads = total_ofdm_threads;
+                config.total_dab_threads = total_dab_threads;
+                config.total_subchannels = total_subchannels;
+                fprintf(stderr, "Running ofdm_threads=%zu dab_threads=%zu subchannels=%zu\n",
+                    total_ofdm_threads, total_dab_threads, total_subchannels);
+                results.push_back(run_benchmark(*file, total_samples, config));
+            }
+        }
+    }
+
+    fmt::memory_buffer out;
+    auto it = std::back_inserter(out);
+    fmt::format_to(it,
+        "{{\n\"file\": \"{}\", \"format\": \"{}\", \"sample_rate\": {:.0f}, \"total_samples\": {}, "
+        "\"total_cores\": {},\n\"results\": [\n",
+        escape_json_string(filepath), get_iq_format_extension(file->get_format()), OFDM_SAMPLE_RATE, total_samples,
+        std::thread::hardware_concurrency()
+    );
+    for (size_t i = 0; i < results.size(); i++) {
+        fmt::format_to(it, "{}{}\n", results[i], (i+1 < results.size()) ? "," : "");
+    }
+    fmt::format_to(it, "]\n}}\n");
+    const auto json = fmt::to_string(out);
+
+    if (output_filepath.empty()) {
+        fwrite(json.data(), 1, json.size(), stdout);
+        return 0;
+    }
+    FILE* fp = fopen(output_filepath.c_str(), "w");
+    if (fp == nullptr) {
+        fprintf(stderr, "Failed to open output '%s'\n", output_filepath.c_str());
+        return 1;
+    }
+    fwrite(json.data(), 1, json.size(), fp);
+    fclose(fp);
+    return 0;
+}
@@ -1,85 +1,124 @@
 #include "./dab_module.h"
 #include <complex>
+#include <cmath>
+#include <algorithm>
 #include <string>
 #include <thread>
 #include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <optional>
 #include <stdint.h>
+#include <fmt/core.h>
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
+// NOTE: gui/gui.h for some reason has defines for min/max
 #include <gui/gui.h>
+#undef min
+#undef max
 #include <gui/style.h>
 #include <module.h>
 #include <dsp/sink.h>
 #include <signal_path/signal_path.h>
 #include "./radio_block.h"
 #include "./render_radio_block.h"
+#include "./thread_pool_controller.h"
+#include "./wideband_channelizer.h"
+#include "./pipeline_telemetry.h"
+#include "./iq_recorder.h"
+#include "./iq_replay.h"
+#include "./iq_replay_file.h"
+#include "./radio_snapshot.h"
+#include "./slideshow_disk_cache.h"
+#include "./ensemble_database_cache.h"
+#include "./ofdm_sync_cache.h"
+#include "./audio_player.h"
+#include "./audio_recorder.h"
+#include "./async_file_writer.h"
 #include "utility/span.h"
 
 ConfigManager config; // extern
 
+constexpr float OFDM_SAMPLE_RATE = 2.048e6f;
+// NOTE: Ensembles have a bandwidth of 1.536MHz so we pass up to 0.85MHz and reject past the 1.024MHz nyquist
+constexpr float WIDEBAND_CUTOFF_HZ = 0.85e6f;
+constexpr size_t WIDEBAND_TAPS_PER_PHASE = 32;
+constexpr float WIDEBAND_SAMPLE_RATES[] = { 4.096e6f, 6.144e6f, 8.192e6f, 10.24e6f };
+constexpr IQ_Format IQ_RECORDER_FORMATS[] = { IQ_Format::CS8, IQ_Format::CS16, IQ_Format::CF32 };
+constexpr int DEFAULT_SLIDESHOW_DISK_CACHE_MB = 64;
+constexpr float DEFAULT_AUDIO_BLOCK_SIZE_SECONDS = 0.1f;
+// NOTE: A 48kHz stereo service is 192kB/s so 16MB rides out a slow disk for a dozen services
+constexpr size_t AUDIO_WRITER_BLOCK_SIZE = 1u << 18;
+constexpr size_t AUDIO_WRITER_TOTAL_BLOCKS = 64;
+constexpr size_t AUDIO_WRITER_TOTAL_THREADS = 2;
+
+static std::filesystem::path GetRecordingsDirectory() {
+    return std::filesystem::path(core::args["root"].s()) / "recordings";
+}
+
+struct DAB_Channel_Frequency {
+    const char* label;
+    double frequency;
+};
+
+// Band III channel allocations
+static const DAB_Channel_Frequency DAB_BAND_III_CHANNELS[] = {
+    {"5A", 174.928e6}, {"5B", 176.640e6}, {"5C", 178.352e6}, {"5D", 180.064e6},
+    {"6A", 181.936e6}, {"6B", 183.648e6}, {"6C", 185.360e6}, {"6D", 187.072e6},
+    {"7A", 188.928e6}, {"7B", 190.640e6}, {"7C", 192.352e6}, {"7D", 194.064e6},
+    {"8A", 195.936e6}, {"8B", 197.648e6}, {"8C", 199.360e6}, {"8D", 201.072e6},
+    {"9A", 202.928e6}, {"9B", 204.640e6}, {"9C", 206.352e6}, {"9D", 208.064e6},
+    {"10A", 209.936e6}, {"10N", 210.096e6}, {"10B", 211.648e6}, {"10C", 213.360e6}, {"10D", 215.072e6},
+    {"11A", 216.928e6}, {"11N", 217.088e6}, {"11B", 218.640e6}, {"11C", 220.352e6}, {"11D", 222.064e6},
+    {"12A", 223.936e6}, {"12N", 224.096e6}, {"12B", 225.648e6}, {"12C", 227.360e6}, {"12D", 229.072e6},
+    {"13A", 230.784e6}, {"13B", 232.496e6}, {"13C", 234.208e6}, {"13D", 235.776e6},
+    {"13E", 237.488e6}, {"13F", 239.200e6},
+};
+
+static const char* get_dab_channel_label(double frequency) {
+    for (const auto& channel: DAB_BAND_III_CHANNELS) {
+        if (std::abs(channel.frequency - frequency) < 1e3) return channel.label;
+    }
+    return "?";
+}
+
 int OFDM_Demodulator_Sink::run() {
     int count = base_type::_in->read();
     if (count < 0) return -1;
     auto* buf = base_type::_in->readBuf;
     auto block = tcb::span(reinterpret_cast<std::complex<float>*>(buf), size_t(count));
-    m_ofdm_demod->Process(block);
+    if (!m_is_bypassed) {
+        auto timer = Scoped_Stage_Timer(&m_radio_block.get_telemetry()->get_stage(Pipeline_Telemetry::Stage::IQ_INGEST));
+        if (m_iq_recorder != nullptr) {
+            m_iq_recorder->process(block);
+        }
+        m_radio_block.process_iq(block);
+    }
     base_type::_in->flush();
     return count;
 }
 
-Audio_Player_Stream::Audio_Player_Stream(float sample_rate, float block_size_seconds)
-: m_sample_rate(sample_rate), m_block_size_seconds(block_size_seconds)
-{
-    m_is_running = false;
-    m_callback = nullptr;
-    m_output_thread = nullptr;
-    m_output_stream.clearReadStop();
-    m_output_stream.clearWriteStop();
-}
+Wideband_Demodulator_Sink::Wideband_Demodulator_Sink(
+    std::unique_ptr<Wideband_Channelizer> channelizer, std::vector<Radio_Block*> radio_blocks)
+: m_channelizer(std::move(channelizer)), m_radio_blocks(radio_blocks)
+{}
 
-Audio_Player_Stream::~Audio_Player_Stream() {
-    m_output_stream.stopReader();
-    m_output_stream.stopWriter();
-    auto lock = std::unique_lock(m_mutex_callback);
-    m_is_running = false;
-    if (m_output_thread != nullptr) {
-        m_output_thread->join();
-    }
-};
+Wideband_Demodulator_Sink::~Wideband_Demodulator_Sink() {
+    if (!base_type::_block_init) return;
+    base_type::stop();
+}
 
-void Audio_Player_Stream::set_callback(AudioPipelineSink::Callback callback) {
-    auto lock = std::unique_lock(m_mutex_callback);
-    m_is_running = false;
-    if (m_output_thread != nullptr) {
-        m_output_thread->join();
-    }
-    m_callback = callback;
-    m_output_thread = nullptr;
-    if (m_callback == nullptr) return;
-    m_is_running = true;
-    m_output_thread = std::make_unique<std::thread>([this, callback]() {
-        while (m_is_running) {
-            const size_t block_size = size_t(m_sample_rate*m_block_size_seconds);
-            auto wr_buf = m_output_stream.writeBuf; // default buffer size is 1 million (we can avoid resizing)
-            static_assert(sizeof(Frame<float>) == sizeof(dsp::stereo_t));
-            auto frame_buf = tcb::span(reinterpret_cast<Frame<float>*>(wr_buf), block_size);
-            const size_t total_written = callback(frame_buf, m_sample_rate); 
-            bool is_buffer_swapped = false;
-            if (total_written > 0) {
-                is_buffer_swapped = m_output_stream.swap(int(total_written));
-            }
-            // @fix(#9): https://github.com/williamyang98/SDRPlusPlus-DAB-Radio-Plugin/issues/9
-            // buffer may not be swapped due to the following
-            // - callback did not write any samples to buffer and is not blocking
-            // - buffer swap failed because the writer was blocked which can occur if
-            //   there is no reader and write operations have been disabled 
-            // so we sleep here to avoid looping with zero blocking and consuming cpu cycles
-            if (!is_buffer_swapped) {
-                const int64_t sleep_ms = int64_t(m_block_size_seconds*1e3f);
-                std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
-            }
-        }
+int Wideband_Demodulator_Sink::run() {
+    int count = base_type::_in->read();
+    if (count < 0) return -1;
+    auto* buf = base_type::_in->readBuf;
+    auto block = tcb::span(reinterpret_cast<const std::complex<float>*>(buf), size_t(count));
+    m_channelizer->process(block, [this](size_t index, tcb::span<const std::complex<float>> channel_block) {
+        if (index >= m_radio_blocks.size()) return;
+        m_radio_blocks[index]->process_iq(channel_block);
     });
+    base_type::_in->flush();
+    return count;
 }
 
 DABModule::DABModule(std::string _name) 
@@ -87,15 +126,38 @@ DABModule::DABModule(std::string _name)
     name = _name;
     is_enabled = false;
     vfo = nullptr;
+    is_wideband = false;
+    wideband_sample_rate = 8.192e6f;
+    wideband_centre_frequency = 0.0;
+    selected_ensemble_index = 0;
+    is_vfo_tuned = false;
+    is_wideband_tuned = false;
+    vfo_offset = 0.0;
  
     // setup radio
-    radio_block = std::make_unique<Radio_Block>(1,1);
-    ofdm_demodulator_sink = std::make_unique<OFDM_Demodulator_Sink>(radio_block->get_ofdm_demodulator());
+    radio_block = std::make_unique<Radio_Block>(std::make_shared<Thread_Pool_Controller>());
+    ofdm_demodulator_sink = std::make_unique<OFDM_Demodulator_Sink>(*radio_block);
     ofdm_demodulator_sink->init(nullptr);
     radio_view_controller = std::make_unique<Radio_View_Controller>();
+    slideshow_texture_budget = Radio_View_Controller::DEFAULT_SLIDESHOW_TEXTURE_BUDGET;
+    iq_recorder = std::make_unique<IQ_Recorder>(OFDM_SAMPLE_RATE);
+    iq_recorder_format_index = 1;
+    iq_recorder_gain = 1.0f;
+    ofdm_demodulator_sink->set_iq_recorder(iq_recorder.get());
+    audio_file_writer = std::make_shared<Async_File_Writer>(
+        AUDIO_WRITER_BLOCK_SIZE, AUDIO_WRITER_TOTAL_BLOCKS, AUDIO_WRITER_TOTAL_THREADS);
+    radio_block->set_audio_recorder(std::make_shared<Audio_Recorder>(audio_file_writer, GetRecordingsDirectory().string()));
+    iq_replay = nullptr;
+    iq_replay_filepath.fill('\0');
     // setup audio
     const float DEFAULT_AUDIO_SAMPLE_RATE = 48000.0f;
-    auto audio_player_stream = std::make_unique<Audio_Player_Stream>(DEFAULT_AUDIO_SAMPLE_RATE, 0.1f);
+    auto audio_player_stream = std::make_unique<Audio_Player_Stream>(DEFAULT_AUDIO_SAMPLE_RATE, DEFAULT_AUDIO_BLOCK_SIZE_SECONDS);
+    this->audio_player_stream = audio_player_stream.get();
+    audio_block_size_seconds = audio_player_stream->get_block_size_seconds();
+    audio_target_latency_seconds = audio_player_stream->get_target_latency_seconds();
+    audio_player_stream->set_telemetry(radio_block->get_telemetry());
+    radio_block->set_audio_data_signal(audio_player_stream->get_data_signal());
+    radio_view_controller->SetAudioPlayer(audio_player_stream.get());
     ev_handler_sample_rate_change.ctx = audio_player_stream.get();
     ev_handler_sample_rate_change.handler = [](float sample_rate, void* ctx) {
         auto* stream = reinterpret_cast<Audio_Player_Stream*>(ctx);
@@ -105,8 +167,14 @@ DABModule::DABModule(std::string _name)
     audio_stream.setVolume(1.0f);
     sigpath::sinkManager.registerStream(name, &audio_stream);
     audio_stream.start();
-    auto audio_pipeline = radio_block->get_audio_pipeline();
-    audio_pipeline->set_sink(std::move(audio_player_stream));
+    radio_block->set_audio_sink(std::move(audio_player_stream));
+    // setup retune
+    ev_handler_retune.ctx = this;
+    ev_handler_retune.handler = [](double centre_frequency, void* ctx) {
+        auto* mod = reinterpret_cast<DABModule*>(ctx);
+        mod->SetTunedFrequency(centre_frequency);
+    };
+    sigpath::sourceManager.onRetune.bindHandler(&ev_handler_retune);
     // setup gui
     gui::menu.registerEntry(name, [](void *ctx) {
         auto* mod = reinterpret_cast<DABModule*>(ctx);
@@ -120,16 +188,92 @@ DABModule::DABModule(std::string _name)
         config.conf["is_enabled"] = false;
         is_modified = true;
     }
+    if (!config.conf.contains("wideband")) {
+        config.conf["wideband"]["is_enabled"] = false;
+        config.conf["wideband"]["sample_rate"] = wideband_sample_rate;
+        config.conf["wideband"]["frequencies"] = json::array();
+        is_modified = true;
+    }
+    if (!config.conf.contains("slideshow_texture_budget_mb")) {
+        config.conf["slideshow_texture_budget_mb"] = int(slideshow_texture_budget / (1024*1024));
+        is_modified = true;
+    }
+    if (!config.conf.contains("slideshow_disk_cache_mb")) {
+        config.conf["slideshow_disk_cache_mb"] = DEFAULT_SLIDESHOW_DISK_CACHE_MB;
+        is_modified = true;
+    }
+    if (!config.conf.contains("is_ensemble_cache_enabled")) {
+        config.conf["is_ensemble_cache_enabled"] = true;
+        is_modified = true;
+    }
+    if (!config.conf.contains("ofdm_sync_cache")) {
+        config.conf["ofdm_sync_cache"] = json::array();
+        is_modified = true;
+    }
+    if (!config.conf.contains("audio_block_size_ms")) {
+        config.conf["audio_block_size_ms"] = int(std::round(audio_block_size_seconds*1e3f));
+        is_modified = true;
+    }
+    if (!config.conf.contains("audio_target_latency_ms")) {
+        config.conf["audio_target_latency_ms"] = int(std::round(audio_target_latency_seconds*1e3f));
+        is_modified = true;
+    }
     const bool cfg_is_enabled = config.conf["is_enabled"];
+    is_wideband = config.conf["wideband"]["is_enabled"];
+    wideband_sample_rate = config.conf["wideband"]["sample_rate"];
+    wideband_frequencies = config.conf["wideband"]["frequencies"].get<std::vector<double>>();
+    const int cfg_slideshow_texture_budget_mb = config.conf["slideshow_texture_budget_mb"];
+    slideshow_texture_budget = size_t(std::max(cfg_slideshow_texture_budget_mb, 1)) * 1024*1024;
+    const int cfg_slideshow_disk_cache_mb = config.conf["slideshow_disk_cache_mb"];
+    const bool cfg_is_ensemble_cache_enabled = config.conf["is_ensemble_cache_enabled"];
+    std::vector<Ofdm_Sync_Cache::Entry> cfg_ofdm_sync_entries;
+    for (const auto& cfg_entry: config.conf["ofdm_sync_cache"]) {
+        Ofdm_Sync_Cache::Entry entry;
+        entry.frequency_khz = cfg_entry["frequency_khz"];
+        entry.state.coarse_frequency_offset = cfg_entry["coarse_frequency_offset"];
+        entry.state.fine_frequency_offset = cfg_entry["fine_frequency_offset"];
+        entry.state.signal_level = cfg_entry["signal_level"];
+        cfg_ofdm_sync_entries.push_back(entry);
+    }
+    const int cfg_audio_block_size_ms = config.conf["audio_block_size_ms"];
+    const int cfg_audio_target_latency_ms = config.conf["audio_target_latency_ms"];
     config.release(is_modified);
+    audio_player_stream->set_block_size_seconds(float(cfg_audio_block_size_ms)*1e-3f);
+    audio_player_stream->set_target_latency_seconds(float(cfg_audio_target_latency_ms)*1e-3f);
+    audio_block_size_seconds = audio_player_stream->get_block_size_seconds();
+    audio_target_latency_seconds = audio_player_stream->get_target_latency_seconds();
+    radio_view_controller->SetSlideshowTextureBudget(slideshow_texture_budget);
+    // NOTE: A size of zero disables the disk cache
+    if (cfg_slideshow_disk_cache_mb > 0) {
+        const auto directory = std::filesystem::path(core::args["root"].s()) / "slideshow_cache";
+        slideshow_disk_cache = std::make_shared<Slideshow_Disk_Cache>(
+            directory.string(), size_t(cfg_slideshow_disk_cache_mb) * 1024*1024);
+    }
+    radio_view_controller->SetSlideshowDiskCache(slideshow_disk_cache);
+    if (cfg_is_ensemble_cache_enabled) {
+        const auto directory = std::filesystem::path(core::args["root"].s()) / "ensemble_cache";
+        ensemble_database_cache = std::make_shared<Ensemble_Database_Cache>(directory.string());
+    }
+    radio_block->set_database_cache(ensemble_database_cache);
+    ofdm_sync_cache = std::make_shared<Ofdm_Sync_Cache>();
+    ofdm_sync_cache->set_entries(cfg_ofdm_sync_entries);
+    ofdm_sync_cache_revision = ofdm_sync_cache->get_revision();
+    radio_block->set_sync_cache(ofdm_sync_cache);
+    CreateWidebandEnsembles();
     if (cfg_is_enabled) {
         enable();
     }
 }
 
 DABModule::~DABModule() {
+    sigpath::sourceManager.onRetune.unbindHandler(&ev_handler_retune);
+    iq_recorder->stop();
+    iq_replay = nullptr;
     audio_stream.stop();
     if (isEnabled()) {
+        if (wideband_demodulator_sink != nullptr) {
+            wideband_demodulator_sink->stop();
+        }
         ofdm_demodulator_sink->stop();
         sigpath::vfoManager.deleteVFO(vfo);
     }
@@ -138,6 +282,16 @@ DABModule::~DABModule() {
 
 void DABModule::enable() { 
     is_enabled = true; 
+    if ((vfo == nullptr) && is_wideband && (wideband_demodulator_sink != nullptr)) {
+        // NOTE: One vfo at the wideband sample rate is shared between all ensembles
+        vfo = sigpath::vfoManager.createVFO(
+            name, ImGui::WaterfallVFO::REF_CENTER,
+            0, wideband_sample_rate, wideband_sample_rate, wideband_sample_rate, wideband_sample_rate, true);
+        wideband_centre_frequency = 0.0;
+        UpdateTunedFrequency();
+        wideband_demodulator_sink->setInput(vfo->output);
+        wideband_demodulator_sink->start();
+    }
     if (vfo == nullptr) {
         // NOTE: Use the entire 2.048e6 frequency range so that if we have a large
         //       frequency offset the VFO doesn't low pass filter out subcarriers
@@ -148,6 +302,7 @@ void DABModule::enable() {
         ofdm_demodulator_sink->setInput(vfo->output);
         ofdm_demodulator_sink->start();
     }
+    UpdateTunedFrequency();
 
     config.acquire();
     config.conf["is_enabled"] = true;
@@ -156,10 +311,15 @@ void DABModule::enable() {
 void DABModule::disable() { 
     is_enabled = false; 
     if (vfo != nullptr) {
+        if (wideband_demodulator_sink != nullptr) {
+            wideband_demodulator_sink->stop();
+        }
         ofdm_demodulator_sink->stop();
         sigpath::vfoManager.deleteVFO(vfo);
         vfo = nullptr;
     }
+    is_vfo_tuned = false;
+    is_wideband_tuned = false;
 
     config.acquire();
     config.conf["is_enabled"] = false;
@@ -167,8 +327,385 @@ void DABModule::disable() {
 }
 
 void DABModule::RenderMenu() {
+    RenderWidebandMenu();
+    RenderRecorderMenu();
+    RenderReplayMenu();
     const bool is_disabled = !is_enabled;
     if (is_disabled) style::beginDisabled();
-    Render_Radio_Block(*radio_block, *radio_view_controller);
+    // NOTE: sdr++ has no event for moving the vfo so only its offset is compared here
+    //       Changes to the centre frequency come from the retune event
+    if ((vfo != nullptr) && (sigpath::vfoManager.getOffset(name) != vfo_offset)) {
+        UpdateTunedFrequency();
+    }
+    const bool is_wideband_running = is_wideband && (wideband_demodulator_sink != nullptr);
+    if (is_wideband_running) {
+        const int total_ensembles = int(wideband_ensembles.size());
+        selected_ensemble_index = std::clamp(selected_ensemble_index, 0, total_ensembles-1);
+        auto& ensemble = *wideband_ensembles[selected_ensemble_index];
+        const auto ensemble_label = fmt::format("{} ({:.3f} MHz)", get_dab_channel_label(ensemble.frequency), ensemble.frequency*1e-6);
+        if (ImGui::BeginCombo("Ensemble", ensemble_label.c_str())) {
+            for (int i = 0; i < total_ensembles; i++) {
+                const double frequency = wideband_ensembles[i]->frequency;
+                const auto label = fmt::format("{} ({:.3f} MHz)###{}", get_dab_channel_label(frequency), frequency*1e-6, i);
+                if (ImGui::Selectable(label.c_str(), i == selected_ensemble_index)) {
+                    selected_ensemble_index = i;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        const double offset = ensemble.frequency - wideband_centre_frequency;
+        if (std::abs(offset) > double(wideband_sample_rate/2.0f - WIDEBAND_CUTOFF_HZ)) {
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Ensemble is outside of the tuned bandwidth");
+        }
+        Render_Radio_Block(*ensemble.radio_block, *ensemble.radio_view_controller);
+    } else {
+        Render_Radio_Block(*radio_block, *radio_view_controller);
+    }
     if (is_disabled) style::endDisabled();
+    // NOTE: The latency profile is changed from the audio tab so it is saved here
+    const float new_block_size_seconds = audio_player_stream->get_block_size_seconds();
+    const float new_target_latency_seconds = audio_player_stream->get_target_latency_seconds();
+    if ((new_block_size_seconds != audio_block_size_seconds) || (new_target_latency_seconds != audio_target_latency_seconds)) {
+        audio_block_size_seconds = new_block_size_seconds;
+        audio_target_latency_seconds = new_target_latency_seconds;
+        config.acquire();
+        config.conf["audio_block_size_ms"] = int(std::round(audio_block_size_seconds*1e3f));
+        config.conf["audio_target_latency_ms"] = int(std::round(audio_target_latency_seconds*1e3f));
+        config.release(true);
+    }
+    // NOTE: The ofdm thread only advances the revision when an offset has moved noticeably
+    const uint64_t new_ofdm_sync_cache_revision = ofdm_sync_cache->get_revision();
+    if (new_ofdm_sync_cache_revision != ofdm_sync_cache_revision) {
+        ofdm_sync_cache_revision = new_ofdm_sync_cache_revision;
+        auto cfg_entries = json::array();
+        for (const auto& entry: ofdm_sync_cache->get_entries()) {
+            json cfg_entry;
+            cfg_entry["frequency_khz"] = entry.frequency_khz;
+            cfg_entry["coarse_frequency_offset"] = entry.state.coarse_frequency_offset;
+            cfg_entry["fine_frequency_offset"] = entry.state.fine_frequency_offset;
+            cfg_entry["signal_level"] = entry.state.signal_level;
+            cfg_entries.push_back(cfg_entry);
+        }
+        config.acquire();
+        config.conf["ofdm_sync_cache"] = cfg_entries;
+        config.release(true);
+    }
+}
+
+void DABModule::RenderWidebandMenu() {
+    if (!ImGui::CollapsingHeader("Wideband")) return;
+    // NOTE: The vfo and channelizer can only be changed while the module is stopped
+    const bool is_locked = is_enabled;
+    if (is_locked) {
+        ImGui::TextWrapped("Disable the module to change wideband settings");
+        style::beginDisabled();
+    }
+
+    bool is_changed = false;
+    if (ImGui::Checkbox("Wideband mode", &is_wideband)) {
+        is_changed = true;
+        // replay feeds the single ensemble radio which isn't shown in wideband mode
+        if (is_wideband) CloseIQReplay();
+    }
+    const auto sample_rate_label = fmt::format("{:.3f} MHz", wideband_sample_rate*1e-6f);
+    if (ImGui::BeginCombo("Sample rate", sample_rate_label.c_str())) {
+        for (const float sample_rate: WIDEBAND_SAMPLE_RATES) {
+            const auto label = fmt::format("{:.3f} MHz", sample_rate*1e-6f);
+            if (ImGui::Selectable(label.c_str(), sample_rate == wideband_sample_rate)) {
+                wideband_sample_rate = sample_rate;
+                is_changed = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    if (ImGui::BeginCombo("Add ensemble", "Select channel")) {
+        for (const auto& channel: DAB_BAND_III_CHANNELS) {
+            const auto label = fmt::format("{} ({:.3f} MHz)", channel.label, channel.frequency*1e-6);
+            if (ImGui::Selectable(label.c_str(), false)) {
+                wideband_frequencies.push_back(channel.frequency);
+                is_changed = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    // NOTE: Removed after the loop so the entry after it is still drawn this frame
+    std::optional<size_t> remove_index = std::nullopt;
+    for (size_t i = 0; i < wideband_frequencies.size(); i++) {
+        const double frequency = wideband_frequencies[i];
+        ImGui::PushID(int(i));
+        ImGui::Text("%s (%.3f MHz)", get_dab_channel_label(frequency), frequency*1e-6);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Remove")) {
+            remove_index = i;
+        }
+        ImGui::PopID();
+    }
+    if (remove_index.has_value()) {
+        wideband_frequencies.erase(wideband_frequencies.begin() + remove_index.value());
+        is_changed = true;
+    }
+
+    if (is_locked) style::endDisabled();
+    if (is_changed) {
+        CreateWidebandEnsembles();
+        SaveWidebandConfig();
+    }
+}
+
+void DABModule::RenderRecorderMenu() {
+    if (!ImGui::CollapsingHeader("IQ Recorder")) return;
+    const bool is_recording = iq_recorder->is_recording();
+    if (is_recording) style::beginDisabled();
+    const int total_formats = int(sizeof(IQ_RECORDER_FORMATS)/sizeof(IQ_RECORDER_FORMATS[0]));
+    iq_recorder_format_index = std::clamp(iq_recorder_format_index, 0, total_formats-1);
+    if (ImGui::BeginCombo("Format", get_iq_format_extension(IQ_RECORDER_FORMATS[iq_recorder_format_index]))) {
+        for (int i = 0; i < total_formats; i++) {
+            if (ImGui::Selectable(get_iq_format_extension(IQ_RECORDER_FORMATS[i]), i == iq_recorder_format_index)) {
+                iq_recorder_format_index = i;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SliderFloat("Gain", &iq_recorder_gain, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+    if (is_recording) style::endDisabled();
+
+    if (is_recording) {
+        if (ImGui::Button("Stop recording")) {
+            iq_recorder->stop();
+        }
+        const auto filepath = iq_recorder->get_filepath();
+        const float duration = float(iq_recorder->get_total_samples()) / OFDM_SAMPLE_RATE;
+        ImGui::TextWrapped("%.*s", int(filepath.length()), filepath.c_str());
+        ImGui::Text("Duration: %.1f s", duration);
+        ImGui::Text("Written: %.1f MB", float(iq_recorder->get_total_bytes_written())*1e-6f);
+        ImGui::Text("Dropped: %.1f MB", float(iq_recorder->get_total_bytes_dropped())*1e-6f);
+    } else {
+        if (is_wideband) style::beginDisabled();
+        if (ImGui::Button("Start recording")) {
+            StartIQRecording();
+        }
+        if (is_wideband) style::endDisabled();
+    }
+}
+
+void DABModule::StartIQRecording() {
+    const auto directory = GetRecordingsDirectory();
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    const double centre_frequency = gui::waterfall.getCenterFrequency() + sigpath::vfoManager.getOffset(name);
+    const std::time_t time = std::time(nullptr);
+    char time_str[32] = {0};
+    std::strftime(time_str, sizeof(time_str), "%Y%m%d_%H%M%S", std::localtime(&time));
+    const auto filename = fmt::format("dab_iq_{:.3f}MHz_{}", centre_frequency*1e-6, time_str);
+    const auto filepath = (directory / filename).string();
+
+    // NOTE: The metadata is read from the dsp thread so the gui's tuning state is captured here
+    //       and retunes during the recording are picked up through the radio block
+    auto get_metadata = [this, centre_frequency]() {
+        IQ_Recorder_Metadata metadata;
+        const double tuned_frequency = radio_block->get_tuned_frequency();
+        metadata.centre_frequency = (tuned_frequency > 0.0) ? tuned_frequency : centre_frequency;
+        auto demod = radio_block->get_ofdm_demodulator();
+        metadata.signal_level = demod->GetSignalAverage();
+        metadata.fine_frequency_offset = demod->GetFineFrequencyOffset() * OFDM_SAMPLE_RATE;
+        metadata.coarse_frequency_offset = demod->GetCoarseFrequencyOffset() * OFDM_SAMPLE_RATE;
+        switch (demod->GetState()) {
+        case OFDM_Demod::State::FINDING_NULL_POWER_DIP:   metadata.ofdm_state = "FINDING_NULL_POWER_DIP"; break;
+        case OFDM_Demod::State::READING_NULL_AND_PRS:     metadata.ofdm_state = "READING_NULL_AND_PRS"; break;
+        case OFDM_Demod::State::RUNNING_COARSE_FREQ_SYNC: metadata.ofdm_state = "RUNNING_COARSE_FREQ_SYNC"; break;
+        case OFDM_Demod::State::RUNNING_FINE_TIME_SYNC:   metadata.ofdm_state = "RUNNING_FINE_TIME_SYNC"; break;
+        case OFDM_Demod::State::READING_SYMBOLS:          metadata.ofdm_state = "READING_SYMBOLS"; break;
+        default:                                          metadata.ofdm_state = "UNKNOWN"; break;
+        }
+        auto snapshot = radio_block->get_radio_snapshot();
+        if ((snapshot != nullptr) && (snapshot->database != nullptr)) {
+            const auto& ensemble = snapshot->database->ensemble;
+            metadata.ensemble_id = uint32_t(ensemble.id.get_unique_identifier());
+            metadata.ensemble_label = ensemble.label;
+        }
+        return metadata;
+    };
+    iq_recorder->start(filepath, IQ_RECORDER_FORMATS[iq_recorder_format_index], iq_recorder_gain, get_metadata);
+}
+
+void DABModule::RenderReplayMenu() {
+    if (!ImGui::CollapsingHeader("IQ Replay")) return;
+    if (is_wideband) {
+        ImGui::TextWrapped("Replay is only available when decoding a single ensemble");
+        return;
+    }
+    if (iq_replay == nullptr) {
+        ImGui::InputText("File", iq_replay_filepath.data(), iq_replay_filepath.size());
+        if (ImGui::Button("Open")) {
+            OpenIQReplay();
+        }
+        if (!iq_replay_error.empty()) {
+            ImGui::TextWrapped("%.*s", int(iq_replay_error.length()), iq_replay_error.c_str());
+        }
+        return;
+    }
+
+    const auto& file = *iq_replay->get_file();
+    const auto& filepath = file.get_filepath();
+    const bool is_indexed = file.get_is_indexed();
+    const size_t total_frames = file.get_frame_offsets()->size();
+    ImGui::TextWrapped("%.*s", int(filepath.length()), filepath.c_str());
+    ImGui::Text("Format: %s", get_iq_format_extension(file.get_format()));
+    ImGui::Text("Duration: %.1f s", float(file.get_total_samples()) / OFDM_SAMPLE_RATE);
+    if (is_indexed) {
+        ImGui::Text("Frames: %zu", total_frames);
+    } else {
+        ImGui::Text("Frames: indexing...");
+    }
+    if (ImGui::Button("Close")) {
+        CloseIQReplay();
+        return;
+    }
+    ImGui::SameLine();
+    const bool is_playing = iq_replay->get_is_playing();
+    if (ImGui::Button(is_playing ? "Pause" : "Play")) {
+        iq_replay->set_is_playing(!is_playing);
+    }
+    ImGui::SameLine();
+    bool is_realtime = iq_replay->get_is_realtime();
+    if (ImGui::Checkbox("Realtime", &is_realtime)) {
+        iq_replay->set_is_realtime(is_realtime);
+    }
+    // NOTE: Playback starts once the file is indexed
+    if (!is_indexed) return;
+    if (total_frames == 0) {
+        ImGui::TextWrapped("No frames were found so seeking is disabled");
+        return;
+    }
+    int current_frame = int(iq_replay->get_current_frame());
+    if (ImGui::SliderInt("Frame", &current_frame, 0, int(total_frames)-1)) {
+        // the replay resets the demodulator at the jump so it isn't seen as a loss of sync
+        iq_replay->seek_to_frame(size_t(current_frame));
+    }
+    bool is_looping = iq_replay->get_is_looping();
+    int loop_start = int(iq_replay->get_loop_start_frame());
+    int loop_end = int(iq_replay->get_loop_end_frame());
+    bool is_loop_changed = ImGui::Checkbox("Loop", &is_looping);
+    is_loop_changed |= ImGui::DragIntRange2("Loop frames", &loop_start, &loop_end, 1.0f, 0, int(total_frames));
+    if (is_loop_changed) {
+        iq_replay->set_loop(is_looping, size_t(loop_start), size_t(loop_end));
+    }
+}
+
+void DABModule::OpenIQReplay() {
+    CloseIQReplay();
+    const auto filepath = std::string(iq_replay_filepath.data());
+    // NOTE: Recordings are expected to be at the ofdm sample rate
+    const auto& ofdm_params = radio_block->get_ofdm_params();
+    IQ_Replay_File::Frame_Timing timing;
+    timing.null_period = size_t(ofdm_params.nb_null_period);
+    timing.frame_period = timing.null_period + size_t(ofdm_params.nb_symbol_period)*size_t(ofdm_params.nb_frame_symbols);
+    std::shared_ptr<IQ_Replay_File> file = IQ_Replay_File::open(filepath, timing);
+    if (file == nullptr) {
+        iq_replay_error = fmt::format("Failed to open '{}'. Expected a .cf32, .cs16 or .cs8 file", filepath);
+        return;
+    }
+    iq_replay_error.clear();
+    ofdm_demodulator_sink->set_is_bypassed(true);
+    radio_block->set_is_lossless(true);
+    auto* block = radio_block.get();
+    iq_replay = std::make_unique<IQ_Replay>(
+        file, OFDM_SAMPLE_RATE,
+        [block](tcb::span<const std::complex<float>> samples) {
+            return block->process_iq_blocking(samples);
+        },
+        [block]() {
+            return block->process_iq_discontinuity_blocking();
+        }
+    );
+    UpdateTunedFrequency();
+}
+
+void DABModule::CloseIQReplay() {
+    if (iq_replay == nullptr) return;
+    iq_replay = nullptr;
+    ofdm_demodulator_sink->set_is_bypassed(false);
+    radio_block->set_is_lossless(false);
+    radio_block->reset_ofdm_demodulator();
+    UpdateTunedFrequency();
+}
+
+void DABModule::UpdateTunedFrequency() {
+    // NOTE: The ensembles of the wideband decoder have fixed frequencies so only their channel offsets follow the tuning
+    const bool is_wideband_running = is_wideband && (wideband_demodulator_sink != nullptr);
+    is_vfo_tuned = (vfo != nullptr) && !is_wideband_running && (iq_replay == nullptr);
+    is_wideband_tuned = (vfo != nullptr) && is_wideband_running;
+    if (vfo != nullptr) vfo_offset = sigpath::vfoManager.getOffset(name);
+    // NOTE: A replayed recording isn't from the tuned frequency so it isn't cached
+    if (iq_replay != nullptr) {
+        radio_block->set_tuned_frequency(0.0);
+        return;
+    }
+    SetTunedFrequency(gui::waterfall.getCenterFrequency());
+}
+
+void DABModule::SetTunedFrequency(double centre_frequency) {
+    if (is_wideband_tuned) UpdateWidebandFrequencies(centre_frequency + vfo_offset);
+    if (!is_vfo_tuned) return;
+    // NOTE: This only hands the frequency over, the radio block resets and reads its caches on its own thread
+    radio_block->set_tuned_frequency(centre_frequency + vfo_offset);
+}
+
+void DABModule::CreateWidebandEnsembles() {
+    auto lock = std::scoped_lock(mutex_wideband_frequencies);
+    wideband_demodulator_sink = nullptr;
+    wideband_ensembles.clear();
+    if (!is_wideband || wideband_frequencies.empty()) return;
+
+    const size_t decimation_factor = size_t(std::round(wideband_sample_rate / OFDM_SAMPLE_RATE));
+    // NOTE: The channelizer only supports integer decimation
+    if ((decimation_factor == 0) || (float(decimation_factor)*OFDM_SAMPLE_RATE != wideband_sample_rate)) return;
+
+    std::vector<Radio_Block*> radio_blocks;
+    for (const double frequency: wideband_frequencies) {
+        auto ensemble = std::make_unique<Wideband_Ensemble>();
+        ensemble->frequency = frequency;
+        // NOTE: The frame times of each ensemble are kept apart so they can be sized independently
+        ensemble->radio_block = std::make_unique<Radio_Block>(
+            std::make_shared<Thread_Pool_Controller>(wideband_frequencies.size()));
+        ensemble->radio_view_controller = std::make_unique<Radio_View_Controller>();
+        ensemble->radio_view_controller->SetSlideshowTextureBudget(slideshow_texture_budget);
+        ensemble->radio_view_controller->SetSlideshowDiskCache(slideshow_disk_cache);
+        ensemble->radio_view_controller->SetAudioPlayer(audio_player_stream);
+        ensemble->radio_block->set_audio_sink(std::make_unique<Audio_Player_Tap>(*audio_player_stream));
+        ensemble->radio_block->set_audio_data_signal(audio_player_stream->get_data_signal());
+        ensemble->radio_block->set_audio_recorder(std::make_shared<Audio_Recorder>(audio_file_writer, GetRecordingsDirectory().string()));
+        ensemble->radio_block->set_database_cache(ensemble_database_cache);
+        ensemble->radio_block->set_sync_cache(ofdm_sync_cache);
+        ensemble->radio_block->set_tuned_frequency(frequency);
+        radio_blocks.push_back(ensemble->radio_block.get());
+        wideband_ensembles.push_back(std::move(ensemble));
+    }
+    auto channelizer = std::make_unique<Wideband_Channelizer>(
+        decimation_factor, WIDEBAND_TAPS_PER_PHASE, WIDEBAND_CUTOFF_HZ/wideband_sample_rate);
+    wideband_demodulator_sink = std::make_unique<Wideband_Demodulator_Sink>(std::move(channelizer), radio_blocks);
+    wideband_demodulator_sink->init(nullptr);
+    wideband_centre_frequency = 0.0;
+    selected_ensemble_index = 0;
+}
+
+void DABModule::UpdateWidebandFrequencies(double centre_frequency) {
+    auto lock = std::scoped_lock(mutex_wideband_frequencies);
+    if (wideband_demodulator_sink == nullptr) return;
+    if (centre_frequency == wideband_centre_frequency) return;
+    wideband_centre_frequency = centre_frequency;
+    std::vector<float> frequencies_norm;
+    for (const auto& ensemble: wideband_ensembles) {
+        const double offset = ensemble->frequency - centre_frequency;
+        frequencies_norm.push_back(float(offset / double(wideband_sample_rate)));
+    }
+    wideband_demodulator_sink->get_channelizer().set_channel_frequencies(frequencies_norm);
+}
+
+void DABModule::SaveWidebandConfig() {
+    config.acquire();
+    config.conf["wideband"]["is_enabled"] = is_wideband;
+    config.conf["wideband"]["sample_rate"] = wideband_sample_rate;
+    config.conf["wideband"]["frequencies"] = wideband_frequencies;
+    config.release(true);
 }
\ No newline at end of file
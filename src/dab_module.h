@@ -1,9 +1,12 @@
 #pragma once
+#include <array>
+#include <atomic>
 #include <complex>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 #include <core.h>
 #include <module.h>
 #include <config.h>
@@ -12,60 +15,104 @@
 #include <dsp/sink.h>
 #include <dsp/stream.h>
 #include "audio/audio_pipeline.h"
+#include "utility/span.h"
 
 extern ConfigManager config;
 
-class OFDM_Demod;
 class Radio_View_Controller;
+class Slideshow_Disk_Cache;
+class Ensemble_Database_Cache;
+class Ofdm_Sync_Cache;
 class Radio_Block;
+class Wideband_Channelizer;
+class Audio_Player_Stream;
+class Pipeline_Telemetry;
+class IQ_Recorder;
+class Async_File_Writer;
+class IQ_Replay;
 
 class OFDM_Demodulator_Sink: public dsp::Sink<dsp::complex_t>
 {
 private:
     using base_type = dsp::Sink<dsp::complex_t>;
-    std::shared_ptr<OFDM_Demod> m_ofdm_demod;
+    Radio_Block& m_radio_block;
+    IQ_Recorder* m_iq_recorder;
+    std::atomic<bool> m_is_bypassed;
 public:
-    OFDM_Demodulator_Sink(std::shared_ptr<OFDM_Demod> ofdm_demod): m_ofdm_demod(ofdm_demod) {}
+    OFDM_Demodulator_Sink(Radio_Block& radio_block): m_radio_block(radio_block), m_iq_recorder(nullptr), m_is_bypassed(false) {}
     ~OFDM_Demodulator_Sink() override {
         if (!base_type::_block_init) return;
         base_type::stop();
     }
     int run();
+    // NOTE: Set this before the sink is started
+    void set_iq_recorder(IQ_Recorder* iq_recorder) { m_iq_recorder = iq_recorder; }
+    // discard the live stream while the radio is being fed from somewhere else
+    void set_is_bypassed(bool is_bypassed) { m_is_bypassed = is_bypassed; }
 };
 
-class Audio_Player_Stream: public AudioPipelineSink
+// Splits a wideband stream into multiple 2.048MHz streams for each ensemble
+class Wideband_Demodulator_Sink: public dsp::Sink<dsp::complex_t>
 {
 private:
-    float m_sample_rate;
-    float m_block_size_seconds;
-    dsp::stream<dsp::stereo_t> m_output_stream;
-    std::unique_ptr<std::thread> m_output_thread;
-    AudioPipelineSink::Callback m_callback;
-    std::mutex m_mutex_callback;
-    bool m_is_running;
-public:
-    Audio_Player_Stream(float sample_rate, float block_size_seconds);
-    ~Audio_Player_Stream() override;
-    void set_callback(AudioPipelineSink::Callback callback) override;
-    std::string_view get_name() const override { return "sdr_audio_sink"; }
+    using base_type = dsp::Sink<dsp::complex_t>;
+    std::unique_ptr<Wideband_Channelizer> m_channelizer;
+    std::vector<Radio_Block*> m_radio_blocks;
 public:
-    auto& get_output_stream() { return m_output_stream; }
-    void set_sample_rate(float sample_rate) { m_sample_rate = sample_rate; }
-    void set_block_size_seconds(float block_size_seconds) { m_block_size_seconds = block_size_seconds; }
+    Wideband_Demodulator_Sink(std::unique_ptr<Wideband_Channelizer> channelizer, std::vector<Radio_Block*> radio_blocks);
+    ~Wideband_Demodulator_Sink() override;
+    int run();
+    Wideband_Channelizer& get_channelizer() { return *m_channelizer; }
 };
 
 class DABModule: public ModuleManager::Instance 
 {
 private:
-    std::unique_ptr<OFDM_Demodulator_Sink> ofdm_demodulator_sink;
     std::unique_ptr<Radio_Block> radio_block;
+    std::unique_ptr<OFDM_Demodulator_Sink> ofdm_demodulator_sink;
     std::unique_ptr<Radio_View_Controller> radio_view_controller;
+    size_t slideshow_texture_budget;
+    std::shared_ptr<Slideshow_Disk_Cache> slideshow_disk_cache;
+    std::shared_ptr<Ensemble_Database_Cache> ensemble_database_cache;
+    std::shared_ptr<Ofdm_Sync_Cache> ofdm_sync_cache;
+    uint64_t ofdm_sync_cache_revision;
+    std::unique_ptr<IQ_Recorder> iq_recorder;
+    int iq_recorder_format_index;
+    float iq_recorder_gain;
+    // shared by the audio recorders of every ensemble
+    std::shared_ptr<Async_File_Writer> audio_file_writer;
+    std::unique_ptr<IQ_Replay> iq_replay;
+    std::array<char, 512> iq_replay_filepath;
+    std::string iq_replay_error;
+
+    struct Wideband_Ensemble {
+        double frequency;
+        std::unique_ptr<Radio_Block> radio_block;
+        std::unique_ptr<Radio_View_Controller> radio_view_controller;
+    };
+    bool is_wideband;
+    float wideband_sample_rate;
+    std::vector<double> wideband_frequencies;
+    // NOTE: Updated from the retune event which can come from other threads
+    std::mutex mutex_wideband_frequencies;
+    std::atomic<double> wideband_centre_frequency;
+    int selected_ensemble_index;
+    std::vector<std::unique_ptr<Wideband_Ensemble>> wideband_ensembles;
+    std::unique_ptr<Wideband_Demodulator_Sink> wideband_demodulator_sink;
 
     std::string name;
     bool is_enabled;
     VFOManager::VFO* vfo;
+    Audio_Player_Stream* audio_player_stream;
+    float audio_block_size_seconds;
+    float audio_target_latency_seconds;
     SinkManager::Stream audio_stream;
     EventHandler<float> ev_handler_sample_rate_change;
+    EventHandler<double> ev_handler_retune;
+    // NOTE: The retune event can come from other threads such as rigctl so it only reads these
+    std::atomic<bool> is_vfo_tuned;
+    std::atomic<bool> is_wideband_tuned;
+    std::atomic<double> vfo_offset;
 public:
     DABModule(std::string _name); 
     ~DABModule();
@@ -75,4 +122,15 @@ public:
     bool isEnabled() override { return is_enabled; }
 private:
     void RenderMenu(); 
+    void RenderWidebandMenu();
+    void RenderRecorderMenu();
+    void StartIQRecording();
+    void RenderReplayMenu();
+    void OpenIQReplay();
+    void CloseIQReplay();
+    void UpdateTunedFrequency();
+    void SetTunedFrequency(double centre_frequency);
+    void CreateWidebandEnsembles();
+    void UpdateWidebandFrequencies(double centre_frequency);
+    void SaveWidebandConfig();
 };
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "./decode_scheduler.h"
+#include <algorithm>
+#include "./thread_pool_controller.h"
+
+Decode_Scheduler::Decode_Scheduler()
+: m_focused_subchannel(std::nullopt), m_is_enabled_last(false),
+  m_load_ms(0.0f), m_is_load_init(false),
+  m_base_cost_ms(0.0f), m_is_base_cost_init(false), m_cost_per_capacity_unit_ms(0.0f),
+  m_cost_probe(std::nullopt), m_total_steady_frames(0), m_steady_frame_time_ms(0.0f),
+  m_total_shed_ticks(0), m_total_grant_ticks(0), m_total_sheds(0)
+{}
+
+void Decode_Scheduler::reset() {
+    auto lock = std::scoped_lock(m_mutex);
+    // NOTE: The cost model is kept since the base cost and cost per capacity unit don't depend on the ensemble
+    m_channels.clear();
+    m_cost_probe = std::nullopt;
+    m_total_steady_frames = 0;
+    m_steady_frame_time_ms = 0.0f;
+    m_focused_subchannel = std::nullopt;
+    m_total_shed_ticks = 0;
+    m_total_grant_ticks = 0;
+}
+
+Decode_Scheduler::Channel* Decode_Scheduler::find_channel(subchannel_id_t subchannel_id) {
+    auto res = std::find_if(m_channels.begin(), m_channels.end(), [subchannel_id](const auto& channel) {
+        return channel.subchannel_id == subchannel_id;
+    });
+    if (res == m_channels.end()) return nullptr;
+    return &(*res);
+}
+
+Decode_Scheduler::Channel& Decode_Scheduler::get_channel(subchannel_id_t subchannel_id) {
+    auto* existing = find_channel(subchannel_id);
+    if (existing != nullptr) return *existing;
+    auto& channel = m_channels.emplace_back();
+    channel.subchannel_id = subchannel_id;
+    return channel;
+}
+
+void Decode_Scheduler::set_is_data_requested(subchannel_id_t subchannel_id, bool is_requested) {
+    auto lock = std::scoped_lock(m_mutex);
+    auto& channel = get_channel(subchannel_id);
+    channel.is_data_requested = is_requested;
+    if (is_requested) channel.last_used = std::chrono::steady_clock::now();
+    // NOTE: Requests made by the user are granted straight away if they fit in the budget
+    m_total_grant_ticks = m_settings.total_ticks_to_grant;
+}
+
+bool Decode_Scheduler::get_is_data_requested(subchannel_id_t subchannel_id) {
+    auto lock = std::scoped_lock(m_mutex);
+    const auto* channel = find_channel(subchannel_id);
+    return (channel != nullptr) && channel->is_data_requested;
+}
+
+void Decode_Scheduler::set_is_pinned(subchannel_id_t subchannel_id, bool is_pinned) {
+    auto lock = std::scoped_lock(m_mutex);
+    auto& channel = get_channel(subchannel_id);
+    channel.is_pinned = is_pinned;
+    channel.last_used = std::chrono::steady_clock::now();
+}
+
+bool Decode_Scheduler::get_is_pinned(subchannel_id_t subchannel_id) {
+    auto lock = std::scoped_lock(m_mutex);
+    const auto* channel = find_channel(subchannel_id);
+    return (channel != nullptr) && channel->is_pinned;
+}
+
+void Decode_Scheduler::set_focused_subchannel(std::optional<subchannel_id_t> subchannel_id) {
+    auto lock = std::scoped_lock(m_mutex);
+    if (m_focused_subchannel == subchannel_id) return;
+    m_focused_subchannel = subchannel_id;
+    if (subchannel_id.has_value()) {
+        get_channel(subchannel_id.value()).last_used = std::chrono::steady_clock::now();
+    }
+}
+
+float Decode_Scheduler::get_budget_ms() const {
+    return m_settings.budget * Thread_Pool_Controller::REALTIME_FRAME_PERIOD_MS;
+}
+
+bool Decode_Scheduler::is_higher_priority(const Channel& a, const Channel& b) const {
+    if (a.is_pinned != b.is_pinned) return a.is_pinned;
+    const bool is_a_focused = (m_focused_subchannel == a.subchannel_id);
+    const bool is_b_focused = (m_focused_subchannel == b.subchannel_id);
+    if (is_a_focused != is_b_focused) return is_a_focused;
+    if (a.last_used != b.last_used) return a.last_used > b.last_used;
+    // NOTE: Smaller channels are cheaper so more of them fit in the budget
+    return a.total_capacity_units < b.total_capacity_units;
+}
+
+static bool is_channel_decoded(const Decode_Scheduler::Channel& channel) {
+    return channel.is_audio_decoded || channel.is_data_granted;
+}
+
+void Decode_Scheduler::update_cost_probe(float frame_time_ms) {
+    // NOTE: The difference can't be attributed to one channel if another one changed as well
+    if (!m_decode_changes.empty()) {
+        const bool is_steady = (m_total_steady_frames >= m_settings.total_probe_frames);
+        const float load_before_ms = is_steady ? (m_steady_frame_time_ms / float(m_total_steady_frames)) : 0.0f;
+        m_cost_probe = std::nullopt;
+        m_total_steady_frames = 0;
+        m_steady_frame_time_ms = 0.0f;
+        if (!is_steady || (m_decode_changes.size() != 1)) return;
+        // NOTE: This frame is left out since the change could have been made part way through it
+        Cost_Probe probe;
+        probe.subchannel_id = m_decode_changes.front().subchannel_id;
+        probe.is_decoded = m_decode_changes.front().is_decoded;
+        probe.load_before_ms = load_before_ms;
+        m_cost_probe = probe;
+        return;
+    }
+    m_total_steady_frames++;
+    m_steady_frame_time_ms += frame_time_ms;
+    if (!m_cost_probe.has_value()) return;
+    auto& probe = m_cost_probe.value();
+    probe.total_frame_time_ms += frame_time_ms;
+    probe.total_frames++;
+    if (probe.total_frames < m_settings.total_probe_frames) return;
+    const float load_after_ms = probe.total_frame_time_ms / float(probe.total_frames);
+    const float cost_ms = probe.is_decoded ? (load_after_ms - probe.load_before_ms) : (probe.load_before_ms - load_after_ms);
+    auto* channel = find_channel(probe.subchannel_id);
+    if (channel != nullptr) {
+        channel->measured_cost_ms = std::max(cost_ms, 0.0f);
+        channel->is_cost_measured = true;
+    }
+    m_cost_probe = std::nullopt;
+}
+
+void Decode_Scheduler::update_cost_model(float frame_time_ms) {
+    update_cost_probe(frame_time_ms);
+    if (!m_is_load_init) {
+        m_load_ms = frame_time_ms;
+        m_is_load_init = true;
+    } else {
+        const float beta = m_settings.load_update_beta;
+        m_load_ms = (1.0f-beta)*m_load_ms + beta*frame_time_ms;
+    }
+
+    size_t total_decoded_units = 0;
+    for (const auto& channel: m_channels) {
+        if (is_channel_decoded(channel)) total_decoded_units += channel.total_capacity_units;
+    }
+    const float beta = m_settings.cost_update_beta;
+    if (total_decoded_units == 0) {
+        if (!m_is_base_cost_init) {
+            m_base_cost_ms = frame_time_ms;
+            m_is_base_cost_init = true;
+        } else {
+            m_base_cost_ms = (1.0f-beta)*m_base_cost_ms + beta*frame_time_ms;
+        }
+    } else if (m_is_base_cost_init) {
+        // NOTE: Without the base cost the whole frame time would be put down to the channels
+        const float cost = std::max(frame_time_ms - m_base_cost_ms, 0.0f) / float(total_decoded_units);
+        m_cost_per_capacity_unit_ms = (1.0f-beta)*m_cost_per_capacity_unit_ms + beta*cost;
+    }
+    for (auto& channel: m_channels) {
+        channel.estimated_cost_ms = channel.is_cost_measured ?
+            channel.measured_cost_ms :
+            m_cost_per_capacity_unit_ms * float(channel.total_capacity_units);
+    }
+}
+
+std::vector<Decode_Scheduler::Decision> Decode_Scheduler::update(
+    float frame_time_ms, size_t queue_depth, tcb::span<const Channel_State> states)
+{
+    auto lock = std::scoped_lock(m_mutex);
+    auto is_in_radio = [&states](const Channel& channel) {
+        return std::any_of(states.begin(), states.end(), [&channel](const auto& state) {
+            return state.subchannel_id == channel.subchannel_id;
+        });
+    };
+    // NOTE: Channels that are gone from the radio would otherwise count towards the decoded capacity units
+    //       Requests and pins are kept since the gui can make them before the channel is decoded
+    m_decode_changes.clear();
+    for (auto& channel: m_channels) {
+        if (is_in_radio(channel)) continue;
+        if (is_channel_decoded(channel)) m_decode_changes.push_back({ channel.subchannel_id, false });
+        channel.is_audio_decoded = false;
+        channel.is_data_granted = false;
+    }
+    m_channels.erase(std::remove_if(m_channels.begin(), m_channels.end(), [&is_in_radio](const Channel& channel) {
+        return !is_in_radio(channel) && !channel.is_data_requested && !channel.is_pinned;
+    }), m_channels.end());
+
+    const bool is_enabled_changed = m_settings.is_enabled && !m_is_enabled_last;
+    m_is_enabled_last = m_settings.is_enabled;
+    // NOTE: Adding channels can't move the ones we already have pointers to
+    m_channels.reserve(m_channels.size() + states.size());
+    std::vector<Channel*> channels;
+    channels.reserve(states.size());
+    for (const auto& state: states) {
+        const bool is_new = (find_channel(state.subchannel_id) == nullptr);
+        auto& channel = get_channel(state.subchannel_id);
+        const bool was_decoded = is_channel_decoded(channel);
+        channel.total_capacity_units = state.total_capacity_units;
+        channel.is_audio_decoded = state.is_decode_audio || state.is_play_audio;
+        channel.is_data_granted = state.is_decode_data;
+        const bool is_decoded = is_channel_decoded(channel);
+        if (is_decoded != was_decoded) m_decode_changes.push_back({ channel.subchannel_id, is_decoded });
+        // NOTE: The controls are the requests until the scheduler takes over so enabling it doesn't turn anything off
+        //       Data decoding on a channel that we haven't seen yet is also treated as a request
+        if (!m_settings.is_enabled || is_enabled_changed || (is_new && state.is_decode_data)) {
+            if (state.is_decode_data && !channel.is_data_requested) channel.last_used = std::chrono::steady_clock::now();
+            channel.is_data_requested = state.is_decode_data;
+        }
+        channels.push_back(&channel);
+    }
+    update_cost_model(frame_time_ms);
+
+    std::vector<Decision> decisions;
+    if (!m_settings.is_enabled) {
+        m_total_shed_ticks = 0;
+        m_total_grant_ticks = 0;
+        return decisions;
+    }
+
+    auto set_is_granted = [&decisions](Channel& channel, bool is_granted) {
+        channel.is_data_granted = is_granted;
+        decisions.push_back({ channel.subchannel_id, is_granted });
+    };
+    auto is_wanted = [](const Channel& channel) {
+        return channel.is_data_requested || channel.is_pinned;
+    };
+
+    for (auto* channel: channels) {
+        if (channel->is_data_granted && !is_wanted(*channel)) {
+            set_is_granted(*channel, false);
+        } else if (!channel->is_data_granted && channel->is_pinned) {
+            // NOTE: Pinned channels are the user overriding the budget
+            set_is_granted(*channel, true);
+        }
+    }
+
+    // highest priority first
+    std::sort(channels.begin(), channels.end(), [this](const Channel* a, const Channel* b) {
+        return is_higher_priority(*a, *b);
+    });
+
+    const float budget_ms = get_budget_ms();
+    const bool is_behind = (m_load_ms > budget_ms) || (queue_depth >= m_settings.shed_queue_depth);
+    m_total_shed_ticks = is_behind ? (m_total_shed_ticks+1) : 0;
+    m_total_grant_ticks = is_behind ? 0 : (m_total_grant_ticks+1);
+
+    if (m_total_shed_ticks >= m_settings.total_ticks_to_shed) {
+        m_total_shed_ticks = 0;
+        // NOTE: Data from a channel that is decoding audio is almost free so those are shed last
+        auto is_sheddable = [](const Channel* channel) {
+            return channel->is_data_granted && !channel->is_pinned;
+        };
+        auto res = std::find_if(channels.rbegin(), channels.rend(), [&is_sheddable](const Channel* channel) {
+            return is_sheddable(channel) && !channel->is_audio_decoded;
+        });
+        if (res == channels.rend()) res = std::find_if(channels.rbegin(), channels.rend(), is_sheddable);
+        if (res != channels.rend()) {
+            auto& channel = **res;
+            set_is_granted(channel, false);
+            channel.total_sheds++;
+            m_total_sheds++;
+            // the load has to settle before anything else can be granted
+            m_total_grant_ticks = 0;
+        }
+    } else if (m_total_grant_ticks >= m_settings.total_ticks_to_grant) {
+        m_total_grant_ticks = 0;
+        auto res = std::find_if(channels.begin(), channels.end(), [&is_wanted](const Channel* channel) {
+            return !channel->is_data_granted && is_wanted(*channel);
+        });
+        if ((res != channels.end()) &&
+            (((*res)->is_audio_decoded) || (m_load_ms + (*res)->estimated_cost_ms <= budget_ms)))
+        {
+            set_is_granted(**res, true);
+        }
+    }
+    return decisions;
+}
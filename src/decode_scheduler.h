@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "dab/database/dab_database_types.h"
+#include "utility/span.h"
+
+// Decides which subchannels get data decoding within a cpu budget for the radio thread
+// - Requests for data decoding come from the gui and are granted in order of priority
+//   where pinned channels come first, then the focused channel, then the most recently used
+// - The decode cost of a channel is measured as the change in frame time when it alone starts or stops
+//   being decoded, since the radio decodes its channels together and can't time them individually
+// - Until a channel has been measured its cost is estimated from its size in capacity units
+//   using the frame time above the base cost, which is learnt from frames where only the fic is decoded
+// - The channel controls are mirrored as requests while scheduling is disabled and data decoding on a
+//   channel that first appears counts as a request, so the scheduler doesn't turn off what was enabled without it
+// - When the radio falls behind real time the lowest priority channel is shed first
+//   and requests are only granted again once the estimated load fits in the budget
+// - Audio decoding is never shed but its cost counts against the budget
+//   NOTE: Audio is only decoded for playback or recording so shedding it would drop audio the user asked for
+class Decode_Scheduler
+{
+public:
+    struct Settings {
+        bool is_enabled = false;
+        // fraction of the realtime frame period the radio thread may spend decoding
+        float budget = 0.5f;
+        float load_update_beta = 0.1f;
+        float cost_update_beta = 0.05f;
+        size_t shed_queue_depth = 2;
+        // hysteresis in frames between changes so the load can settle
+        size_t total_ticks_to_shed = 5;
+        size_t total_ticks_to_grant = 20;
+        // frames the load has to be steady for before and after a change to measure its cost
+        size_t total_probe_frames = 10;
+    };
+    // state of a channel read from the radio each frame
+    struct Channel_State {
+        subchannel_id_t subchannel_id = 0;
+        size_t total_capacity_units = 0;
+        bool is_decode_audio = false;
+        bool is_play_audio = false;
+        bool is_decode_data = false;
+    };
+    struct Decision {
+        subchannel_id_t subchannel_id = 0;
+        bool is_decode_data = false;
+    };
+    struct Channel {
+        subchannel_id_t subchannel_id = 0;
+        bool is_data_requested = false;
+        bool is_data_granted = false;
+        bool is_pinned = false;
+        bool is_audio_decoded = false;
+        size_t total_capacity_units = 0;
+        float estimated_cost_ms = 0.0f;
+        // cost of decoding the channel as measured from the frame times
+        float measured_cost_ms = 0.0f;
+        bool is_cost_measured = false;
+        std::chrono::steady_clock::time_point last_used;
+        size_t total_sheds = 0;
+    };
+private:
+    // a channel that started or stopped being decoded this frame
+    struct Decode_Change {
+        subchannel_id_t subchannel_id = 0;
+        bool is_decoded = false;
+    };
+    // frame times after a single channel changed which are compared to the load before it
+    struct Cost_Probe {
+        subchannel_id_t subchannel_id = 0;
+        bool is_decoded = false;
+        float load_before_ms = 0.0f;
+        float total_frame_time_ms = 0.0f;
+        size_t total_frames = 0;
+    };
+    std::mutex m_mutex;
+    Settings m_settings;
+    std::vector<Channel> m_channels;
+    std::optional<subchannel_id_t> m_focused_subchannel;
+    bool m_is_enabled_last;
+    float m_load_ms;
+    bool m_is_load_init;
+    // NOTE: Frame time is modelled as a fixed cost for the fic plus a cost per decoded capacity unit
+    //       This is only used for channels that haven't been measured yet
+    float m_base_cost_ms;
+    bool m_is_base_cost_init;
+    float m_cost_per_capacity_unit_ms;
+    std::vector<Decode_Change> m_decode_changes;
+    std::optional<Cost_Probe> m_cost_probe;
+    // frames since the last change to the decoded channels
+    size_t m_total_steady_frames;
+    float m_steady_frame_time_ms;
+    size_t m_total_shed_ticks;
+    size_t m_total_grant_ticks;
+    size_t m_total_sheds;
+public:
+    Decode_Scheduler();
+    // forgets the channels and their requests when the radio is replaced by one for another ensemble
+    void reset();
+    // gui side
+    void set_is_data_requested(subchannel_id_t subchannel_id, bool is_requested);
+    bool get_is_data_requested(subchannel_id_t subchannel_id);
+    void set_is_pinned(subchannel_id_t subchannel_id, bool is_pinned);
+    bool get_is_pinned(subchannel_id_t subchannel_id);
+    void set_focused_subchannel(std::optional<subchannel_id_t> subchannel_id);
+    // called from the radio thread once per frame
+    // returns the changes to the channel controls that should be applied
+    std::vector<Decision> update(float frame_time_ms, size_t queue_depth, tcb::span<const Channel_State> states);
+    // gui access
+    std::mutex& get_mutex() { return m_mutex; }
+    Settings& get_settings() { return m_settings; }
+    const std::vector<Channel>& get_channels() const { return m_channels; }
+    float get_load_ms() const { return m_load_ms; }
+    float get_budget_ms() const;
+    float get_base_cost_ms() const { return m_base_cost_ms; }
+    bool get_is_base_cost_init() const { return m_is_base_cost_init; }
+    size_t get_total_sheds() const { return m_total_sheds; }
+private:
+    Channel* find_channel(subchannel_id_t subchannel_id);
+    Channel& get_channel(subchannel_id_t subchannel_id);
+    void update_cost_model(float frame_time_ms);
+    void update_cost_probe(float frame_time_ms);
+    bool is_higher_priority(const Channel& a, const Channel& b) const;
+};
@@ -0,0 +1,408 @@
+#include "./ensemble_database_cache.h"
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <fmt/core.h>
+
+constexpr char FILE_MAGIC[8] = { 'D','A','B','E','N','S','0','1' };
+constexpr const char* FILE_EXTENSION = ".ens";
+// NOTE: Tuning is usually snapped to the channel but allow for an offset while keeping the
+//       narrow channels like 10N and 10A which are 160kHz apart separate
+constexpr uint32_t FREQUENCY_TOLERANCE_KHZ = 50;
+// NOTE: Reject corrupt files instead of allocating huge buffers
+constexpr uint32_t MAX_STRING_LENGTH = 256;
+constexpr uint32_t MAX_TOTAL_ENTITIES = 1024;
+// NOTE: Enums are checked against the width of the fic field they are decoded from
+//       since the decoder can store values that aren't named in the enum
+constexpr uint32_t MAX_TRANSPORT_MODE = 0b11;      // 2bit TMid
+constexpr uint32_t MAX_SERVICE_TYPE = 0b111111;    // 6bit ASCTy and DSCTy
+constexpr uint32_t MAX_EEP_TYPE = 0b1;             // 1bit option
+constexpr uint32_t MAX_EEP_PROT_LEVEL = 0b11;      // 2bit protection level
+constexpr uint32_t MAX_UEP_PROT_INDEX = 0b111111;  // 6bit table index
+
+using Ensemble_Entity = decltype(Radio_Database::ensemble);
+using Service_Entity = decltype(Radio_Database::services)::value_type;
+using Service_Component_Entity = decltype(Radio_Database::service_components)::value_type;
+using Subchannel_Entity = decltype(Radio_Database::subchannels)::value_type;
+
+static uint32_t get_frequency_khz(double frequency) {
+    return uint32_t(std::round(frequency*1e-3));
+}
+
+static uint32_t get_ensemble_id(const Radio_Database& database) {
+    return uint32_t(database.ensemble.id.get_unique_identifier());
+}
+
+// Ids and enums are stored as raw bytes so files from a build where their layout differs are rejected
+static uint64_t get_layout_signature() {
+    const size_t sizes[] = {
+        sizeof(Ensemble_Entity::id), sizeof(Ensemble_Entity::extended_country_code),
+        sizeof(Ensemble_Entity::local_time_offset), sizeof(Ensemble_Entity::international_table_id),
+        sizeof(Ensemble_Entity::nb_services), sizeof(Ensemble_Entity::reconfiguration_count),
+        sizeof(Service_Entity::id), sizeof(Service_Entity::programme_type),
+        sizeof(Service_Component_Entity::service_id), sizeof(Service_Component_Entity::component_id),
+        sizeof(Service_Component_Entity::global_id), sizeof(Service_Component_Entity::transport_mode),
+        sizeof(Service_Component_Entity::audio_service_type), sizeof(Service_Component_Entity::data_service_type),
+        sizeof(Service_Component_Entity::subchannel_id),
+        sizeof(Subchannel_Entity::id), sizeof(Subchannel_Entity::start_address), sizeof(Subchannel_Entity::length),
+        sizeof(Subchannel_Entity::is_uep), sizeof(Subchannel_Entity::uep_prot_index),
+        sizeof(Subchannel_Entity::eep_prot_level), sizeof(Subchannel_Entity::eep_type),
+    };
+    // fnv-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const size_t size: sizes) {
+        hash ^= uint64_t(size);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+class Database_Writer
+{
+private:
+    std::ofstream& m_file;
+public:
+    explicit Database_Writer(std::ofstream& file): m_file(file) {}
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        m_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void write(const std::string& value) {
+        const uint32_t length = uint32_t(std::min(value.length(), size_t(MAX_STRING_LENGTH)));
+        write(length);
+        m_file.write(value.data(), std::streamsize(length));
+    }
+    template <typename T, typename F>
+    void write(const std::vector<T>& values, F&& write_entity) {
+        const uint32_t total = uint32_t(std::min(values.size(), size_t(MAX_TOTAL_ENTITIES)));
+        write(total);
+        for (uint32_t i = 0; i < total; i++) {
+            write_entity(values[i]);
+        }
+    }
+};
+
+class Database_Reader
+{
+private:
+    std::ifstream& m_file;
+    bool m_is_valid;
+public:
+    explicit Database_Reader(std::ifstream& file): m_file(file), m_is_valid(true) {}
+    bool is_valid() const { return m_is_valid && bool(m_file); }
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        m_file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+    void read(std::string& value) {
+        uint32_t length = 0;
+        read(length);
+        if (!is_valid() || (length > MAX_STRING_LENGTH)) {
+            m_is_valid = false;
+            return;
+        }
+        value.resize(length);
+        m_file.read(value.data(), std::streamsize(length));
+    }
+    // enums and bools are read as integers so an out of range value is rejected instead of being cast
+    template <typename T>
+    void read_enum(T& value, uint32_t max_value) {
+        static_assert(std::is_enum_v<T>);
+        std::underlying_type_t<T> raw = 0;
+        read(raw);
+        if (!is_valid() || (uint64_t(raw) > uint64_t(max_value))) {
+            m_is_valid = false;
+            return;
+        }
+        value = T(raw);
+    }
+    void read_bool(bool& value) {
+        uint8_t raw = 0;
+        read(raw);
+        if (!is_valid() || (raw > 1)) {
+            m_is_valid = false;
+            return;
+        }
+        value = (raw != 0);
+    }
+    template <typename T>
+    void read_bounded(T& value, uint32_t max_value) {
+        read(value);
+        if (!is_valid() || (uint64_t(value) > uint64_t(max_value))) m_is_valid = false;
+    }
+    template <typename T, typename F>
+    void read(std::vector<T>& values, F&& read_entity) {
+        uint32_t total = 0;
+        read(total);
+        if (!is_valid() || (total > MAX_TOTAL_ENTITIES)) {
+            m_is_valid = false;
+            return;
+        }
+        values.resize(total);
+        for (auto& value: values) {
+            read_entity(value);
+            if (!is_valid()) return;
+        }
+    }
+};
+
+static void write_database(Database_Writer& writer, const Radio_Database& database) {
+    const auto& ensemble = database.ensemble;
+    writer.write(ensemble.id);
+    writer.write(ensemble.extended_country_code);
+    writer.write(ensemble.local_time_offset);
+    writer.write(ensemble.international_table_id);
+    writer.write(ensemble.nb_services);
+    writer.write(ensemble.reconfiguration_count);
+    writer.write(ensemble.label);
+    writer.write(database.services, [&writer](const Service_Entity& service) {
+        writer.write(service.id);
+        writer.write(service.programme_type);
+        writer.write(service.label);
+    });
+    writer.write(database.service_components, [&writer](const Service_Component_Entity& component) {
+        writer.write(component.service_id);
+        writer.write(component.component_id);
+        writer.write(component.global_id);
+        writer.write(component.transport_mode);
+        writer.write(component.audio_service_type);
+        writer.write(component.data_service_type);
+        writer.write(component.subchannel_id);
+        writer.write(component.label);
+    });
+    writer.write(database.subchannels, [&writer](const Subchannel_Entity& subchannel) {
+        writer.write(subchannel.id);
+        writer.write(subchannel.start_address);
+        writer.write(subchannel.length);
+        writer.write(uint8_t(subchannel.is_uep));
+        writer.write(subchannel.uep_prot_index);
+        writer.write(subchannel.eep_prot_level);
+        writer.write(subchannel.eep_type);
+    });
+}
+
+static void read_database(Database_Reader& reader, Radio_Database& database) {
+    auto& ensemble = database.ensemble;
+    reader.read(ensemble.id);
+    reader.read(ensemble.extended_country_code);
+    reader.read(ensemble.local_time_offset);
+    reader.read(ensemble.international_table_id);
+    reader.read(ensemble.nb_services);
+    reader.read(ensemble.reconfiguration_count);
+    reader.read(ensemble.label);
+    reader.read(database.services, [&reader](Service_Entity& service) {
+        reader.read(service.id);
+        reader.read(service.programme_type);
+        reader.read(service.label);
+    });
+    reader.read(database.service_components, [&reader](Service_Component_Entity& component) {
+        reader.read(component.service_id);
+        reader.read(component.component_id);
+        reader.read(component.global_id);
+        reader.read_enum(component.transport_mode, MAX_TRANSPORT_MODE);
+        reader.read_enum(component.audio_service_type, MAX_SERVICE_TYPE);
+        reader.read_enum(component.data_service_type, MAX_SERVICE_TYPE);
+        reader.read(component.subchannel_id);
+        reader.read(component.label);
+    });
+    reader.read(database.subchannels, [&reader](Subchannel_Entity& subchannel) {
+        reader.read(subchannel.id);
+        reader.read(subchannel.start_address);
+        reader.read(subchannel.length);
+        reader.read_bool(subchannel.is_uep);
+        reader.read_bounded(subchannel.uep_prot_index, MAX_UEP_PROT_INDEX);
+        reader.read_bounded(subchannel.eep_prot_level, MAX_EEP_PROT_LEVEL);
+        reader.read_enum(subchannel.eep_type, MAX_EEP_TYPE);
+    });
+}
+
+bool is_ensemble_database_complete(const Radio_Database& database, const Radio_Database_Statistics& statistics) {
+    if ((statistics.nb_total == 0) || (statistics.nb_pending > 0)) return false;
+    if (get_ensemble_id(database) == 0) return false;
+    if (database.services.empty() || database.subchannels.empty()) return false;
+    // NOTE: Labels are sent less often than the rest of the fic so entities can be complete before they arrive
+    if (database.services.size() < size_t(database.ensemble.nb_services)) return false;
+    for (const auto& service: database.services) {
+        if (service.label.empty()) return false;
+    }
+    return true;
+}
+
+Ensemble_Database_Cache::Ensemble_Database_Cache(const std::string& directory)
+: m_directory(directory), m_is_running(true)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    load_entries();
+    m_thread = std::thread([this]() { run_writer(); });
+}
+
+Ensemble_Database_Cache::~Ensemble_Database_Cache() {
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_is_running = false;
+    }
+    m_cv_pending.notify_one();
+    m_thread.join();
+}
+
+Ensemble_Database_Cache::Entry* Ensemble_Database_Cache::find_entry(uint32_t frequency_khz, uint32_t ensemble_id) {
+    for (auto& entry: m_entries) {
+        if ((entry.frequency_khz == frequency_khz) && (entry.ensemble_id == ensemble_id)) return &entry;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const Radio_Database> Ensemble_Database_Cache::load(double frequency) {
+    const uint32_t frequency_khz = get_frequency_khz(frequency);
+    auto lock = std::unique_lock(m_mutex);
+    const Entry* latest_entry = nullptr;
+    for (const auto& entry: m_entries) {
+        const uint32_t offset_khz = std::max(entry.frequency_khz, frequency_khz) - std::min(entry.frequency_khz, frequency_khz);
+        if (offset_khz > FREQUENCY_TOLERANCE_KHZ) continue;
+        if ((latest_entry == nullptr) || (entry.store_time > latest_entry->store_time)) latest_entry = &entry;
+    }
+    if (latest_entry == nullptr) return nullptr;
+    return latest_entry->database;
+}
+
+std::shared_ptr<const Radio_Database> Ensemble_Database_Cache::load(double frequency, uint32_t ensemble_id) {
+    const uint32_t frequency_khz = get_frequency_khz(frequency);
+    auto lock = std::unique_lock(m_mutex);
+    for (const auto& entry: m_entries) {
+        const uint32_t offset_khz = std::max(entry.frequency_khz, frequency_khz) - std::min(entry.frequency_khz, frequency_khz);
+        if (offset_khz > FREQUENCY_TOLERANCE_KHZ) continue;
+        if (entry.ensemble_id == ensemble_id) return entry.database;
+    }
+    return nullptr;
+}
+
+void Ensemble_Database_Cache::store(double frequency, std::shared_ptr<const Radio_Database> database) {
+    if (database == nullptr) return;
+    Entry entry;
+    entry.frequency_khz = get_frequency_khz(frequency);
+    entry.ensemble_id = get_ensemble_id(*database);
+    entry.store_time = uint64_t(std::time(nullptr));
+    entry.database = database;
+    if ((entry.frequency_khz == 0) || (entry.ensemble_id == 0)) return;
+
+    {
+        auto lock = std::unique_lock(m_mutex);
+        auto* existing_entry = find_entry(entry.frequency_khz, entry.ensemble_id);
+        if (existing_entry != nullptr) {
+            // NOTE: Snapshots share the database until it changes so this skips rewriting the same one
+            if (existing_entry->database == database) return;
+            *existing_entry = entry;
+        } else {
+            m_entries.push_back(entry);
+        }
+        // only the latest copy of an ensemble needs to be written
+        auto res = std::find_if(m_pending_entries.begin(), m_pending_entries.end(), [&entry](const auto& pending) {
+            return (pending.frequency_khz == entry.frequency_khz) && (pending.ensemble_id == entry.ensemble_id);
+        });
+        if (res != m_pending_entries.end()) {
+            *res = entry;
+        } else {
+            m_pending_entries.push_back(entry);
+        }
+    }
+    m_cv_pending.notify_one();
+}
+
+size_t Ensemble_Database_Cache::get_total_entries() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_entries.size();
+}
+
+void Ensemble_Database_Cache::run_writer() {
+    std::vector<Entry> entries;
+    while (true) {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv_pending.wait(lock, [this]() { return !m_is_running || !m_pending_entries.empty(); });
+            // NOTE: Pending entries are written before stopping so an ensemble received just before closing is kept
+            if (!m_is_running && m_pending_entries.empty()) return;
+            entries.swap(m_pending_entries);
+        }
+        for (const auto& entry: entries) {
+            write_entry(entry);
+        }
+        entries.clear();
+    }
+}
+
+bool Ensemble_Database_Cache::write_entry(const Entry& entry) {
+    const auto filename = fmt::format("{}kHz_{:08X}{}", entry.frequency_khz, entry.ensemble_id, FILE_EXTENSION);
+    const auto filepath = std::filesystem::path(m_directory) / filename;
+    // NOTE: Write to a temporary file so a crash never leaves a truncated database behind
+    auto temp_filepath = filepath;
+    temp_filepath += ".tmp";
+    {
+        auto file = std::ofstream(temp_filepath, std::ios::binary);
+        if (!file.is_open()) return false;
+        const uint64_t layout_signature = get_layout_signature();
+        file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        auto writer = Database_Writer(file);
+        writer.write(layout_signature);
+        writer.write(entry.frequency_khz);
+        writer.write(entry.ensemble_id);
+        writer.write(entry.store_time);
+        write_database(writer, *entry.database);
+        if (!file) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filepath, filepath, ec);
+    if (ec) {
+        std::filesystem::remove(temp_filepath, ec);
+        return false;
+    }
+    return true;
+}
+
+void Ensemble_Database_Cache::load_entries() {
+    std::error_code ec;
+    std::vector<std::filesystem::path> invalid_files;
+    for (const auto& it: std::filesystem::directory_iterator(m_directory, ec)) {
+        const auto& path = it.path();
+        const auto extension = path.extension().string();
+        if (extension == ".tmp") {
+            invalid_files.push_back(path);
+            continue;
+        }
+        if (extension != FILE_EXTENSION) continue;
+
+        auto file = std::ifstream(path, std::ios::binary);
+        if (!file.is_open()) continue;
+        char magic[sizeof(FILE_MAGIC)];
+        uint64_t layout_signature = 0;
+        Entry entry;
+        auto database = std::make_shared<Radio_Database>();
+        file.read(magic, sizeof(magic));
+        auto reader = Database_Reader(file);
+        reader.read(layout_signature);
+        reader.read(entry.frequency_khz);
+        reader.read(entry.ensemble_id);
+        reader.read(entry.store_time);
+        const bool is_header_valid =
+            reader.is_valid() &&
+            (memcmp(magic, FILE_MAGIC, sizeof(magic)) == 0) &&
+            (layout_signature == get_layout_signature());
+        if (is_header_valid) read_database(reader, *database);
+        if (!is_header_valid || !reader.is_valid() || (get_ensemble_id(*database) != entry.ensemble_id)) {
+            invalid_files.push_back(path);
+            continue;
+        }
+        entry.database = database;
+        if (find_entry(entry.frequency_khz, entry.ensemble_id) != nullptr) continue;
+        m_entries.push_back(entry);
+    }
+    for (const auto& path: invalid_files) {
+        std::filesystem::remove(path, ec);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./radio_snapshot.h"
+
+// Completed ensemble databases stored on disk so the service list is available straight after tuning
+// - Databases are keyed by the tuned frequency and the ensemble id since the same frequency
+//   can carry a different ensemble depending on where you are
+// - Only the ensemble, services, service components and subchannels are stored which is what the
+//   service list and channel view need, the rest is filled in by the live fic
+// - Files are written by a worker thread so the radio thread never waits on the disk
+class Ensemble_Database_Cache
+{
+private:
+    struct Entry {
+        uint32_t frequency_khz = 0;
+        uint32_t ensemble_id = 0;
+        // unix time so the most recent ensemble on a frequency is known after a restart
+        uint64_t store_time = 0;
+        std::shared_ptr<const Radio_Database> database;
+    };
+    const std::string m_directory;
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_pending_entries;
+    std::condition_variable m_cv_pending;
+    bool m_is_running;
+    std::thread m_thread;
+public:
+    explicit Ensemble_Database_Cache(const std::string& directory);
+    ~Ensemble_Database_Cache();
+    Ensemble_Database_Cache(const Ensemble_Database_Cache&) = delete;
+    Ensemble_Database_Cache& operator=(const Ensemble_Database_Cache&) = delete;
+    // most recently stored ensemble at this frequency, returns nullptr if there is none
+    std::shared_ptr<const Radio_Database> load(double frequency);
+    std::shared_ptr<const Radio_Database> load(double frequency, uint32_t ensemble_id);
+    // called from the radio thread
+    void store(double frequency, std::shared_ptr<const Radio_Database> database);
+    size_t get_total_entries();
+    const std::string& get_directory() const { return m_directory; }
+private:
+    Entry* find_entry(uint32_t frequency_khz, uint32_t ensemble_id);
+    void load_entries();
+    bool write_entry(const Entry& entry);
+    void run_writer();
+};
+
+// NOTE: The database is only worth storing once every service has a label
+bool is_ensemble_database_complete(const Radio_Database& database, const Radio_Database_Statistics& statistics);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Lets a thread sleep until another thread has something for it to do
+// - A notify that happens before the wait isn't lost since the signal stays set until it is consumed
+class Event_Signal
+{
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_is_signalled;
+public:
+    Event_Signal(): m_is_signalled(false) {}
+    Event_Signal(const Event_Signal&) = delete;
+    Event_Signal& operator=(const Event_Signal&) = delete;
+    void notify() {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_is_signalled = true;
+        }
+        m_cv.notify_all();
+    }
+    // returns false if the timeout passed without a notify
+    template <typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> timeout) {
+        auto lock = std::unique_lock(m_mutex);
+        const bool is_signalled = m_cv.wait_for(lock, timeout, [this]() { return m_is_signalled; });
+        m_is_signalled = false;
+        return is_signalled;
+    }
+};
@@ -0,0 +1,93 @@
+#include "./image_decode_pool.h"
+#include <algorithm>
+#include "./slideshow_disk_cache.h"
+
+Image_Decode_Pool::Image_Decode_Pool(size_t total_threads, std::shared_ptr<Slideshow_Disk_Cache> disk_cache)
+: m_disk_cache(disk_cache), m_is_running(true)
+{
+    total_threads = std::max(total_threads, size_t(1));
+    for (size_t i = 0; i < total_threads; i++) {
+        m_threads.push_back(std::make_unique<std::thread>([this]() { run_worker(); }));
+    }
+}
+
+Image_Decode_Pool::~Image_Decode_Pool() {
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_is_running = false;
+        m_jobs.clear();
+        m_cv.notify_all();
+    }
+    for (auto& thread: m_threads) {
+        thread->join();
+    }
+}
+
+void Image_Decode_Pool::submit(
+    uint64_t key, tcb::span<const uint8_t> data, int max_width,
+    std::optional<Disk_Cache_Id> disk_cache_id)
+{
+    Job job;
+    job.key = key;
+    job.data = std::vector<uint8_t>(data.begin(), data.end());
+    job.max_width = max_width;
+    job.disk_cache_id = disk_cache_id;
+    auto lock = std::unique_lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+    m_cv.notify_one();
+}
+
+bool Image_Decode_Pool::cancel(uint64_t key) {
+    auto lock = std::unique_lock(m_mutex);
+    auto it = std::find_if(m_jobs.begin(), m_jobs.end(), [key](const auto& job) { return job.key == key; });
+    if (it == m_jobs.end()) return false;
+    m_jobs.erase(it);
+    return true;
+}
+
+std::optional<Image_Decode_Pool::Result> Image_Decode_Pool::pop_result() {
+    auto lock = std::unique_lock(m_mutex);
+    if (m_results.empty()) return std::nullopt;
+    auto result = std::move(m_results.front());
+    m_results.pop_front();
+    return result;
+}
+
+void Image_Decode_Pool::run_worker() {
+    while (true) {
+        Job job;
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_is_running || !m_jobs.empty(); });
+            if (!m_is_running) break;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        Result result;
+        result.key = job.key;
+        result.image = decode(job);
+        if (result.image != nullptr) {
+            auto downscaled_image = result.image->Downscale(job.max_width);
+            if (downscaled_image != nullptr) {
+                result.image = std::move(downscaled_image);
+                result.is_downscaled = true;
+            }
+        }
+        auto lock = std::unique_lock(m_mutex);
+        m_results.push_back(std::move(result));
+    }
+}
+
+std::unique_ptr<Texture_Image> Image_Decode_Pool::decode(const Job& job) {
+    if ((m_disk_cache == nullptr) || !job.disk_cache_id.has_value()) {
+        return Texture_Image::DecodeFromMemory(job.data.data(), job.data.size());
+    }
+    const auto& id = job.disk_cache_id.value();
+    const auto disk_key = Slideshow_Disk_Cache::get_key(job.data, id.service_id, id.transport_id);
+    auto image = m_disk_cache->load(disk_key);
+    if (image != nullptr) return image;
+    // NOTE: The full resolution image is stored so any thumbnail size can be made from it
+    image = Texture_Image::DecodeFromMemory(job.data.data(), job.data.size());
+    if (image != nullptr) m_disk_cache->store(disk_key, *image);
+    return image;
+}
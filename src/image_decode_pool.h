@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "utility/span.h"
+#include "./texture.h"
+
+class Slideshow_Disk_Cache;
+
+// Decodes compressed images into rgba pixels on a pool of worker threads
+// - Jobs are identified by a key chosen by the caller
+// - Queued jobs can be cancelled if their image is no longer needed
+// - Finished images are polled by the gui thread which does the texture upload
+// - If a disk cache is given then previously decoded images are read from it instead
+class Image_Decode_Pool
+{
+public:
+    struct Disk_Cache_Id {
+        uint32_t service_id = 0;
+        uint16_t transport_id = 0;
+    };
+    struct Result {
+        uint64_t key = 0;
+        // nullptr if the image failed to decode
+        std::unique_ptr<Texture_Image> image = nullptr;
+        // false if the image was already narrower than the requested width
+        bool is_downscaled = false;
+    };
+private:
+    struct Job {
+        uint64_t key = 0;
+        std::vector<uint8_t> data;
+        int max_width = 0;
+        std::optional<Disk_Cache_Id> disk_cache_id = std::nullopt;
+    };
+    std::shared_ptr<Slideshow_Disk_Cache> m_disk_cache;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_jobs;
+    std::deque<Result> m_results;
+    std::vector<std::unique_ptr<std::thread>> m_threads;
+    bool m_is_running;
+public:
+    explicit Image_Decode_Pool(size_t total_threads, std::shared_ptr<Slideshow_Disk_Cache> disk_cache=nullptr);
+    ~Image_Decode_Pool();
+    Image_Decode_Pool(const Image_Decode_Pool&) = delete;
+    Image_Decode_Pool& operator=(const Image_Decode_Pool&) = delete;
+    // NOTE: The data is copied so the caller doesn't need to keep it alive
+    // if max_width is positive then wider images are downscaled to it after decoding
+    void submit(
+        uint64_t key, tcb::span<const uint8_t> data, int max_width=0,
+        std::optional<Disk_Cache_Id> disk_cache_id=std::nullopt);
+    // returns true if the job was still queued
+    // jobs that are already being decoded will still produce a result
+    bool cancel(uint64_t key);
+    std::optional<Result> pop_result();
+private:
+    void run_worker();
+    std::unique_ptr<Texture_Image> decode(const Job& job);
+};
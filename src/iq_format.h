@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+// Sample formats for raw iq files
+enum class IQ_Format {
+    CF32, // complex float32
+    CS16, // complex int16
+    CS8,  // complex int8
+};
+
+inline size_t get_iq_format_bytes_per_sample(IQ_Format format) {
+    switch (format) {
+    case IQ_Format::CF32: return 2*sizeof(float);
+    case IQ_Format::CS16: return 2*sizeof(int16_t);
+    case IQ_Format::CS8:  return 2*sizeof(int8_t);
+    default:              return 0;
+    }
+}
+
+inline const char* get_iq_format_extension(IQ_Format format) {
+    switch (format) {
+    case IQ_Format::CF32: return "cf32";
+    case IQ_Format::CS16: return "cs16";
+    case IQ_Format::CS8:  return "cs8";
+    default:              return "raw";
+    }
+}
+
+// full scale value of integer formats
+inline float get_iq_format_scale(IQ_Format format) {
+    switch (format) {
+    case IQ_Format::CS16: return 32767.0f;
+    case IQ_Format::CS8:  return 127.0f;
+    default:              return 1.0f;
+    }
+}
+
+inline bool get_iq_format_from_extension(std::string_view extension, IQ_Format& format) {
+    if (extension == "cf32" || extension == "fc32") { format = IQ_Format::CF32; return true; }
+    if (extension == "cs16" || extension == "sc16") { format = IQ_Format::CS16; return true; }
+    if (extension == "cs8"  || extension == "sc8")  { format = IQ_Format::CS8;  return true; }
+    return false;
+}
@@ -0,0 +1,158 @@
+#include "./iq_recorder.h"
+#include <assert.h>
+#include <fstream>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <volk/volk.h>
+#include "./async_file_writer.h"
+
+// NOTE: 64MB is a few seconds of cf32 at 2.048MHz which is enough to ride out a slow disk
+constexpr size_t WRITER_BLOCK_SIZE = 1u << 20;
+constexpr size_t WRITER_TOTAL_BLOCKS = 64;
+constexpr auto METADATA_PERIOD = std::chrono::seconds(1);
+
+static std::string escape_json_string(std::string_view str) {
+    std::string out;
+    out.reserve(str.size());
+    for (const char c: str) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (uint8_t(c) < 0x20) {
+                out += fmt::format("\\u{:04x}", int(c));
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+IQ_Recorder::IQ_Recorder(float sample_rate)
+: m_sample_rate(sample_rate),
+  m_writer(std::make_unique<Async_File_Writer>(WRITER_BLOCK_SIZE, WRITER_TOTAL_BLOCKS, 1)),
+  m_file(nullptr), m_format(IQ_Format::CS16), m_gain(1.0f), m_total_samples(0), m_get_metadata(nullptr)
+{}
+
+IQ_Recorder::~IQ_Recorder() {
+    stop();
+}
+
+bool IQ_Recorder::start(const std::string& filepath, IQ_Format format, float gain, Metadata_Callback get_metadata) {
+    stop();
+    auto lock = std::unique_lock(m_mutex);
+    const auto iq_filepath = fmt::format("{}.{}", filepath, get_iq_format_extension(format));
+    m_file = m_writer->open(iq_filepath);
+    if (m_file == nullptr) return false;
+    m_sidecar_filepath = fmt::format("{}.json", iq_filepath);
+    m_format = format;
+    m_gain = gain;
+    m_total_samples = 0;
+    m_get_metadata = get_metadata;
+    m_start_time = std::chrono::system_clock::now();
+    m_last_metadata_time = std::chrono::steady_clock::time_point();
+    m_metadata_timeline.clear();
+    return true;
+}
+
+void IQ_Recorder::stop() {
+    auto lock = std::unique_lock(m_mutex);
+    if (m_file == nullptr) return;
+    m_writer->close(m_file);
+    write_sidecar();
+    m_file = nullptr;
+    m_get_metadata = nullptr;
+}
+
+bool IQ_Recorder::is_recording() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_file != nullptr;
+}
+
+uint64_t IQ_Recorder::get_total_bytes_written() {
+    auto lock = std::unique_lock(m_mutex);
+    return (m_file != nullptr) ? m_file->get_total_bytes_written() : 0;
+}
+
+uint64_t IQ_Recorder::get_total_bytes_dropped() {
+    auto lock = std::unique_lock(m_mutex);
+    return (m_file != nullptr) ? m_file->get_total_bytes_dropped() : 0;
+}
+
+std::string IQ_Recorder::get_filepath() {
+    auto lock = std::unique_lock(m_mutex);
+    return (m_file != nullptr) ? std::string(m_file->get_filepath()) : std::string();
+}
+
+void IQ_Recorder::process(tcb::span<const std::complex<float>> block) {
+    // NOTE: Only contended when starting or stopping a recording
+    auto lock = std::unique_lock(m_mutex);
+    if (m_file == nullptr) return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if ((m_get_metadata != nullptr) && ((now - m_last_metadata_time) >= METADATA_PERIOD)) {
+        m_last_metadata_time = now;
+        m_metadata_timeline.push_back({ m_total_samples.load(), m_get_metadata() });
+    }
+
+    const size_t total_values = block.size()*2;
+    const auto* values = reinterpret_cast<const float*>(block.data());
+    const size_t total_bytes = block.size()*get_iq_format_bytes_per_sample(m_format);
+    if (m_format == IQ_Format::CF32) {
+        if (m_gain == 1.0f) {
+            m_file->write({ reinterpret_cast<const uint8_t*>(values), total_bytes });
+        } else {
+            m_float_buffer.resize(total_values);
+            volk_32f_s32f_multiply_32f(m_float_buffer.data(), values, m_gain, (unsigned int)total_values);
+            m_file->write({ reinterpret_cast<const uint8_t*>(m_float_buffer.data()), total_bytes });
+        }
+    } else {
+        m_quantised_buffer.resize(total_bytes);
+        const float scale = m_gain * get_iq_format_scale(m_format);
+        if (m_format == IQ_Format::CS16) {
+            auto* dest = reinterpret_cast<int16_t*>(m_quantised_buffer.data());
+            volk_32f_s32f_convert_16i(dest, values, scale, (unsigned int)total_values);
+        } else {
+            auto* dest = reinterpret_cast<int8_t*>(m_quantised_buffer.data());
+            volk_32f_s32f_convert_8i(dest, values, scale, (unsigned int)total_values);
+        }
+        m_file->write(m_quantised_buffer);
+    }
+    m_total_samples += block.size();
+}
+
+void IQ_Recorder::write_sidecar() {
+    fmt::memory_buffer out;
+    auto it = std::back_inserter(out);
+    const auto start_time = std::chrono::duration_cast<std::chrono::seconds>(m_start_time.time_since_epoch()).count();
+    const auto filepath = std::string(m_file->get_filepath());
+    fmt::format_to(it, "{{\n");
+    fmt::format_to(it, "  \"filepath\": \"{}\",\n", escape_json_string(filepath));
+    fmt::format_to(it, "  \"format\": \"{}\",\n", get_iq_format_extension(m_format));
+    fmt::format_to(it, "  \"sample_rate\": {:.0f},\n", m_sample_rate);
+    fmt::format_to(it, "  \"gain\": {},\n", m_gain);
+    fmt::format_to(it, "  \"start_time_unix\": {},\n", int64_t(start_time));
+    fmt::format_to(it, "  \"total_samples\": {},\n", m_total_samples.load());
+    fmt::format_to(it, "  \"total_bytes_dropped\": {},\n", m_file->get_total_bytes_dropped());
+    fmt::format_to(it, "  \"timeline\": [\n");
+    for (size_t i = 0; i < m_metadata_timeline.size(); i++) {
+        const auto& [sample_index, metadata] = m_metadata_timeline[i];
+        fmt::format_to(it,
+            "    {{\"sample_index\": {}, \"centre_frequency\": {:.0f}, \"signal_level\": {:.3f}, "
+            "\"ofdm_state\": \"{}\", \"fine_frequency_offset\": {:.3f}, \"coarse_frequency_offset\": {:.3f}, "
+            "\"ensemble_id\": {}, \"ensemble_label\": \"{}\"}}{}\n",
+            sample_index, metadata.centre_frequency, metadata.signal_level,
+            escape_json_string(metadata.ofdm_state), metadata.fine_frequency_offset, metadata.coarse_frequency_offset,
+            metadata.ensemble_id, escape_json_string(metadata.ensemble_label),
+            (i+1 < m_metadata_timeline.size()) ? "," : ""
+        );
+    }
+    fmt::format_to(it, "  ]\n}}\n");
+    auto file = std::ofstream(m_sidecar_filepath);
+    if (!file) return;
+    file.write(out.data(), std::streamsize(out.size()));
+}
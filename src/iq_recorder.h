@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "./iq_format.h"
+#include "utility/span.h"
+
+class Async_File;
+class Async_File_Writer;
+
+struct IQ_Recorder_Metadata {
+    double centre_frequency = 0.0;
+    float signal_level = 0.0f;
+    std::string ofdm_state;
+    float fine_frequency_offset = 0.0f;
+    float coarse_frequency_offset = 0.0f;
+    uint32_t ensemble_id = 0;
+    std::string ensemble_label;
+};
+
+// Records the iq stream fed to the ofdm demodulator
+// - Samples are quantised on the dsp thread and written to disk on a separate thread
+// - A json sidecar records the tuning and demodulator state over the course of the recording
+class IQ_Recorder
+{
+public:
+    // NOTE: Called from the dsp thread so it must not touch gui state
+    using Metadata_Callback = std::function<IQ_Recorder_Metadata()>;
+private:
+    const float m_sample_rate;
+    std::unique_ptr<Async_File_Writer> m_writer;
+    std::mutex m_mutex;
+    std::shared_ptr<Async_File> m_file;
+    std::string m_sidecar_filepath;
+    IQ_Format m_format;
+    float m_gain;
+    // NOTE: Written by the dsp thread and read by the gui
+    std::atomic<uint64_t> m_total_samples;
+    std::vector<float> m_float_buffer;
+    std::vector<uint8_t> m_quantised_buffer;
+    Metadata_Callback m_get_metadata;
+    std::chrono::system_clock::time_point m_start_time;
+    std::chrono::steady_clock::time_point m_last_metadata_time;
+    std::vector<std::pair<uint64_t, IQ_Recorder_Metadata>> m_metadata_timeline;
+public:
+    explicit IQ_Recorder(float sample_rate);
+    ~IQ_Recorder();
+    // filepath is given without an extension since it depends on the format
+    bool start(const std::string& filepath, IQ_Format format, float gain, Metadata_Callback get_metadata);
+    void stop();
+    bool is_recording();
+    // called from the dsp thread
+    void process(tcb::span<const std::complex<float>> block);
+    uint64_t get_total_samples() const { return m_total_samples; }
+    uint64_t get_total_bytes_written();
+    uint64_t get_total_bytes_dropped();
+    std::string get_filepath();
+private:
+    void write_sidecar();
+};
@@ -0,0 +1,190 @@
+#include "./iq_replay.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "./iq_replay_file.h"
+
+IQ_Replay::IQ_Replay(
+    std::shared_ptr<IQ_Replay_File> file, float sample_rate,
+    Block_Callback on_block, Discontinuity_Callback on_discontinuity,
+    size_t block_size)
+: m_file(file), m_sample_rate(sample_rate), m_block_size(std::max(block_size, size_t(1))),
+  m_on_block(on_block), m_on_discontinuity(on_discontinuity),
+  m_is_running(true), m_is_playing(false), m_is_realtime(true), m_is_looping(false),
+  m_loop_start_frame(0), m_loop_end_frame(file->get_frame_offsets()->size()),
+  m_seek_offset(std::nullopt), m_current_offset(0)
+{
+    m_thread = std::make_unique<std::thread>([this]() { run(); });
+}
+
+IQ_Replay::~IQ_Replay() {
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_is_running = false;
+        m_cv.notify_all();
+    }
+    m_thread->join();
+}
+
+void IQ_Replay::set_is_playing(bool is_playing) {
+    auto lock = std::unique_lock(m_mutex);
+    m_is_playing = is_playing;
+    m_cv.notify_all();
+}
+
+bool IQ_Replay::get_is_playing() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_is_playing;
+}
+
+void IQ_Replay::set_is_realtime(bool is_realtime) {
+    auto lock = std::unique_lock(m_mutex);
+    m_is_realtime = is_realtime;
+}
+
+bool IQ_Replay::get_is_realtime() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_is_realtime;
+}
+
+void IQ_Replay::seek_to_frame(size_t frame_index) {
+    seek_to_sample(get_frame_start(frame_index));
+}
+
+void IQ_Replay::seek_to_sample(size_t offset) {
+    auto lock = std::unique_lock(m_mutex);
+    m_seek_offset = std::min(offset, m_file->get_total_samples());
+    m_current_offset = m_seek_offset.value();
+    m_cv.notify_all();
+}
+
+void IQ_Replay::set_loop(bool is_looping, size_t start_frame, size_t end_frame) {
+    const size_t total_frames = m_file->get_frame_offsets()->size();
+    auto lock = std::unique_lock(m_mutex);
+    m_is_looping = is_looping;
+    m_loop_start_frame = std::min(start_frame, total_frames);
+    m_loop_end_frame = std::clamp(end_frame, m_loop_start_frame, total_frames);
+}
+
+bool IQ_Replay::get_is_looping() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_is_looping;
+}
+
+size_t IQ_Replay::get_loop_start_frame() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_loop_start_frame;
+}
+
+size_t IQ_Replay::get_loop_end_frame() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_loop_end_frame;
+}
+
+size_t IQ_Replay::get_current_frame() const {
+    const auto frame_offsets = m_file->get_frame_offsets();
+    const auto& offsets = *frame_offsets;
+    const size_t offset = m_current_offset;
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), uint64_t(offset));
+    if (it == offsets.begin()) return 0;
+    return size_t(std::distance(offsets.begin(), it)-1);
+}
+
+size_t IQ_Replay::get_frame_start(size_t frame_index) const {
+    const auto frame_offsets = m_file->get_frame_offsets();
+    const auto& offsets = *frame_offsets;
+    if (frame_index >= offsets.size()) return m_file->get_total_samples();
+    // NOTE: Start a little before the null symbol so the demodulator sees the power dip
+    const size_t offset = size_t(offsets[frame_index]);
+    const size_t margin = m_file->get_frame_timing().null_period;
+    return offset - std::min(offset, margin);
+}
+
+void IQ_Replay::run() {
+    // NOTE: The gui only offers seeking and looping once the index has been published
+    if (!m_file->get_is_indexed()) {
+        m_file->update_frame_index([this]() {
+            auto lock = std::unique_lock(m_mutex);
+            return !m_is_running;
+        });
+        auto lock = std::unique_lock(m_mutex);
+        if (!m_is_running) return;
+        m_loop_start_frame = 0;
+        m_loop_end_frame = m_file->get_frame_offsets()->size();
+    }
+
+    std::vector<std::complex<float>> scratch;
+    size_t offset = 0;
+    // NOTE: The consumer was fed from another source before the replay was opened
+    bool is_discontinuity = true;
+    // realtime pacing is measured from the last discontinuity
+    auto pace_start = std::chrono::steady_clock::now();
+    size_t pace_samples = 0;
+    bool is_paced = false;
+    while (true) {
+        size_t end_offset = 0;
+        bool is_realtime = false;
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_is_running || m_is_playing || m_seek_offset.has_value(); });
+            if (!m_is_running) break;
+            if (m_seek_offset.has_value()) {
+                offset = m_seek_offset.value();
+                m_seek_offset = std::nullopt;
+                is_paced = false;
+                is_discontinuity = true;
+            }
+            if (!m_is_playing) {
+                is_paced = false;
+                continue;
+            }
+            size_t start_offset = 0;
+            end_offset = m_file->get_total_samples();
+            if (m_is_looping && (m_loop_start_frame < m_loop_end_frame)) {
+                start_offset = get_frame_start(m_loop_start_frame);
+                end_offset = get_frame_start(m_loop_end_frame);
+                if (offset < start_offset) {
+                    offset = start_offset;
+                    is_discontinuity = true;
+                }
+            }
+            if (offset >= end_offset) {
+                if (m_is_looping) {
+                    // NOTE: The end of the loop doesn't line up with its start
+                    offset = start_offset;
+                    is_discontinuity = true;
+                } else {
+                    m_is_playing = false;
+                    continue;
+                }
+            }
+            is_realtime = m_is_realtime;
+        }
+
+        const size_t length = std::min(m_block_size, end_offset-offset);
+        auto block = m_file->read(offset, length, scratch);
+        if (block.empty()) continue;
+        if (is_discontinuity) {
+            if (!m_on_discontinuity()) break;
+            is_discontinuity = false;
+        }
+        if (!m_on_block(block)) break;
+        offset += block.size();
+        m_current_offset = offset;
+
+        if (!is_realtime) {
+            is_paced = false;
+            continue;
+        }
+        if (!is_paced) {
+            pace_start = std::chrono::steady_clock::now();
+            pace_samples = 0;
+            is_paced = true;
+        }
+        pace_samples += block.size();
+        const auto target = pace_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(double(pace_samples) / double(m_sample_rate))
+        );
+        std::this_thread::sleep_until(target);
+    }
+}
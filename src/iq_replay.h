@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include "utility/span.h"
+
+class IQ_Replay_File;
+
+// Plays back a recording on its own thread with seeking and looping over whole frames
+// - Realtime playback is paced to the sample rate, otherwise blocks are pushed as fast as the consumer takes them
+// - The file is indexed on this thread before playback starts if its index wasn't cached
+// - Seeking or looping back is signalled before the first block after the jump so the consumer can resync
+class IQ_Replay
+{
+public:
+    // returns false if the consumer is shutting down
+    using Block_Callback = std::function<bool(tcb::span<const std::complex<float>>)>;
+    // returns false if the consumer is shutting down
+    using Discontinuity_Callback = std::function<bool()>;
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 16384;
+private:
+    std::shared_ptr<IQ_Replay_File> m_file;
+    const float m_sample_rate;
+    const size_t m_block_size;
+    Block_Callback m_on_block;
+    Discontinuity_Callback m_on_discontinuity;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_is_running;
+    bool m_is_playing;
+    bool m_is_realtime;
+    bool m_is_looping;
+    size_t m_loop_start_frame;
+    size_t m_loop_end_frame;
+    std::optional<size_t> m_seek_offset;
+    std::atomic<size_t> m_current_offset;
+    std::unique_ptr<std::thread> m_thread;
+public:
+    IQ_Replay(
+        std::shared_ptr<IQ_Replay_File> file, float sample_rate,
+        Block_Callback on_block, Discontinuity_Callback on_discontinuity,
+        size_t block_size=DEFAULT_BLOCK_SIZE);
+    ~IQ_Replay();
+    IQ_Replay(const IQ_Replay&) = delete;
+    IQ_Replay& operator=(const IQ_Replay&) = delete;
+    const std::shared_ptr<IQ_Replay_File>& get_file() const { return m_file; }
+    void set_is_playing(bool is_playing);
+    bool get_is_playing();
+    void set_is_realtime(bool is_realtime);
+    bool get_is_realtime();
+    // seek to the frame index in the file's frame index
+    void seek_to_frame(size_t frame_index);
+    void seek_to_sample(size_t offset);
+    // loops over frames [start_frame, end_frame)
+    void set_loop(bool is_looping, size_t start_frame, size_t end_frame);
+    bool get_is_looping();
+    size_t get_loop_start_frame();
+    size_t get_loop_end_frame();
+    size_t get_current_offset() const { return m_current_offset; }
+    size_t get_current_frame() const;
+private:
+    void run();
+    size_t get_frame_start(size_t frame_index) const;
+};
@@ -0,0 +1,246 @@
+#include "./iq_replay_file.h"
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <volk/volk.h>
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// NOTE: The null symbol is found to within a power block which is plenty since the
+//       demodulator does its own fine time sync once it is handed the frame
+constexpr size_t POWER_BLOCK_SIZE = 64;
+constexpr size_t POWER_CHUNK_SIZE = POWER_BLOCK_SIZE*4096;
+// maximum drift between frames in power blocks before we assume sync was lost
+constexpr size_t NULL_SEARCH_TOLERANCE = 8;
+// null symbol must have less than this fraction of the average frame power
+constexpr double NULL_POWER_THRESHOLD = 0.5;
+constexpr char INDEX_MAGIC[8] = { 'D','A','B','I','D','X','0','1' };
+
+Memory_Mapped_File::Memory_Mapped_File()
+: m_data(nullptr), m_size(0),
+#if _WIN32
+  m_file_handle(INVALID_HANDLE_VALUE), m_mapping_handle(nullptr)
+#else
+  m_fd(-1)
+#endif
+{}
+
+std::unique_ptr<Memory_Mapped_File> Memory_Mapped_File::open(const std::string& filepath) {
+    auto file = std::unique_ptr<Memory_Mapped_File>(new Memory_Mapped_File());
+#if _WIN32
+    file->m_file_handle = CreateFileA(
+        filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    );
+    if (file->m_file_handle == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->m_file_handle, &size) || (size.QuadPart == 0)) return nullptr;
+    file->m_mapping_handle = CreateFileMappingA(file->m_file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file->m_mapping_handle == nullptr) return nullptr;
+    auto* data = MapViewOfFile(file->m_mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) return nullptr;
+    file->m_data = reinterpret_cast<const uint8_t*>(data);
+    file->m_size = size_t(size.QuadPart);
+#else
+    file->m_fd = ::open(filepath.c_str(), O_RDONLY);
+    if (file->m_fd < 0) return nullptr;
+    struct stat info;
+    if ((fstat(file->m_fd, &info) != 0) || (info.st_size <= 0)) return nullptr;
+    auto* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file->m_fd, 0);
+    if (data == MAP_FAILED) return nullptr;
+    // replay mostly walks forward through the file
+    madvise(data, size_t(info.st_size), MADV_SEQUENTIAL);
+    file->m_data = reinterpret_cast<const uint8_t*>(data);
+    file->m_size = size_t(info.st_size);
+#endif
+    return file;
+}
+
+Memory_Mapped_File::~Memory_Mapped_File() {
+#if _WIN32
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping_handle != nullptr) CloseHandle(m_mapping_handle);
+    if (m_file_handle != INVALID_HANDLE_VALUE) CloseHandle(m_file_handle);
+#else
+    if (m_data != nullptr) munmap(const_cast<uint8_t*>(m_data), m_size);
+    if (m_fd >= 0) close(m_fd);
+#endif
+}
+
+std::unique_ptr<IQ_Replay_File> IQ_Replay_File::open(const std::string& filepath, Frame_Timing timing) {
+    const size_t extension_index = filepath.find_last_of('.');
+    if (extension_index == std::string::npos) return nullptr;
+    IQ_Format format;
+    if (!get_iq_format_from_extension(std::string_view(filepath).substr(extension_index+1), format)) return nullptr;
+    auto file = Memory_Mapped_File::open(filepath);
+    if (file == nullptr) return nullptr;
+    auto replay_file = std::unique_ptr<IQ_Replay_File>(new IQ_Replay_File(std::move(file), filepath, format, timing));
+    std::vector<uint64_t> frame_offsets;
+    if (replay_file->load_frame_index(replay_file->get_index_filepath(), frame_offsets)) {
+        std::atomic_store(&replay_file->m_frame_offsets, std::make_shared<const std::vector<uint64_t>>(std::move(frame_offsets)));
+        replay_file->m_is_indexed = true;
+    }
+    return replay_file;
+}
+
+IQ_Replay_File::IQ_Replay_File(std::unique_ptr<Memory_Mapped_File> file, std::string_view filepath, IQ_Format format, Frame_Timing timing)
+: m_file(std::move(file)), m_filepath(filepath), m_format(format), m_timing(timing),
+  m_total_samples(m_file->get_data().size() / get_iq_format_bytes_per_sample(format)),
+  m_frame_offsets(std::make_shared<const std::vector<uint64_t>>()), m_is_indexed(false)
+{}
+
+void IQ_Replay_File::update_frame_index(std::function<bool()> is_cancelled) {
+    if (m_is_indexed) return;
+    auto frame_offsets = build_frame_index(is_cancelled);
+    if (!frame_offsets.has_value()) return;
+    save_frame_index(get_index_filepath(), frame_offsets.value());
+    std::atomic_store(&m_frame_offsets, std::make_shared<const std::vector<uint64_t>>(std::move(frame_offsets.value())));
+    m_is_indexed = true;
+}
+
+tcb::span<const std::complex<float>> IQ_Replay_File::read(size_t offset, size_t length, std::vector<std::complex<float>>& scratch) const {
+    offset = std::min(offset, m_total_samples);
+    length = std::min(length, m_total_samples-offset);
+    const uint8_t* src = m_file->get_data().data() + offset*get_iq_format_bytes_per_sample(m_format);
+    const float scale = get_iq_format_scale(m_format);
+    switch (m_format) {
+    case IQ_Format::CF32:
+        return { reinterpret_cast<const std::complex<float>*>(src), length };
+    case IQ_Format::CS16:
+        scratch.resize(length);
+        volk_16i_s32f_convert_32f(
+            reinterpret_cast<float*>(scratch.data()), reinterpret_cast<const int16_t*>(src),
+            scale, (unsigned int)(length*2)
+        );
+        return { scratch.data(), length };
+    case IQ_Format::CS8:
+        scratch.resize(length);
+        volk_8i_s32f_convert_32f(
+            reinterpret_cast<float*>(scratch.data()), reinterpret_cast<const int8_t*>(src),
+            scale, (unsigned int)(length*2)
+        );
+        return { scratch.data(), length };
+    default:
+        return {};
+    }
+}
+
+std::optional<std::vector<uint64_t>> IQ_Replay_File::build_frame_index(const std::function<bool()>& is_cancelled) const {
+    std::vector<uint64_t> frame_offsets;
+    // prefix sum of the power in each block so that windowed sums are O(1)
+    const size_t total_blocks = m_total_samples / POWER_BLOCK_SIZE;
+    std::vector<double> power_sum(total_blocks+1, 0.0);
+    std::vector<std::complex<float>> scratch;
+    std::vector<float> magnitude(POWER_CHUNK_SIZE);
+    for (size_t chunk_start = 0; chunk_start < total_blocks*POWER_BLOCK_SIZE; chunk_start += POWER_CHUNK_SIZE) {
+        if (is_cancelled && is_cancelled()) return std::nullopt;
+        const size_t length = std::min(POWER_CHUNK_SIZE, total_blocks*POWER_BLOCK_SIZE - chunk_start);
+        auto samples = read(chunk_start, length, scratch);
+        volk_32fc_magnitude_squared_32f(magnitude.data(), samples.data(), (unsigned int)samples.size());
+        for (size_t i = 0; i < samples.size(); i += POWER_BLOCK_SIZE) {
+            float block_power = 0.0f;
+            for (size_t j = 0; j < POWER_BLOCK_SIZE; j++) {
+                block_power += magnitude[i+j];
+            }
+            const size_t block_index = (chunk_start+i) / POWER_BLOCK_SIZE;
+            power_sum[block_index+1] = power_sum[block_index] + double(block_power);
+        }
+    }
+
+    const size_t L = std::max(m_timing.null_period / POWER_BLOCK_SIZE, size_t(1));
+    const size_t F = std::max(m_timing.frame_period / POWER_BLOCK_SIZE, L+1);
+    if (total_blocks < F+L) return frame_offsets;
+    auto get_window_power = [&](size_t start, size_t length) {
+        const size_t end = std::min(start+length, total_blocks);
+        return power_sum[end] - power_sum[start];
+    };
+    auto is_null_symbol = [&](size_t index) {
+        // compare against the frame surrounding the candidate null symbol
+        const size_t frame_start = (index > F/2) ? (index - F/2) : 0;
+        const double frame_power = get_window_power(frame_start, F) / double(F);
+        return get_window_power(index, L) < NULL_POWER_THRESHOLD*frame_power*double(L);
+    };
+
+    const size_t last_index = total_blocks-L;
+    size_t search_start = 0;
+    size_t search_end = std::min(F, last_index);
+    while (search_start < search_end) {
+        size_t best_index = search_start;
+        double best_power = get_window_power(search_start, L);
+        for (size_t i = search_start+1; i < search_end; i++) {
+            const double power = get_window_power(i, L);
+            if (power < best_power) {
+                best_power = power;
+                best_index = i;
+            }
+        }
+        if (is_null_symbol(best_index)) {
+            frame_offsets.push_back(uint64_t(best_index)*POWER_BLOCK_SIZE);
+            // track the next null symbol within a small window
+            const size_t expected_index = best_index + F;
+            search_start = expected_index - std::min(NULL_SEARCH_TOLERANCE, expected_index);
+            search_end = std::min(expected_index + NULL_SEARCH_TOLERANCE + 1, last_index);
+        } else {
+            // lost sync so search the next frame length
+            search_start = search_end;
+            search_end = std::min(search_start + F, last_index);
+        }
+    }
+    return frame_offsets;
+}
+
+bool IQ_Replay_File::load_frame_index(const std::string& index_filepath, std::vector<uint64_t>& frame_offsets) const {
+    auto file = std::ifstream(index_filepath, std::ios::binary);
+    if (!file.is_open()) return false;
+    char magic[sizeof(INDEX_MAGIC)];
+    uint64_t file_size = 0;
+    uint32_t format = 0;
+    uint32_t null_period = 0;
+    uint64_t frame_period = 0;
+    uint64_t total_frames = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&file_size), sizeof(file_size));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&null_period), sizeof(null_period));
+    file.read(reinterpret_cast<char*>(&frame_period), sizeof(frame_period));
+    file.read(reinterpret_cast<char*>(&total_frames), sizeof(total_frames));
+    if (!file) return false;
+    // NOTE: The recording could have been overwritten since the index was made
+    if (memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) return false;
+    if (file_size != uint64_t(m_file->get_data().size())) return false;
+    if (format != uint32_t(m_format)) return false;
+    if ((null_period != uint32_t(m_timing.null_period)) || (frame_period != uint64_t(m_timing.frame_period))) return false;
+    if (total_frames > m_total_samples) return false;
+    frame_offsets.resize(size_t(total_frames));
+    file.read(reinterpret_cast<char*>(frame_offsets.data()), std::streamsize(total_frames*sizeof(uint64_t)));
+    if (!file) {
+        frame_offsets.clear();
+        return false;
+    }
+    return true;
+}
+
+void IQ_Replay_File::save_frame_index(const std::string& index_filepath, const std::vector<uint64_t>& frame_offsets) const {
+    auto file = std::ofstream(index_filepath, std::ios::binary);
+    if (!file.is_open()) return;
+    const uint64_t file_size = uint64_t(m_file->get_data().size());
+    const uint32_t format = uint32_t(m_format);
+    const uint32_t null_period = uint32_t(m_timing.null_period);
+    const uint64_t frame_period = uint64_t(m_timing.frame_period);
+    const uint64_t total_frames = uint64_t(frame_offsets.size());
+    file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    file.write(reinterpret_cast<const char*>(&file_size), sizeof(file_size));
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(reinterpret_cast<const char*>(&null_period), sizeof(null_period));
+    file.write(reinterpret_cast<const char*>(&frame_period), sizeof(frame_period));
+    file.write(reinterpret_cast<const char*>(&total_frames), sizeof(total_frames));
+    file.write(reinterpret_cast<const char*>(frame_offsets.data()), std::streamsize(total_frames*sizeof(uint64_t)));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "./iq_format.h"
+#include "utility/span.h"
+
+// Read only memory mapping of an entire file
+class Memory_Mapped_File
+{
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+#if _WIN32
+    void* m_file_handle;
+    void* m_mapping_handle;
+#else
+    int m_fd;
+#endif
+public:
+    // returns nullptr if the file could not be mapped
+    static std::unique_ptr<Memory_Mapped_File> open(const std::string& filepath);
+    ~Memory_Mapped_File();
+    Memory_Mapped_File(const Memory_Mapped_File&) = delete;
+    Memory_Mapped_File& operator=(const Memory_Mapped_File&) = delete;
+    tcb::span<const uint8_t> get_data() const { return { m_data, m_size }; }
+private:
+    Memory_Mapped_File();
+};
+
+// Random access to a raw iq recording with an index of where each dab frame starts
+// - The index is found by searching for the null symbol at the start of each frame
+// - It is cached next to the recording so that reopening a large file is instant
+// - Building the index reads the whole file so it is left to the caller's thread with update_frame_index()
+class IQ_Replay_File
+{
+public:
+    struct Frame_Timing {
+        size_t null_period;  // samples
+        size_t frame_period; // samples including the null symbol
+    };
+private:
+    std::unique_ptr<Memory_Mapped_File> m_file;
+    const std::string m_filepath;
+    const IQ_Format m_format;
+    const Frame_Timing m_timing;
+    const size_t m_total_samples;
+    // NOTE: Accessed with std::atomic_load/atomic_store since it is published by the thread that indexes the file
+    std::shared_ptr<const std::vector<uint64_t>> m_frame_offsets;
+    std::atomic<bool> m_is_indexed;
+public:
+    // format is taken from the file extension, the frame index is only loaded if it was cached
+    static std::unique_ptr<IQ_Replay_File> open(const std::string& filepath, Frame_Timing timing);
+    const std::string& get_filepath() const { return m_filepath; }
+    IQ_Format get_format() const { return m_format; }
+    size_t get_total_samples() const { return m_total_samples; }
+    const Frame_Timing& get_frame_timing() const { return m_timing; }
+    // builds and caches the frame index if it wasn't loaded, this can take a while for a large file
+    // is_cancelled is polled between chunks of the file and returns true to stop without an index
+    void update_frame_index(std::function<bool()> is_cancelled);
+    bool get_is_indexed() const { return m_is_indexed; }
+    // sample offset of the start of each null symbol, empty until the file is indexed
+    std::shared_ptr<const std::vector<uint64_t>> get_frame_offsets() const { return std::atomic_load(&m_frame_offsets); }
+    // returns samples in the range [offset, offset+length) clipped to the end of the file
+    // cf32 files are read in place, other formats are converted into the scratch buffer
+    tcb::span<const std::complex<float>> read(size_t offset, size_t length, std::vector<std::complex<float>>& scratch) const;
+private:
+    IQ_Replay_File(std::unique_ptr<Memory_Mapped_File> file, std::string_view filepath, IQ_Format format, Frame_Timing timing);
+    std::string get_index_filepath() const { return m_filepath + ".index"; }
+    std::optional<std::vector<uint64_t>> build_frame_index(const std::function<bool()>& is_cancelled) const;
+    bool load_frame_index(const std::string& index_filepath, std::vector<uint64_t>& frame_offsets) const;
+    void save_frame_index(const std::string& index_filepath, const std::vector<uint64_t>& frame_offsets) const;
+};
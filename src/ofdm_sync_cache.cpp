@@ -0,0 +1,62 @@
+#include "./ofdm_sync_cache.h"
+#include <algorithm>
+#include <cmath>
+
+// NOTE: Tuning is usually snapped to the channel but allow for an offset while keeping the
+//       narrow channels like 10N and 10A which are 160kHz apart separate
+constexpr uint32_t FREQUENCY_TOLERANCE_KHZ = 50;
+// NOTE: The fine offset wanders by a few Hz while locked so only larger changes are saved
+constexpr float MIN_SAVED_OFFSET_CHANGE_HZ = 25.0f;
+
+static uint32_t get_frequency_khz(double frequency) {
+    return uint32_t(std::round(frequency*1e-3));
+}
+
+Ofdm_Sync_Cache::Entry* Ofdm_Sync_Cache::find_entry(uint32_t frequency_khz) {
+    Entry* closest_entry = nullptr;
+    uint32_t closest_offset_khz = FREQUENCY_TOLERANCE_KHZ+1;
+    for (auto& entry: m_entries) {
+        const uint32_t offset_khz = std::max(entry.frequency_khz, frequency_khz) - std::min(entry.frequency_khz, frequency_khz);
+        if (offset_khz >= closest_offset_khz) continue;
+        closest_entry = &entry;
+        closest_offset_khz = offset_khz;
+    }
+    return closest_entry;
+}
+
+std::optional<Ofdm_Sync_State> Ofdm_Sync_Cache::load(double frequency) {
+    auto lock = std::unique_lock(m_mutex);
+    const auto* entry = find_entry(get_frequency_khz(frequency));
+    if (entry == nullptr) return std::nullopt;
+    return entry->state;
+}
+
+void Ofdm_Sync_Cache::store(double frequency, const Ofdm_Sync_State& state) {
+    const uint32_t frequency_khz = get_frequency_khz(frequency);
+    if (frequency_khz == 0) return;
+    auto lock = std::unique_lock(m_mutex);
+    auto* entry = find_entry(frequency_khz);
+    if (entry == nullptr) {
+        m_entries.push_back({ frequency_khz, state });
+        m_revision++;
+        return;
+    }
+    const float change = std::abs(entry->state.get_net_frequency_offset() - state.get_net_frequency_offset());
+    entry->state = state;
+    if (change >= MIN_SAVED_OFFSET_CHANGE_HZ) m_revision++;
+}
+
+uint64_t Ofdm_Sync_Cache::get_revision() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_revision;
+}
+
+std::vector<Ofdm_Sync_Cache::Entry> Ofdm_Sync_Cache::get_entries() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_entries;
+}
+
+void Ofdm_Sync_Cache::set_entries(const std::vector<Entry>& entries) {
+    auto lock = std::unique_lock(m_mutex);
+    m_entries = entries;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Frequency offsets and signal level measured while the demodulator was locked
+// - The offset is mostly from our sdr's oscillator and the transmitter so it barely changes between visits
+// - Offsets are in Hz and include any rotation that was applied before the demodulator
+struct Ofdm_Sync_State {
+    float coarse_frequency_offset = 0.0f;
+    float fine_frequency_offset = 0.0f;
+    float signal_level = 0.0f;
+    float get_net_frequency_offset() const { return coarse_frequency_offset + fine_frequency_offset; }
+};
+
+// Remembers the sync state of each tuned frequency so a retune can be seeded instead of searching again
+class Ofdm_Sync_Cache
+{
+public:
+    struct Entry {
+        uint32_t frequency_khz = 0;
+        Ofdm_Sync_State state;
+    };
+private:
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    // only advances for changes that are worth saving
+    uint64_t m_revision;
+public:
+    Ofdm_Sync_Cache(): m_revision(0) {}
+    std::optional<Ofdm_Sync_State> load(double frequency);
+    // called from the ofdm thread
+    void store(double frequency, const Ofdm_Sync_State& state);
+    uint64_t get_revision();
+    // for saving and restoring the cache
+    std::vector<Entry> get_entries();
+    void set_entries(const std::vector<Entry>& entries);
+private:
+    Entry* find_entry(uint32_t frequency_khz);
+};
@@ -0,0 +1,206 @@
+#include "./pipeline_telemetry.h"
+#include <algorithm>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static size_t get_msb_index(uint64_t value) {
+    size_t index = 0;
+    while (value >>= 1) index++;
+    return index;
+}
+
+size_t Latency_Histogram::get_bucket_index(uint64_t value) {
+    if (value < TOTAL_LINEAR_BUCKETS) return size_t(value);
+    const size_t exponent = get_msb_index(value);
+    const size_t sub_index = size_t(value >> (exponent-TOTAL_SUB_BITS)) & (TOTAL_SUB_BUCKETS-1);
+    return TOTAL_LINEAR_BUCKETS + (exponent-(TOTAL_SUB_BITS+1))*TOTAL_SUB_BUCKETS + sub_index;
+}
+
+uint64_t Latency_Histogram::get_bucket_lower_bound(size_t index) {
+    if (index < TOTAL_LINEAR_BUCKETS) return uint64_t(index);
+    const size_t offset = index - TOTAL_LINEAR_BUCKETS;
+    const size_t exponent = offset/TOTAL_SUB_BUCKETS + (TOTAL_SUB_BITS+1);
+    const uint64_t sub_index = uint64_t(offset % TOTAL_SUB_BUCKETS);
+    return (uint64_t(TOTAL_SUB_BUCKETS) + sub_index) << (exponent-TOTAL_SUB_BITS);
+}
+
+void Latency_Histogram::record(uint64_t value) {
+    m_buckets[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    m_total_count.fetch_add(1, std::memory_order_relaxed);
+    m_total_sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max_value = m_max_value.load(std::memory_order_relaxed);
+    while (value > max_value) {
+        if (m_max_value.compare_exchange_weak(max_value, value, std::memory_order_relaxed)) break;
+    }
+}
+
+void Latency_Histogram::reset() {
+    for (auto& bucket: m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_total_count.store(0, std::memory_order_relaxed);
+    m_total_sum.store(0, std::memory_order_relaxed);
+    m_max_value.store(0, std::memory_order_relaxed);
+}
+
+double Latency_Histogram::get_mean() const {
+    const uint64_t total_count = get_total_count();
+    if (total_count == 0) return 0.0;
+    return double(m_total_sum.load(std::memory_order_relaxed)) / double(total_count);
+}
+
+uint64_t Latency_Histogram::get_quantile(double quantile) const {
+    // NOTE: The total count can be updated while we are reading the buckets
+    //       so we sum the buckets ourselves for a consistent result
+    uint64_t total_count = 0;
+    for (const auto& bucket: m_buckets) {
+        total_count += bucket.load(std::memory_order_relaxed);
+    }
+    if (total_count == 0) return 0;
+    const uint64_t target_count = std::max(uint64_t(1), uint64_t(quantile*double(total_count) + 0.5));
+    uint64_t count = 0;
+    for (size_t i = 0; i < TOTAL_BUCKETS; i++) {
+        count += m_buckets[i].load(std::memory_order_relaxed);
+        if (count >= target_count) {
+            // report the upper bound of the bucket clamped to the largest recorded value
+            const uint64_t upper_bound = (i+1 < TOTAL_BUCKETS) ? (get_bucket_lower_bound(i+1)-1) : UINT64_MAX;
+            return std::min(upper_bound, get_max_value());
+        }
+    }
+    return get_max_value();
+}
+
+uint64_t get_current_thread_cpu_time_ns() {
+#if _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+    auto to_u64 = [](FILETIME t) { return (uint64_t(t.dwHighDateTime) << 32) | uint64_t(t.dwLowDateTime); };
+    // NOTE: FILETIME is in units of 100ns
+    return (to_u64(kernel_time) + to_u64(user_time)) * 100;
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return uint64_t(ts.tv_sec)*1'000'000'000 + uint64_t(ts.tv_nsec);
+#endif
+}
+
+Pipeline_Stage::Pipeline_Stage(std::string_view name)
+: m_name(name), m_cpu_usage(0.0f), m_last_cpu_ns(0), m_last_wall_time()
+{}
+
+void Pipeline_Stage::record(std::chrono::steady_clock::duration elapsed) {
+    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    m_histogram.record(uint64_t(std::max<int64_t>(0, int64_t(elapsed_us))));
+    update_cpu_usage();
+}
+
+uint64_t get_process_cpu_time_ns() {
+#if _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+    auto to_u64 = [](FILETIME t) { return (uint64_t(t.dwHighDateTime) << 32) | uint64_t(t.dwLowDateTime); };
+    // NOTE: FILETIME is in units of 100ns
+    return (to_u64(kernel_time) + to_u64(user_time)) * 100;
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+    return uint64_t(ts.tv_sec)*1'000'000'000 + uint64_t(ts.tv_nsec);
+#endif
+}
+
+constexpr auto CPU_USAGE_UPDATE_PERIOD = std::chrono::milliseconds(500);
+
+void Pipeline_Stage::update_cpu_usage() {
+    // NOTE: A stage is normally only run from one thread but guard against it anyway
+    auto lock = std::unique_lock(m_mutex_cpu_sample, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    const auto wall_time = std::chrono::steady_clock::now();
+    if ((wall_time - m_last_wall_time) < CPU_USAGE_UPDATE_PERIOD) return;
+    const uint64_t cpu_ns = get_current_thread_cpu_time_ns();
+    const bool is_first_sample = (m_last_cpu_ns == 0);
+    if (!is_first_sample && (cpu_ns >= m_last_cpu_ns)) {
+        const auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wall_time - m_last_wall_time).count();
+        m_cpu_usage.store(float(double(cpu_ns - m_last_cpu_ns) / double(wall_ns)), std::memory_order_relaxed);
+    }
+    m_last_cpu_ns = cpu_ns;
+    m_last_wall_time = wall_time;
+}
+
+Pipeline_Telemetry::Pipeline_Telemetry()
+: m_process_cpu_usage(0.0f), m_last_process_cpu_ns(0), m_last_process_wall_time()
+{
+    m_stages[size_t(Stage::IQ_INGEST)] = std::make_unique<Pipeline_Stage>("IQ Ingest");
+    m_stages[size_t(Stage::OFDM_DEMOD)] = std::make_unique<Pipeline_Stage>("OFDM Demod");
+    m_stages[size_t(Stage::RADIO_DECODE)] = std::make_unique<Pipeline_Stage>("Radio Decode");
+    m_stages[size_t(Stage::AUDIO_OUTPUT)] = std::make_unique<Pipeline_Stage>("Audio Output");
+    m_stages[size_t(Stage::GUI_RENDER)] = std::make_unique<Pipeline_Stage>("GUI Render");
+    m_stages[size_t(Stage::GUI_LOCK_WAIT)] = std::make_unique<Pipeline_Stage>("GUI Lock Wait");
+}
+
+void Pipeline_Telemetry::add_gauge(Gauge gauge) {
+    auto lock = std::unique_lock(m_mutex_gauges);
+    m_gauges.push_back(std::move(gauge));
+}
+
+std::vector<Pipeline_Telemetry::Gauge> Pipeline_Telemetry::get_gauges() {
+    auto lock = std::unique_lock(m_mutex_gauges);
+    return m_gauges;
+}
+
+float Pipeline_Telemetry::get_process_cpu_usage() {
+    auto lock = std::unique_lock(m_mutex_process_cpu_sample);
+    const auto wall_time = std::chrono::steady_clock::now();
+    if ((wall_time - m_last_process_wall_time) < CPU_USAGE_UPDATE_PERIOD) return m_process_cpu_usage;
+    const uint64_t cpu_ns = get_process_cpu_time_ns();
+    const bool is_first_sample = (m_last_process_cpu_ns == 0);
+    if (!is_first_sample && (cpu_ns >= m_last_process_cpu_ns)) {
+        const auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wall_time - m_last_process_wall_time).count();
+        m_process_cpu_usage = float(double(cpu_ns - m_last_process_cpu_ns) / double(wall_ns));
+    }
+    m_last_process_cpu_ns = cpu_ns;
+    m_last_process_wall_time = wall_time;
+    return m_process_cpu_usage;
+}
+
+void Pipeline_Telemetry::reset() {
+    for (auto& stage: m_stages) {
+        stage->reset();
+    }
+}
+
+std::string Pipeline_Telemetry::to_json() {
+    fmt::memory_buffer out;
+    auto it = std::back_inserter(out);
+    fmt::format_to(it, "{{\n  \"process_cpu_usage\": {:.3f},\n  \"stages\": [\n", get_process_cpu_usage());
+    for (size_t i = 0; i < m_stages.size(); i++) {
+        const auto& stage = *m_stages[i];
+        const auto& histogram = stage.get_histogram();
+        fmt::format_to(it,
+            "    {{\"name\": \"{}\", \"count\": {}, \"mean_us\": {:.1f}, \"p50_us\": {}, \"p90_us\": {}, "
+            "\"p99_us\": {}, \"max_us\": {}, \"thread_cpu_usage\": {:.3f}}}{}\n",
+            stage.get_name(), histogram.get_total_count(), histogram.get_mean(),
+            histogram.get_quantile(0.5), histogram.get_quantile(0.9), histogram.get_quantile(0.99),
+            histogram.get_max_value(), stage.get_cpu_usage(),
+            (i+1 < m_stages.size()) ? "," : ""
+        );
+    }
+    fmt::format_to(it, "  ],\n  \"buffers\": [\n");
+    const auto gauges = get_gauges();
+    for (size_t i = 0; i < gauges.size(); i++) {
+        const auto& gauge = gauges[i];
+        fmt::format_to(it, "    {{\"name\": \"{}\", \"used\": {}, \"capacity\": {}}}{}\n",
+            gauge.name, gauge.get_used(), gauge.get_capacity(),
+            (i+1 < gauges.size()) ? "," : ""
+        );
+    }
+    fmt::format_to(it, "  ]\n}}\n");
+    return fmt::to_string(out);
+}
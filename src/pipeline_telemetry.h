@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lock free histogram with logarithmic buckets that are linearly subdivided
+// This gives a fixed relative precision over the entire range like HDR histograms
+class Latency_Histogram
+{
+public:
+    static constexpr size_t TOTAL_SUB_BITS = 4;
+    static constexpr size_t TOTAL_SUB_BUCKETS = size_t(1) << TOTAL_SUB_BITS;
+    static constexpr size_t TOTAL_LINEAR_BUCKETS = TOTAL_SUB_BUCKETS*2;
+    static constexpr size_t TOTAL_EXPONENTS = 64-(TOTAL_SUB_BITS+1);
+    static constexpr size_t TOTAL_BUCKETS = TOTAL_LINEAR_BUCKETS + TOTAL_EXPONENTS*TOTAL_SUB_BUCKETS;
+private:
+    std::array<std::atomic<uint64_t>, TOTAL_BUCKETS> m_buckets;
+    std::atomic<uint64_t> m_total_count;
+    std::atomic<uint64_t> m_total_sum;
+    std::atomic<uint64_t> m_max_value;
+public:
+    Latency_Histogram() { reset(); }
+    void record(uint64_t value);
+    void reset();
+    uint64_t get_total_count() const { return m_total_count.load(std::memory_order_relaxed); }
+    uint64_t get_max_value() const { return m_max_value.load(std::memory_order_relaxed); }
+    double get_mean() const;
+    // quantile in range [0,1]
+    uint64_t get_quantile(double quantile) const;
+    static size_t get_bucket_index(uint64_t value);
+    static uint64_t get_bucket_lower_bound(size_t index);
+};
+
+// Processing time of a stage in the pipeline and the cpu usage of the thread running it
+// NOTE: Work handed to the ofdm and dab worker pools runs on other threads and isn't counted here
+class Pipeline_Stage
+{
+private:
+    const std::string m_name;
+    Latency_Histogram m_histogram;
+    std::atomic<float> m_cpu_usage;
+    std::mutex m_mutex_cpu_sample;
+    uint64_t m_last_cpu_ns;
+    std::chrono::steady_clock::time_point m_last_wall_time;
+public:
+    explicit Pipeline_Stage(std::string_view name);
+    std::string_view get_name() const { return m_name; }
+    const Latency_Histogram& get_histogram() const { return m_histogram; }
+    float get_cpu_usage() const { return m_cpu_usage.load(std::memory_order_relaxed); }
+    void reset() { m_histogram.reset(); }
+    // called from the thread running the stage
+    void record(std::chrono::steady_clock::duration elapsed);
+private:
+    void update_cpu_usage();
+};
+
+class Scoped_Stage_Timer
+{
+private:
+    Pipeline_Stage* m_stage;
+    const std::chrono::steady_clock::time_point m_start;
+public:
+    explicit Scoped_Stage_Timer(Pipeline_Stage* stage): m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+    ~Scoped_Stage_Timer() {
+        if (m_stage == nullptr) return;
+        m_stage->record(std::chrono::steady_clock::now() - m_start);
+    }
+    Scoped_Stage_Timer(const Scoped_Stage_Timer&) = delete;
+    Scoped_Stage_Timer& operator=(const Scoped_Stage_Timer&) = delete;
+};
+
+class Pipeline_Telemetry
+{
+public:
+    enum class Stage: size_t {
+        IQ_INGEST=0, OFDM_DEMOD, RADIO_DECODE, AUDIO_OUTPUT, GUI_RENDER, GUI_LOCK_WAIT,
+        TOTAL
+    };
+    struct Gauge {
+        std::string name;
+        std::function<size_t()> get_used;
+        std::function<size_t()> get_capacity;
+    };
+private:
+    std::array<std::unique_ptr<Pipeline_Stage>, size_t(Stage::TOTAL)> m_stages;
+    std::mutex m_mutex_gauges;
+    std::vector<Gauge> m_gauges;
+    std::mutex m_mutex_process_cpu_sample;
+    float m_process_cpu_usage;
+    uint64_t m_last_process_cpu_ns;
+    std::chrono::steady_clock::time_point m_last_process_wall_time;
+public:
+    Pipeline_Telemetry();
+    Pipeline_Stage& get_stage(Stage stage) { return *m_stages[size_t(stage)]; }
+    const auto& get_stages() const { return m_stages; }
+    // cpu time of the whole process including the worker pools relative to one core
+    float get_process_cpu_usage();
+    void add_gauge(Gauge gauge);
+    std::vector<Gauge> get_gauges();
+    void reset();
+    std::string to_json();
+};
+
+// cpu time consumed by the calling thread
+uint64_t get_current_thread_cpu_time_ns();
+// cpu time consumed by every thread in the process
+uint64_t get_process_cpu_time_ns();
+
@@ -1,4 +1,17 @@
 #include "./radio_block.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "./thread_pool_controller.h"
+#include "./pipeline_telemetry.h"
+#include "./radio_snapshot.h"
+#include "./constellation_accumulator.h"
+#include "./carrier_analyser.h"
+#include "./event_signal.h"
+#include "./audio_recorder.h"
+#include "./decode_scheduler.h"
+#include "./ensemble_database_cache.h"
+#include "./ofdm_sync_cache.h"
 #include "dab/constants/dab_parameters.h"
 #include "ofdm/dab_mapper_ref.h"
 #include "ofdm/dab_ofdm_params_ref.h"
@@ -7,77 +20,584 @@
 #include "utility/span.h"
 
 constexpr int TRANSMISSION_MODE = 1;
+// NOTE: Source buffers are sized for the highest dab+ sample rate
+constexpr float MAX_AUDIO_SAMPLE_RATE = 48000.0f;
+constexpr size_t AUDIO_TRANSFER_BLOCK_SIZE = 4096;
+constexpr float OFDM_SAMPLE_RATE = 2.048e6f;
+constexpr float PI = 3.14159265358979323846f;
+// NOTE: The demodulator is handed batches of whole symbols and the iq buffer is a multiple
+//       of this so that batches never wrap around and can be read in place
+constexpr size_t TOTAL_SYMBOLS_PER_IQ_BATCH = 8;
+constexpr size_t TOTAL_IQ_BATCHES = 64;
+// NOTE: Fine tuning within an ensemble shouldn't reset the radio but the closest channels are 160kHz apart
+constexpr double TUNED_FREQUENCY_TOLERANCE_HZ = 50e3;
+// NOTE: Give up on the cached database if the live one never completes such as when a service has no label
+constexpr auto PROVISIONAL_DATABASE_TIMEOUT = std::chrono::seconds(30);
 
-Radio_Block::Radio_Block(size_t ofdm_total_threads, size_t dab_total_threads) 
+// NOTE: The seeded offset is removed before the demodulator so the coarse search only has to cover
+//       drift since it was stored. Carriers are 1kHz apart so this allows for two carriers either way.
+constexpr float SEEDED_MAX_COARSE_FREQ_CORRECTION_HZ = 2e3f;
+constexpr size_t SYNC_SEED_TIMEOUT_FRAMES = 10;
+constexpr size_t SYNC_STORE_PERIOD_FRAMES = 10;
+
+struct Radio_Block::Ofdm_Sync_Seed {
+    double frequency = 0.0;
+    std::optional<Ofdm_Sync_State> state;
+};
+
+struct Radio_Block::Provisional_Database {
+    // the radio it was restored for so a radio that was replaced can't drop it
+    const BasicRadio* radio = nullptr;
+    std::shared_ptr<const Radio_Database> database;
+    uint32_t ensemble_id = 0;
+    std::chrono::steady_clock::time_point expiry_time;
+};
+
+static float get_elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+    const auto dt = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<float, std::milli>(dt).count();
+}
+
+Radio_Block::Radio_Block(std::shared_ptr<Thread_Pool_Controller> thread_pool_controller, size_t total_frame_slots)
 : m_ofdm_params(get_DAB_OFDM_params(TRANSMISSION_MODE)),
   m_dab_params(get_dab_parameters(TRANSMISSION_MODE)),
-  m_ofdm_total_threads(ofdm_total_threads),
-  m_dab_total_threads(dab_total_threads)
+  m_thread_pool_controller(thread_pool_controller),
+  m_decode_scheduler(std::make_shared<Decode_Scheduler>()),
+  m_telemetry(std::make_shared<Pipeline_Telemetry>()),
+  m_ofdm_total_threads(thread_pool_controller->get_ofdm_total_threads()),
+  m_dab_total_threads(thread_pool_controller->get_dab_total_threads()),
+  m_iq_batch_size(size_t(m_ofdm_params.nb_symbol_period)*TOTAL_SYMBOLS_PER_IQ_BATCH),
+  m_total_frame_slots(std::max(total_frame_slots, size_t(1)))
 {
     // setup ofdm
-    auto ofdm_prs_ref = std::vector<std::complex<float>>(m_ofdm_params.nb_fft);
-    get_DAB_PRS_reference(TRANSMISSION_MODE, ofdm_prs_ref);
-    auto ofdm_mapper_ref = std::vector<int>(m_ofdm_params.nb_data_carriers);
-    get_DAB_mapper_ref(ofdm_mapper_ref, m_ofdm_params.nb_fft);
-    m_ofdm_demodulator = std::make_shared<OFDM_Demod>(m_ofdm_params, ofdm_prs_ref, ofdm_mapper_ref, int(m_ofdm_total_threads));
-    auto ring_buffer = std::make_shared<ThreadedRingBuffer<viterbi_bit_t>>(m_dab_params.nb_frame_bits*2);
-    m_ofdm_to_radio_buffer = ring_buffer;
-    m_ofdm_demodulator->On_OFDM_Frame().Attach([ring_buffer](tcb::span<const viterbi_bit_t> buf) {
-        const size_t length = ring_buffer->write(buf);
-        if (length != buf.size()) return;
+    // NOTE: Frames are always written whole so each frame occupies its own slot in the ring buffer
+    //       This lets the radio thread read frames in place without copying them out
+    const size_t frame_size = size_t(m_dab_params.nb_frame_bits);
+    m_ofdm_to_radio_buffer = std::make_unique<Spsc_Ring_Buffer<viterbi_bit_t>>(frame_size*m_total_frame_slots);
+    m_total_frames_dropped = 0;
+    m_is_lossless = false;
+    m_constellation_accumulator = std::make_shared<Constellation_Accumulator>(
+        size_t(m_ofdm_params.nb_data_carriers)*size_t(m_ofdm_params.nb_frame_symbols));
+    m_carrier_analyser = std::make_shared<Carrier_Analyser>(
+        size_t(m_ofdm_params.nb_data_carriers), size_t(m_ofdm_params.nb_fft), OFDM_SAMPLE_RATE);
+    m_ofdm_elapsed_samples = 0;
+    m_ofdm_elapsed_ms = 0.0f;
+    m_sync_frequency = 0.0;
+    m_sync_elapsed_samples = 0;
+    m_sync_start_frames_read = 0;
+    m_is_sync_acquiring = false;
+    m_sync_saved_max_coarse_freq_correction = 0.0f;
+    m_iq_rotation = std::complex<float>(1.0f, 0.0f);
+    m_iq_rotation_step = std::complex<float>(1.0f, 0.0f);
+    m_iq_rotation_offset = 0.0f;
+    m_is_sync_seeded = false;
+    m_is_retune_pending = false;
+    m_total_sync_seeds = 0;
+    m_total_sync_seed_locks = 0;
+    m_total_sync_seed_fallbacks = 0;
+    m_last_sync_lock_ms = 0.0f;
+    m_ofdm_demodulator = create_ofdm_demodulator(m_ofdm_total_threads);
+    m_iq_buffer = std::make_unique<Spsc_Ring_Buffer<std::complex<float>>>(m_iq_batch_size*TOTAL_IQ_BATCHES);
+    m_iq_rotation_buffer.resize(m_iq_batch_size);
+    m_total_iq_overruns = 0;
+    m_total_iq_samples_dropped = 0;
+    m_thread_ofdm = std::make_unique<std::thread>([this]() {
+        while (m_iq_buffer->wait_for_available(m_iq_batch_size)) {
+            auto block = m_iq_buffer->peek(m_iq_batch_size);
+            run_ofdm_demodulator(block);
+            m_iq_buffer->consume(block.size());
+        }
     });
 
     // setup radio thread
-    m_is_radio_thread_running = true;
     m_basic_radio = nullptr;
-    m_thread_radio = std::make_unique<std::thread>([this]() {
-        auto data = std::vector<viterbi_bit_t>(m_dab_params.nb_frame_bits);
-        while (m_is_radio_thread_running) {
-            const size_t length = m_ofdm_to_radio_buffer->read(data);
-            if (length != data.size()) break;
-            auto lock = std::unique_lock(m_mutex_basic_radio);
-            if (m_basic_radio == nullptr) continue;
-            auto radio = m_basic_radio;
-            lock.unlock(); // prevent locking in gui thread
-            radio->Process(data);
+    m_thread_radio = std::make_unique<std::thread>([this, frame_size]() {
+        while (m_ofdm_to_radio_buffer->wait_for_available(frame_size)) {
+            // drain the backlog in one go
+            const size_t total_available = m_ofdm_to_radio_buffer->get_total_available();
+            auto frames = m_ofdm_to_radio_buffer->peek(total_available - (total_available % frame_size));
+            run_basic_radio(frames);
+            m_ofdm_to_radio_buffer->consume(frames.size());
         }
     });
     // setup audio
     m_audio_pipeline = std::make_shared<AudioPipeline>();
+    m_audio_transfer_buffer.resize(AUDIO_TRANSFER_BLOCK_SIZE);
+    m_audio_overflow_policy = Audio_Overflow_Policy::DROP_OLDEST;
     // setup radio
+    m_tuned_frequency = 0.0;
+    m_basic_radio_frequency = 0.0;
     reset_radio();
+    // setup telemetry
+    m_telemetry->add_gauge({
+        "IQ buffer (samples)", 
+        [this]() { return get_iq_buffer_available(); },
+        [this]() { return get_iq_buffer_capacity(); }
+    });
+    m_telemetry->add_gauge({
+        "Frame slots", 
+        [this]() { return get_total_frames_queued(); },
+        [this]() { return get_total_frame_slots(); }
+    });
 }
 
 Radio_Block::~Radio_Block() {
-    m_is_radio_thread_running = false;
+    // NOTE: The sink calls back into us to transfer audio so it has to stop first
+    m_audio_pipeline->set_sink(nullptr);
+    m_iq_buffer->close();
+    m_thread_ofdm->join();
     m_ofdm_to_radio_buffer->close();
     m_thread_radio->join();
 }
 
+std::shared_ptr<OFDM_Demod> Radio_Block::create_ofdm_demodulator(size_t total_threads) {
+    auto ofdm_prs_ref = std::vector<std::complex<float>>(m_ofdm_params.nb_fft);
+    get_DAB_PRS_reference(TRANSMISSION_MODE, ofdm_prs_ref);
+    auto ofdm_mapper_ref = std::vector<int>(m_ofdm_params.nb_data_carriers);
+    get_DAB_mapper_ref(ofdm_mapper_ref, m_ofdm_params.nb_fft);
+    auto demod = std::make_shared<OFDM_Demod>(m_ofdm_params, ofdm_prs_ref, ofdm_mapper_ref, int(total_threads));
+    auto* demod_ptr = demod.get();
+    demod->On_OFDM_Frame().Attach([this, demod_ptr](tcb::span<const viterbi_bit_t> buf) {
+        // NOTE: The whole frame has been demodulated so every symbol is available here
+        m_constellation_accumulator->push_frame(demod_ptr->GetFrameDataVec());
+        m_carrier_analyser->push_frame(demod_ptr->GetFrameDataVec(), demod_ptr->GetImpulseResponse());
+        if (m_is_lossless && !m_ofdm_to_radio_buffer->wait_for_free(buf.size())) return;
+        // NOTE: Drop the entire frame if there are no free slots so the radio never sees a partial frame
+        if (m_ofdm_to_radio_buffer->get_total_free() < buf.size()) {
+            m_total_frames_dropped++;
+            return;
+        }
+        m_ofdm_to_radio_buffer->write(buf);
+    });
+    return demod;
+}
+
+void Radio_Block::run_basic_radio(tcb::span<const viterbi_bit_t> frames) {
+    auto radio = get_basic_radio();
+    if (radio == nullptr) return;
+    const size_t frame_size = size_t(m_dab_params.nb_frame_bits);
+    auto& stage = m_telemetry->get_stage(Pipeline_Telemetry::Stage::RADIO_DECODE);
+    for (size_t offset = 0; offset < frames.size(); offset += frame_size) {
+        auto timer = Scoped_Stage_Timer(&stage);
+        const auto start = std::chrono::high_resolution_clock::now();
+        radio->Process(frames.subspan(offset, frame_size));
+        const float frame_time_ms = get_elapsed_ms(start);
+        m_thread_pool_controller->update_dab(frame_time_ms, get_total_frames_queued(), m_dab_total_threads);
+        schedule_decoding(*radio, frame_time_ms);
+    }
+    publish_radio_snapshot(radio);
+}
+
+void Radio_Block::schedule_decoding(BasicRadio& radio, float frame_time_ms) {
+    // NOTE: Subchannel sizes come from the last snapshot so the database isn't copied again
+    auto snapshot = get_radio_snapshot();
+    if ((snapshot == nullptr) || (snapshot->database == nullptr)) return;
+    auto lock = std::unique_lock(radio.GetMutex());
+    if (snapshot->radio.get() != &radio) return;
+    m_decode_scheduler_states.clear();
+    for (const auto& subchannel: snapshot->database->subchannels) {
+        auto* channel = radio.Get_Audio_Channel(subchannel.id);
+        if (channel == nullptr) continue;
+        const auto& controls = channel->GetControls();
+        Decode_Scheduler::Channel_State state;
+        state.subchannel_id = subchannel.id;
+        state.total_capacity_units = size_t(subchannel.length);
+        state.is_decode_audio = controls.GetIsDecodeAudio();
+        state.is_play_audio = controls.GetIsPlayAudio();
+        state.is_decode_data = controls.GetIsDecodeData();
+        m_decode_scheduler_states.push_back(state);
+    }
+    const auto decisions = m_decode_scheduler->update(frame_time_ms, get_total_frames_queued(), m_decode_scheduler_states);
+    for (const auto& decision: decisions) {
+        auto* channel = radio.Get_Audio_Channel(decision.subchannel_id);
+        if (channel == nullptr) continue;
+        channel->GetControls().SetIsDecodeData(decision.is_decode_data);
+    }
+}
+
+void Radio_Block::publish_radio_snapshot(std::shared_ptr<BasicRadio> radio) {
+    auto previous_snapshot = get_radio_snapshot();
+    auto lock = std::unique_lock(radio->GetMutex());
+    double frequency = 0.0;
+    // NOTE: The radio could have been replaced while we were processing the old one
+    {
+        auto lock_radio = std::scoped_lock(m_mutex_basic_radio);
+        if (radio != m_basic_radio) return;
+        frequency = m_basic_radio_frequency;
+    }
+    auto provisional = update_provisional_database(*radio, frequency);
+    auto snapshot = create_radio_snapshot(radio, previous_snapshot.get(), provisional ? provisional->database : nullptr);
+    lock.unlock();
+    std::atomic_store(&m_radio_snapshot, snapshot);
+    store_database(*snapshot, previous_snapshot.get(), frequency);
+}
+
+void Radio_Block::set_tuned_frequency(double frequency) {
+    if (std::abs(frequency - m_tuned_frequency) < TUNED_FREQUENCY_TOLERANCE_HZ) return;
+    m_tuned_frequency = frequency;
+    m_is_retune_pending = true;
+}
+
+std::shared_ptr<const Radio_Block::Provisional_Database> Radio_Block::load_provisional_database(
+    const BasicRadio* radio, double frequency, std::optional<uint32_t> ensemble_id)
+{
+    auto cache = get_database_cache();
+    if ((cache == nullptr) || (frequency <= 0.0)) return nullptr;
+    auto database = ensemble_id.has_value() ? cache->load(frequency, ensemble_id.value()) : cache->load(frequency);
+    if (database == nullptr) return nullptr;
+    auto provisional = std::make_shared<Provisional_Database>();
+    provisional->radio = radio;
+    provisional->database = database;
+    provisional->ensemble_id = uint32_t(database->ensemble.id.get_unique_identifier());
+    provisional->expiry_time = std::chrono::steady_clock::now() + PROVISIONAL_DATABASE_TIMEOUT;
+    return provisional;
+}
+
+std::shared_ptr<const Radio_Block::Provisional_Database> Radio_Block::update_provisional_database(BasicRadio& radio, double frequency) {
+    auto provisional = std::atomic_load(&m_provisional_database);
+    if ((provisional == nullptr) || (provisional->radio != &radio)) return nullptr;
+    const auto& database = radio.GetDatabase();
+    const uint32_t ensemble_id = uint32_t(database.ensemble.id.get_unique_identifier());
+    auto replacement = provisional;
+    if (is_ensemble_database_complete(database, radio.GetDatabaseStatistics())) {
+        replacement = nullptr;
+    } else if (std::chrono::steady_clock::now() >= provisional->expiry_time) {
+        replacement = nullptr;
+    } else if ((ensemble_id != 0) && (ensemble_id != provisional->ensemble_id)) {
+        // the fic says this is another ensemble which we may have also seen on this frequency
+        replacement = load_provisional_database(&radio, frequency, ensemble_id);
+    }
+    if (replacement != provisional) {
+        // NOTE: Only replace it if reset_radio() hasn't restored another one in the meantime
+        std::atomic_compare_exchange_strong(&m_provisional_database, &provisional, replacement);
+    }
+    return replacement;
+}
+
+void Radio_Block::store_database(const Radio_Snapshot& snapshot, const Radio_Snapshot* previous_snapshot, double frequency) {
+    if (snapshot.is_database_provisional) return;
+    if ((previous_snapshot != nullptr) && (previous_snapshot->database == snapshot.database)) return;
+    auto cache = get_database_cache();
+    if ((cache == nullptr) || (frequency <= 0.0)) return;
+    if (!is_ensemble_database_complete(*snapshot.database, snapshot.statistics)) return;
+    cache->store(frequency, snapshot.database);
+}
+
+void Radio_Block::process_iq(tcb::span<const std::complex<float>> block) {
+    // NOTE: A partial write would leave a discontinuity in the middle of a block
+    //       Dropping the whole block means the demodulator only sees a single gap
+    if (m_iq_buffer->get_total_free() < block.size()) {
+        m_total_iq_overruns++;
+        m_total_iq_samples_dropped += block.size();
+        return;
+    }
+    m_iq_buffer->write(block);
+}
+
+bool Radio_Block::process_iq_blocking(tcb::span<const std::complex<float>> block) {
+    const size_t max_length = m_iq_buffer->get_capacity()/2;
+    while (!block.empty()) {
+        const size_t N = std::min(block.size(), max_length);
+        if (!m_iq_buffer->wait_for_free(N)) return false;
+        m_iq_buffer->write(block.first(N));
+        block = block.subspan(N);
+    }
+    return true;
+}
+
+bool Radio_Block::process_iq_discontinuity_blocking() {
+    // NOTE: The demodulator only reads whole batches so part of a batch from before the jump can be left over
+    const size_t max_remaining = m_iq_batch_size-1;
+    if (!m_iq_buffer->wait_for_free(m_iq_buffer->get_capacity() - max_remaining)) return false;
+    reset_ofdm_demodulator();
+    return true;
+}
+
+void Radio_Block::reset_ofdm_demodulator() {
+    // NOTE: The demodulator could be in the middle of Process() so it is only reset from the ofdm thread
+    //       There is no seed since the sync state before the reset doesn't apply to what comes after it
+    auto seed = std::make_shared<Ofdm_Sync_Seed>();
+    seed->frequency = m_tuned_frequency;
+    std::atomic_store(&m_pending_sync_seed, std::shared_ptr<const Ofdm_Sync_Seed>(seed));
+}
+
+void Radio_Block::run_ofdm_demodulator(tcb::span<const std::complex<float>> block) {
+    // NOTE: Only this thread can replace the demodulator so we don't need to hold the lock
+    auto demod = get_ofdm_demodulator();
+    auto seed = std::atomic_exchange(&m_pending_sync_seed, std::shared_ptr<const Ofdm_Sync_Seed>(nullptr));
+    const bool is_retune = m_is_retune_pending.exchange(false);
+    // NOTE: The pool is only resized when the demodulator is being reset anyway so it never costs a resync
+    if ((seed != nullptr) || is_retune) demod = update_ofdm_thread_pool(demod);
+    if (seed != nullptr) seed_sync(*demod, seed->frequency, seed->state);
+    if (is_retune) apply_retune(*demod);
+    const auto start = std::chrono::high_resolution_clock::now();
+    {
+        auto timer = Scoped_Stage_Timer(&m_telemetry->get_stage(Pipeline_Telemetry::Stage::OFDM_DEMOD));
+        demod->Process(rotate_iq(block));
+    }
+    m_ofdm_elapsed_ms += get_elapsed_ms(start);
+    m_ofdm_elapsed_samples += block.size();
+    update_sync_state(*demod, block.size());
+
+    const size_t total_frame_samples = get_ofdm_frame_samples();
+    if (m_ofdm_elapsed_samples < total_frame_samples) return;
+    const float frame_time_ms = m_ofdm_elapsed_ms * float(total_frame_samples) / float(m_ofdm_elapsed_samples);
+    m_ofdm_elapsed_ms = 0.0f;
+    m_ofdm_elapsed_samples = 0;
+    m_thread_pool_controller->update_ofdm(frame_time_ms, get_total_frames_queued(), m_ofdm_total_threads);
+}
+
+size_t Radio_Block::get_ofdm_frame_samples() const {
+    return
+        size_t(m_ofdm_params.nb_null_period) +
+        size_t(m_ofdm_params.nb_symbol_period)*size_t(m_ofdm_params.nb_frame_symbols);
+}
+
+void Radio_Block::apply_retune(OFDM_Demod& demod) {
+    // NOTE: The database of the previous ensemble would otherwise be merged into the new one
+    //       This runs here instead of on the caller's thread since it reads the caches from disk
+    //       and the demodulator has to be reset anyway
+    reset_radio();
+    const double frequency = m_tuned_frequency;
+    std::optional<Ofdm_Sync_State> state;
+    auto cache = get_sync_cache();
+    if ((cache != nullptr) && (frequency > 0.0)) {
+        state = cache->load(frequency);
+    }
+    seed_sync(demod, frequency, state);
+}
+
+void Radio_Block::seed_sync(OFDM_Demod& demod, double frequency, std::optional<Ofdm_Sync_State> state) {
+    auto& sync_config = demod.GetConfig().sync;
+    // NOTE: The last seed may not have locked yet so its search range has to be restored first
+    if (m_is_sync_seeded) {
+        sync_config.max_coarse_freq_correction_norm = m_sync_saved_max_coarse_freq_correction;
+    }
+    m_sync_frequency = frequency;
+    m_sync_elapsed_samples = 0;
+    m_is_sync_acquiring = true;
+    m_is_sync_seeded = state.has_value();
+    set_iq_rotation(m_is_sync_seeded ? state->get_net_frequency_offset() : 0.0f);
+    if (m_is_sync_seeded) {
+        m_total_sync_seeds++;
+        m_sync_saved_max_coarse_freq_correction = sync_config.max_coarse_freq_correction_norm;
+        sync_config.max_coarse_freq_correction_norm = std::min(
+            SEEDED_MAX_COARSE_FREQ_CORRECTION_HZ / OFDM_SAMPLE_RATE, m_sync_saved_max_coarse_freq_correction);
+    }
+    demod.Reset();
+    m_sync_start_frames_read = demod.GetTotalFramesRead();
+}
+
+Ofdm_Sync_State Radio_Block::get_sync_state(OFDM_Demod& demod) const {
+    Ofdm_Sync_State state;
+    state.coarse_frequency_offset = m_iq_rotation_offset + demod.GetCoarseFrequencyOffset()*OFDM_SAMPLE_RATE;
+    state.fine_frequency_offset = demod.GetFineFrequencyOffset()*OFDM_SAMPLE_RATE;
+    state.signal_level = demod.GetSignalAverage();
+    return state;
+}
+
+void Radio_Block::update_sync_state(OFDM_Demod& demod, size_t total_samples) {
+    m_sync_elapsed_samples += total_samples;
+    const bool is_locked =
+        (demod.GetState() == OFDM_Demod::State::READING_SYMBOLS) &&
+        (demod.GetTotalFramesRead() != m_sync_start_frames_read);
+    const size_t frame_samples = get_ofdm_frame_samples();
+
+    if (m_is_sync_acquiring) {
+        if (is_locked) {
+            m_is_sync_acquiring = false;
+            m_last_sync_lock_ms = float(m_sync_elapsed_samples) / OFDM_SAMPLE_RATE * 1e3f;
+            m_sync_elapsed_samples = 0;
+            if (m_is_sync_seeded) {
+                m_total_sync_seed_locks++;
+                m_is_sync_seeded = false;
+                demod.GetConfig().sync.max_coarse_freq_correction_norm = m_sync_saved_max_coarse_freq_correction;
+            }
+        } else if (m_is_sync_seeded && (m_sync_elapsed_samples >= frame_samples*SYNC_SEED_TIMEOUT_FRAMES)) {
+            // NOTE: The seed was stale or from another ensemble so search the full range without it
+            //       The elapsed time is kept so the time to lock includes the failed attempt
+            m_total_sync_seed_fallbacks++;
+            m_is_sync_seeded = false;
+            demod.GetConfig().sync.max_coarse_freq_correction_norm = m_sync_saved_max_coarse_freq_correction;
+            set_iq_rotation(0.0f);
+            demod.Reset();
+            m_sync_start_frames_read = demod.GetTotalFramesRead();
+        }
+        return;
+    }
+
+    if (!is_locked) return;
+    if (m_sync_elapsed_samples < frame_samples*SYNC_STORE_PERIOD_FRAMES) return;
+    m_sync_elapsed_samples = 0;
+    auto cache = get_sync_cache();
+    if ((cache == nullptr) || (m_sync_frequency <= 0.0)) return;
+    cache->store(m_sync_frequency, get_sync_state(demod));
+}
+
+void Radio_Block::set_iq_rotation(float frequency_offset) {
+    m_iq_rotation_offset = frequency_offset;
+    m_iq_rotation = std::complex<float>(1.0f, 0.0f);
+    m_iq_rotation_step = std::polar(1.0f, -2.0f*PI*frequency_offset/OFDM_SAMPLE_RATE);
+}
+
+tcb::span<const std::complex<float>> Radio_Block::rotate_iq(tcb::span<const std::complex<float>> block) {
+    if (m_iq_rotation_offset == 0.0f) return block;
+    if (m_iq_rotation_buffer.size() < block.size()) m_iq_rotation_buffer.resize(block.size());
+    auto rotation = m_iq_rotation;
+    for (size_t i = 0; i < block.size(); i++) {
+        m_iq_rotation_buffer[i] = block[i] * rotation;
+        rotation *= m_iq_rotation_step;
+    }
+    // NOTE: Renormalise so rounding errors don't change the amplitude over time
+    m_iq_rotation = rotation / std::abs(rotation);
+    return tcb::span<const std::complex<float>>(m_iq_rotation_buffer.data(), block.size());
+}
+
+std::shared_ptr<OFDM_Demod> Radio_Block::update_ofdm_thread_pool(std::shared_ptr<OFDM_Demod> demod) {
+    const size_t total_threads = m_thread_pool_controller->get_ofdm_total_threads();
+    if (total_threads == m_ofdm_total_threads) return demod;
+    // NOTE: The demodulator cannot resize its thread pool in place so it is replaced right before it is reset
+    auto new_demod = create_ofdm_demodulator(total_threads);
+    new_demod->GetConfig() = demod->GetConfig();
+    {
+        auto lock = std::unique_lock(m_mutex_ofdm_demodulator);
+        m_ofdm_demodulator = new_demod;
+        m_ofdm_total_threads = total_threads;
+    }
+    return new_demod;
+}
+
 void Radio_Block::reset_radio() {
     auto lock_audio = std::scoped_lock(m_mutex_audio_pipeline);
+    // NOTE: The dab decoder cannot resize its thread pool in place so a new size is only applied here
+    m_dab_total_threads = m_thread_pool_controller->get_dab_total_threads();
+    auto radio = create_basic_radio(m_dab_total_threads);
+    // NOTE: Subchannel ids of another ensemble don't refer to the same channels
+    m_decode_scheduler->reset();
+    // NOTE: The cached database is shown while the fic is received again
+    const double frequency = m_tuned_frequency;
+    std::atomic_store(&m_provisional_database, load_provisional_database(radio.get(), frequency, std::nullopt));
+    {
+        auto lock_radio = std::scoped_lock(m_mutex_basic_radio);
+        m_basic_radio = radio;
+        m_basic_radio_frequency = frequency;
+    }
+    publish_radio_snapshot(radio);
+}
+
+// NOTE: Must be called while holding the audio pipeline lock
+std::shared_ptr<BasicRadio> Radio_Block::create_basic_radio(size_t total_threads) {
     auto audio_pipeline = m_audio_pipeline;
-    auto radio = std::make_shared<BasicRadio>(m_dab_params, m_dab_total_threads);
+    auto radio = std::make_shared<BasicRadio>(m_dab_params, total_threads);
     audio_pipeline->clear_sources();
+    {
+        auto lock_sources = std::unique_lock(m_mutex_audio_sources);
+        m_audio_sources.clear();
+    }
     radio->On_Audio_Channel().Attach(
-        [audio_pipeline](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
+        [this, audio_pipeline](subchannel_id_t subchannel_id, Basic_Audio_Channel& channel) {
             auto& controls = channel.GetControls();
             auto audio_source = std::make_shared<AudioPipelineSource>();
             audio_pipeline->add_source(audio_source);
+            auto source_buffer = std::make_shared<Audio_Source_Buffer>(
+                size_t(MAX_AUDIO_SAMPLE_RATE*AUDIO_SOURCE_BUFFER_SECONDS), m_audio_overflow_policy);
+            {
+                auto lock_sources = std::unique_lock(m_mutex_audio_sources);
+                m_audio_sources.push_back({ subchannel_id, source_buffer, audio_source });
+            }
             channel.OnAudioData().Attach(
-                [&controls, audio_source, audio_pipeline]
+                [this, &controls, source_buffer, subchannel_id]
                 (BasicAudioParams params, tcb::span<const uint8_t> buf) {
-                    if (!controls.GetIsPlayAudio()) return;
                     auto frame_ptr = reinterpret_cast<const Frame<int16_t>*>(buf.data());
                     const size_t total_frames = buf.size() / sizeof(Frame<int16_t>);
                     auto frame_buf = tcb::span(frame_ptr, total_frames);
-                    const bool is_blocking = audio_pipeline->get_sink() != nullptr;
-                    audio_source->write(frame_buf, float(params.frequency), is_blocking);
+                    // NOTE: Services are recorded even if they aren't being played
+                    auto recorder = std::atomic_load(&m_audio_recorder);
+                    if (recorder != nullptr) {
+                        recorder->process(subchannel_id, frame_buf, float(params.frequency));
+                    }
+                    if (!controls.GetIsPlayAudio()) return;
+                    // NOTE: Never blocks so a stalled audio device can't hold up decoding
+                    source_buffer->write(frame_buf, float(params.frequency));
+                    auto signal = std::atomic_load(&m_audio_data_signal);
+                    if (signal != nullptr) signal->notify();
                 }
             );
         }
     );
-    auto lock_radio = std::scoped_lock(m_mutex_basic_radio);
-    m_basic_radio = radio;
+    return radio;
+}
+
+
+// Moves buffered audio into the pipeline right before the sink reads from it
+class Audio_Source_Transfer_Sink: public AudioPipelineSink
+{
+private:
+    Radio_Block& m_radio_block;
+    std::unique_ptr<AudioPipelineSink> m_sink;
+public:
+    Audio_Source_Transfer_Sink(Radio_Block& radio_block, std::unique_ptr<AudioPipelineSink> sink)
+    : m_radio_block(radio_block), m_sink(std::move(sink)) {}
+    ~Audio_Source_Transfer_Sink() override {
+        // NOTE: Stop the sink's thread before the callback that refers to us is gone
+        m_sink->set_callback(nullptr);
+    }
+    void set_callback(AudioPipelineSink::Callback callback) override {
+        if (callback == nullptr) {
+            m_sink->set_callback(nullptr);
+            return;
+        }
+        m_sink->set_callback([this, callback](tcb::span<Frame<float>> buf, float sample_rate) {
+            m_radio_block.transfer_audio_sources();
+            return callback(buf, sample_rate);
+        });
+    }
+    std::string_view get_name() const override { return m_sink->get_name(); }
+};
+
+void Radio_Block::set_audio_sink(std::unique_ptr<AudioPipelineSink> sink) {
+    auto lock = std::unique_lock(m_mutex_audio_pipeline);
+    if (sink == nullptr) {
+        m_audio_pipeline->set_sink(nullptr);
+        return;
+    }
+    m_audio_pipeline->set_sink(std::make_unique<Audio_Source_Transfer_Sink>(*this, std::move(sink)));
+}
+
+void Radio_Block::transfer_audio_sources() {
+    auto lock = std::unique_lock(m_mutex_audio_sources);
+    for (auto& source: m_audio_sources) {
+        while (true) {
+            const size_t total_read = source.buffer->read(m_audio_transfer_buffer);
+            if (total_read == 0) break;
+            auto frames = tcb::span(m_audio_transfer_buffer).first(total_read);
+            source.pipeline_source->write(frames, source.buffer->get_sample_rate(), false);
+            if (total_read < m_audio_transfer_buffer.size()) break;
+        }
+    }
 }
 
+void Radio_Block::set_audio_overflow_policy(Audio_Overflow_Policy policy) {
+    m_audio_overflow_policy = policy;
+    auto lock = std::unique_lock(m_mutex_audio_sources);
+    for (auto& source: m_audio_sources) {
+        source.buffer->set_overflow_policy(policy);
+    }
+}
+
+std::vector<Audio_Source_Stats> Radio_Block::get_audio_source_stats() {
+    auto lock = std::unique_lock(m_mutex_audio_sources);
+    std::vector<Audio_Source_Stats> stats;
+    stats.reserve(m_audio_sources.size());
+    for (const auto& source: m_audio_sources) {
+        Audio_Source_Stats entry;
+        entry.subchannel_id = source.subchannel_id;
+        entry.sample_rate = source.buffer->get_sample_rate();
+        entry.total_buffered = source.buffer->get_total_available();
+        entry.capacity = source.buffer->get_capacity();
+        entry.total_frames_dropped = source.buffer->get_total_frames_dropped();
+        entry.total_overflows = source.buffer->get_total_overflows();
+        stats.push_back(entry);
+    }
+    return stats;
+}
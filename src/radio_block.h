@@ -1,37 +1,219 @@
 #pragma once
 
+#include <atomic>
+#include <complex>
 #include <mutex>
 #include <stddef.h>
 #include <memory>
+#include <optional>
+#include <vector>
 #include "ofdm/ofdm_demodulator.h"
 #include "basic_radio/basic_radio.h"
 #include "audio/audio_pipeline.h"
-#include "app_helpers/app_io_buffers.h"
+#include "utility/span.h"
+#include "./spsc_ring_buffer.h"
+#include "./audio_source_buffer.h"
+#include "./decode_scheduler.h"
 
-class Radio_Block 
+class Thread_Pool_Controller;
+class Pipeline_Telemetry;
+class Constellation_Accumulator;
+class Carrier_Analyser;
+class Event_Signal;
+struct Radio_Snapshot;
+class Audio_Recorder;
+class Ensemble_Database_Cache;
+class Ofdm_Sync_Cache;
+struct Ofdm_Sync_State;
+
+struct Audio_Source_Stats {
+    subchannel_id_t subchannel_id = 0;
+    float sample_rate = 0.0f;
+    size_t total_buffered = 0;
+    size_t capacity = 0;
+    size_t total_frames_dropped = 0;
+    size_t total_overflows = 0;
+};
+
+class Radio_Block
 {
 private:
     const OFDM_Params m_ofdm_params;
     const DAB_Parameters m_dab_params;
-    const size_t m_ofdm_total_threads;
-    const size_t m_dab_total_threads;
+    std::shared_ptr<Thread_Pool_Controller> m_thread_pool_controller;
+    std::shared_ptr<Decode_Scheduler> m_decode_scheduler;
+    // NOTE: Only used by the radio thread
+    std::vector<Decode_Scheduler::Channel_State> m_decode_scheduler_states;
+    std::shared_ptr<Pipeline_Telemetry> m_telemetry;
+    std::atomic<size_t> m_ofdm_total_threads;
+    std::atomic<size_t> m_dab_total_threads;
+    std::mutex m_mutex_ofdm_demodulator;
     std::shared_ptr<OFDM_Demod> m_ofdm_demodulator;
-    std::shared_ptr<ThreadedRingBuffer<viterbi_bit_t>> m_ofdm_to_radio_buffer;
+    size_t m_ofdm_elapsed_samples;
+    float m_ofdm_elapsed_ms;
+    // NOTE: Accessed with std::atomic_load/atomic_store since the ofdm thread stores the sync state
+    std::shared_ptr<Ofdm_Sync_Cache> m_sync_cache;
+    struct Ofdm_Sync_Seed;
+    // set by reset_ofdm_demodulator() and taken by the ofdm thread so the demodulator is only reset from there
+    std::shared_ptr<const Ofdm_Sync_Seed> m_pending_sync_seed;
+    // NOTE: Only used by the ofdm thread
+    double m_sync_frequency;
+    size_t m_sync_elapsed_samples;
+    int m_sync_start_frames_read;
+    bool m_is_sync_acquiring;
+    float m_sync_saved_max_coarse_freq_correction;
+    std::complex<float> m_iq_rotation;
+    std::complex<float> m_iq_rotation_step;
+    std::vector<std::complex<float>> m_iq_rotation_buffer;
+    // the seeded offset that is removed before the demodulator in Hz
+    std::atomic<float> m_iq_rotation_offset;
+    std::atomic<bool> m_is_sync_seeded;
+    std::atomic<size_t> m_total_sync_seeds;
+    std::atomic<size_t> m_total_sync_seed_locks;
+    std::atomic<size_t> m_total_sync_seed_fallbacks;
+    std::atomic<float> m_last_sync_lock_ms;
+    const size_t m_iq_batch_size;
+    std::unique_ptr<Spsc_Ring_Buffer<std::complex<float>>> m_iq_buffer;
+    std::atomic<size_t> m_total_iq_overruns;
+    std::atomic<size_t> m_total_iq_samples_dropped;
+    std::unique_ptr<std::thread> m_thread_ofdm;
+    // fixed size frame slots between the ofdm and radio threads
+    const size_t m_total_frame_slots;
+    std::unique_ptr<Spsc_Ring_Buffer<viterbi_bit_t>> m_ofdm_to_radio_buffer;
+    std::atomic<size_t> m_total_frames_dropped;
+    std::atomic<bool> m_is_lossless;
+    std::shared_ptr<Constellation_Accumulator> m_constellation_accumulator;
+    std::shared_ptr<Carrier_Analyser> m_carrier_analyser;
     std::unique_ptr<std::thread> m_thread_radio;
     std::mutex m_mutex_basic_radio;
-    bool m_is_radio_thread_running;
     std::shared_ptr<BasicRadio> m_basic_radio;
+    // tuned frequency when the radio was reset so its database is never stored under another frequency
+    double m_basic_radio_frequency;
+    // NOTE: Accessed with std::atomic_load/atomic_store so the gui never waits on the radio thread
+    std::shared_ptr<const Radio_Snapshot> m_radio_snapshot;
     std::mutex m_mutex_audio_pipeline;
     std::shared_ptr<AudioPipeline> m_audio_pipeline;
+    // NOTE: Accessed with std::atomic_load/atomic_store since the radio thread notifies it
+    std::shared_ptr<Event_Signal> m_audio_data_signal;
+    // decoded audio is buffered here so the radio thread never waits on the audio sink
+    struct Audio_Source {
+        subchannel_id_t subchannel_id;
+        std::shared_ptr<Audio_Source_Buffer> buffer;
+        std::shared_ptr<AudioPipelineSource> pipeline_source;
+    };
+    std::mutex m_mutex_audio_sources;
+    std::vector<Audio_Source> m_audio_sources;
+    std::vector<Frame<int16_t>> m_audio_transfer_buffer;
+    std::atomic<Audio_Overflow_Policy> m_audio_overflow_policy;
+    // NOTE: Accessed with std::atomic_load/atomic_store since the radio thread records from it
+    std::shared_ptr<Audio_Recorder> m_audio_recorder;
+    // NOTE: Accessed with std::atomic_load/atomic_store since the radio thread stores completed databases
+    std::shared_ptr<Ensemble_Database_Cache> m_database_cache;
+    // zero if the frequency isn't known such as when replaying a recording
+    std::atomic<double> m_tuned_frequency;
+    // set on retune and taken by the ofdm thread which resets the radio and loads the caches
+    std::atomic<bool> m_is_retune_pending;
+    struct Provisional_Database;
+    // NOTE: Accessed with std::atomic_load/atomic_store since it is restored by reset_radio() and dropped by the radio thread
+    std::shared_ptr<const Provisional_Database> m_provisional_database;
 public:
-    Radio_Block(size_t ofdm_total_threads, size_t dab_total_threads);
+    static constexpr size_t DEFAULT_TOTAL_FRAME_SLOTS = 4;
+    static constexpr float AUDIO_SOURCE_BUFFER_SECONDS = 1.0f;
+    explicit Radio_Block(std::shared_ptr<Thread_Pool_Controller> thread_pool_controller, size_t total_frame_slots=DEFAULT_TOTAL_FRAME_SLOTS);
     ~Radio_Block();
     void reset_radio();
-    std::shared_ptr<OFDM_Demod> get_ofdm_demodulator() { return m_ofdm_demodulator; }
-    std::shared_ptr<BasicRadio> get_basic_radio() { 
+    // called from the iq stream thread and never blocks
+    // if the demodulator is falling behind the block is dropped and counted as an overrun
+    void process_iq(tcb::span<const std::complex<float>> block);
+    // for sources that can be throttled such as file replay
+    // waits for the demodulator instead of dropping, returns false if the radio is shutting down
+    bool process_iq_blocking(tcb::span<const std::complex<float>> block);
+    // for throttled sources that jump in the stream such as a replay that seeks or loops
+    // waits for the samples before the jump to be demodulated so the reset lands on it
+    // returns false if the radio is shutting down
+    bool process_iq_discontinuity_blocking();
+    // the ofdm thread resets the demodulator before it reads the next block
+    void reset_ofdm_demodulator();
+    std::shared_ptr<OFDM_Demod> get_ofdm_demodulator() {
+        auto lock = std::unique_lock(m_mutex_ofdm_demodulator);
+        return m_ofdm_demodulator;
+    }
+    std::shared_ptr<BasicRadio> get_basic_radio() {
         auto lock = std::unique_lock(m_mutex_basic_radio);
         return m_basic_radio;
     }
     std::shared_ptr<AudioPipeline> get_audio_pipeline() { return m_audio_pipeline; }
+    // use this instead of AudioPipeline::set_sink so buffered audio is moved into the pipeline before each read
+    void set_audio_sink(std::unique_ptr<AudioPipelineSink> sink);
+    // called from the audio sink's thread
+    void transfer_audio_sources();
+    void set_audio_overflow_policy(Audio_Overflow_Policy policy);
+    Audio_Overflow_Policy get_audio_overflow_policy() const { return m_audio_overflow_policy; }
+    std::vector<Audio_Source_Stats> get_audio_source_stats();
+    void set_audio_recorder(std::shared_ptr<Audio_Recorder> recorder) { std::atomic_store(&m_audio_recorder, recorder); }
+    std::shared_ptr<Audio_Recorder> get_audio_recorder() { return std::atomic_load(&m_audio_recorder); }
+    // set this before the tuned frequency so the first reset can restore from it
+    void set_database_cache(std::shared_ptr<Ensemble_Database_Cache> cache) { std::atomic_store(&m_database_cache, cache); }
+    std::shared_ptr<Ensemble_Database_Cache> get_database_cache() { return std::atomic_load(&m_database_cache); }
+    void set_sync_cache(std::shared_ptr<Ofdm_Sync_Cache> cache) { std::atomic_store(&m_sync_cache, cache); }
+    std::shared_ptr<Ofdm_Sync_Cache> get_sync_cache() { return std::atomic_load(&m_sync_cache); }
+    // moving to another ensemble resets the radio and restores its database from the cache if there is one
+    // the demodulator is also reset and seeded with the sync state last seen on that frequency
+    // NOTE: This only records the frequency, the ofdm thread does the reset before it reads the next block
+    void set_tuned_frequency(double frequency);
+    double get_tuned_frequency() const { return m_tuned_frequency; }
+    // notified after audio is written into the pipeline so the output can sleep while there is none
+    void set_audio_data_signal(std::shared_ptr<Event_Signal> signal) { std::atomic_store(&m_audio_data_signal, signal); }
+    // latest copy of the radio's database and channel states, never blocks
+    std::shared_ptr<const Radio_Snapshot> get_radio_snapshot() const { return std::atomic_load(&m_radio_snapshot); }
+    // the demodulator waits for a free frame slot instead of dropping the frame
+    // use this when the iq source can be throttled so that every frame is decoded
+    void set_is_lossless(bool is_lossless) { m_is_lossless = is_lossless; }
+    bool get_is_lossless() const { return m_is_lossless; }
+    const OFDM_Params& get_ofdm_params() const { return m_ofdm_params; }
+    const DAB_Parameters& get_dab_params() const { return m_dab_params; }
+    std::shared_ptr<Thread_Pool_Controller> get_thread_pool_controller() { return m_thread_pool_controller; }
+    std::shared_ptr<Decode_Scheduler> get_decode_scheduler() { return m_decode_scheduler; }
+    std::shared_ptr<Pipeline_Telemetry> get_telemetry() { return m_telemetry; }
+    std::shared_ptr<Constellation_Accumulator> get_constellation_accumulator() { return m_constellation_accumulator; }
+    // per carrier mer, magnitude and channel impulse response
+    std::shared_ptr<Carrier_Analyser> get_carrier_analyser() { return m_carrier_analyser; }
+    size_t get_ofdm_total_threads() const { return m_ofdm_total_threads; }
+    size_t get_dab_total_threads() const { return m_dab_total_threads; }
+    size_t get_iq_batch_size() const { return m_iq_batch_size; }
+    size_t get_iq_buffer_capacity() const { return m_iq_buffer->get_capacity(); }
+    size_t get_iq_buffer_available() const { return m_iq_buffer->get_total_available(); }
+    size_t get_total_iq_overruns() const { return m_total_iq_overruns; }
+    size_t get_total_iq_samples_dropped() const { return m_total_iq_samples_dropped; }
+    size_t get_total_frame_slots() const { return m_total_frame_slots; }
+    size_t get_total_frames_queued() const { return m_ofdm_to_radio_buffer->get_total_available() / size_t(m_dab_params.nb_frame_bits); }
+    size_t get_total_frames_dropped() const { return m_total_frames_dropped; }
+    float get_iq_rotation_offset() const { return m_iq_rotation_offset; }
+    bool get_is_sync_seeded() const { return m_is_sync_seeded; }
+    size_t get_total_sync_seeds() const { return m_total_sync_seeds; }
+    size_t get_total_sync_seed_locks() const { return m_total_sync_seed_locks; }
+    size_t get_total_sync_seed_fallbacks() const { return m_total_sync_seed_fallbacks; }
+    // time from the last retune until the demodulator was reading frames
+    float get_last_sync_lock_ms() const { return m_last_sync_lock_ms; }
+private:
+    std::shared_ptr<OFDM_Demod> create_ofdm_demodulator(size_t total_threads);
+    void run_ofdm_demodulator(tcb::span<const std::complex<float>> block);
+    void run_basic_radio(tcb::span<const viterbi_bit_t> frames);
+    std::shared_ptr<OFDM_Demod> update_ofdm_thread_pool(std::shared_ptr<OFDM_Demod> demod);
+    std::shared_ptr<BasicRadio> create_basic_radio(size_t total_threads);
+    size_t get_ofdm_frame_samples() const;
+    void apply_retune(OFDM_Demod& demod);
+    void seed_sync(OFDM_Demod& demod, double frequency, std::optional<Ofdm_Sync_State> state);
+    Ofdm_Sync_State get_sync_state(OFDM_Demod& demod) const;
+    void update_sync_state(OFDM_Demod& demod, size_t total_samples);
+    void set_iq_rotation(float frequency_offset);
+    tcb::span<const std::complex<float>> rotate_iq(tcb::span<const std::complex<float>> block);
+    void publish_radio_snapshot(std::shared_ptr<BasicRadio> radio);
+    void schedule_decoding(BasicRadio& radio, float frame_time_ms);
+    std::shared_ptr<const Provisional_Database> load_provisional_database(
+        const BasicRadio* radio, double frequency, std::optional<uint32_t> ensemble_id);
+    // drops or replaces the provisional database once the radio's own database can take over
+    std::shared_ptr<const Provisional_Database> update_provisional_database(BasicRadio& radio, double frequency);
+    void store_database(const Radio_Snapshot& snapshot, const Radio_Snapshot* previous_snapshot, double frequency);
 };
 
@@ -0,0 +1,105 @@
+#include "./radio_snapshot.h"
+
+static bool is_statistics_changed(const Radio_Database_Statistics& a, const Radio_Database_Statistics& b) {
+    return
+        (a.nb_total != b.nb_total) ||
+        (a.nb_pending != b.nb_pending) ||
+        (a.nb_completed != b.nb_completed) ||
+        (a.nb_conflicts != b.nb_conflicts) ||
+        (a.nb_updates != b.nb_updates);
+}
+
+static bool is_channel_controls_changed(const std::vector<Radio_Channel_Snapshot>& a, const std::vector<Radio_Channel_Snapshot>& b) {
+    if (a.size() != b.size()) return true;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].subchannel_id != b[i].subchannel_id) return true;
+        if (a[i].audio_channel != b[i].audio_channel) return true;
+        if (a[i].is_decode_audio != b[i].is_decode_audio) return true;
+        if (a[i].is_play_audio != b[i].is_play_audio) return true;
+        if (a[i].is_decode_data != b[i].is_decode_data) return true;
+    }
+    return false;
+}
+
+static void copy_channel_state(BasicRadio& radio, Radio_Channel_Snapshot& snapshot) {
+    auto* audio_channel = radio.Get_Audio_Channel(snapshot.subchannel_id);
+    snapshot.audio_channel = audio_channel;
+    snapshot.data_packet_channel = radio.Get_Data_Packet_Channel(snapshot.subchannel_id);
+    if (audio_channel == nullptr) return;
+
+    const auto& controls = audio_channel->GetControls();
+    snapshot.is_decode_audio = controls.GetIsDecodeAudio();
+    snapshot.is_play_audio = controls.GetIsPlayAudio();
+    snapshot.is_decode_data = controls.GetIsDecodeData();
+    snapshot.audio_type = audio_channel->GetType();
+    if (snapshot.audio_type == AudioServiceType::DAB_PLUS) {
+        auto& channel = dynamic_cast<Basic_DAB_Plus_Channel&>(*audio_channel);
+        const auto& dynamic_label = channel.GetDynamicLabel();
+        snapshot.dynamic_label = std::string(dynamic_label.data(), dynamic_label.length());
+        snapshot.superframe_header = channel.GetSuperFrameHeader();
+        snapshot.is_firecode_error = channel.IsFirecodeError();
+        snapshot.is_rs_error = channel.IsRSError();
+        snapshot.is_au_error = channel.IsAUError();
+        snapshot.is_codec_error = channel.IsCodecError();
+    } else if (snapshot.audio_type == AudioServiceType::DAB) {
+        auto& channel = dynamic_cast<Basic_DAB_Channel&>(*audio_channel);
+        const auto& dynamic_label = channel.GetDynamicLabel();
+        snapshot.dynamic_label = std::string(dynamic_label.data(), dynamic_label.length());
+        snapshot.audio_params = channel.GetAudioParams();
+        snapshot.is_error = channel.GetIsError();
+    }
+}
+
+std::shared_ptr<const Radio_Snapshot> create_radio_snapshot(
+    std::shared_ptr<BasicRadio> radio, const Radio_Snapshot* previous_snapshot,
+    std::shared_ptr<const Radio_Database> provisional_database)
+{
+    auto snapshot = std::make_shared<Radio_Snapshot>();
+    snapshot->radio = radio;
+    snapshot->statistics = radio->GetDatabaseStatistics();
+    snapshot->misc_info = radio->GetMiscInfo();
+
+    const bool is_same_radio = (previous_snapshot != nullptr) && (previous_snapshot->radio == radio);
+    const bool is_provisional = (provisional_database != nullptr);
+    // NOTE: Changes to the radio's database don't matter while the provisional one is shown
+    const bool is_database_changed =
+        !is_same_radio ||
+        (previous_snapshot->database == nullptr) ||
+        (previous_snapshot->is_database_provisional != is_provisional) ||
+        (is_provisional && (previous_snapshot->database != provisional_database)) ||
+        (!is_provisional && is_statistics_changed(previous_snapshot->statistics, snapshot->statistics));
+    // NOTE: Counters keep increasing across radio resets so a change of radio is also a change of revision
+    if (previous_snapshot != nullptr) {
+        snapshot->version = previous_snapshot->version+1;
+        snapshot->database_revision = previous_snapshot->database_revision;
+        snapshot->channel_controls_revision = previous_snapshot->channel_controls_revision;
+    }
+    if (is_same_radio) {
+        snapshot->database = previous_snapshot->database;
+    }
+    snapshot->is_database_provisional = is_provisional;
+    if (is_database_changed) {
+        snapshot->database = is_provisional ?
+            provisional_database : std::make_shared<const Radio_Database>(radio->GetDatabase());
+        snapshot->database_revision++;
+    }
+
+    const auto& subchannels = snapshot->database->subchannels;
+    snapshot->channels.resize(subchannels.size());
+    for (size_t i = 0; i < subchannels.size(); i++) {
+        auto& channel = snapshot->channels[i];
+        channel.subchannel_id = subchannels[i].id;
+        copy_channel_state(*radio, channel);
+    }
+    const bool is_controls_changed = 
+        (previous_snapshot == nullptr) || is_channel_controls_changed(previous_snapshot->channels, snapshot->channels);
+    if (is_controls_changed) {
+        snapshot->channel_controls_revision++;
+    }
+    if (is_controls_changed || is_database_changed || (previous_snapshot->cif_usage == nullptr)) {
+        snapshot->cif_usage = std::make_shared<const Cif_Usage>(create_cif_usage(*snapshot));
+    } else {
+        snapshot->cif_usage = previous_snapshot->cif_usage;
+    }
+    return snapshot;
+}
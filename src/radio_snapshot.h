@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "basic_radio/basic_radio.h"
+#include "basic_radio/basic_audio_channel.h"
+#include "basic_radio/basic_dab_plus_channel.h"
+#include "basic_radio/basic_dab_channel.h"
+#include "basic_radio/basic_data_packet_channel.h"
+#include "./cif_usage.h"
+
+using Radio_Database = std::decay_t<decltype(std::declval<BasicRadio&>().GetDatabase())>;
+using Radio_Database_Statistics = std::decay_t<decltype(std::declval<BasicRadio&>().GetDatabaseStatistics())>;
+using Radio_Misc_Info = std::decay_t<decltype(std::declval<BasicRadio&>().GetMiscInfo())>;
+using DAB_Plus_Superframe_Header = std::decay_t<decltype(std::declval<Basic_DAB_Plus_Channel&>().GetSuperFrameHeader())>;
+using DAB_Audio_Params = std::decay_t<decltype(std::declval<Basic_DAB_Channel&>().GetAudioParams())>;
+
+// State of a decoded subchannel copied while the radio was locked
+struct Radio_Channel_Snapshot {
+    subchannel_id_t subchannel_id = 0;
+    // NOTE: Channels live as long as the radio so these can be used to reach the slideshow manager
+    //       and controls. Changing controls still needs the radio lock.
+    Basic_Audio_Channel* audio_channel = nullptr;
+    Basic_Data_Packet_Channel* data_packet_channel = nullptr;
+    AudioServiceType audio_type = AudioServiceType::DAB;
+    bool is_decode_audio = false;
+    bool is_play_audio = false;
+    bool is_decode_data = false;
+    std::string dynamic_label;
+    // dab+
+    DAB_Plus_Superframe_Header superframe_header;
+    bool is_firecode_error = false;
+    bool is_rs_error = false;
+    bool is_au_error = false;
+    bool is_codec_error = false;
+    // dab
+    DAB_Audio_Params audio_params;
+    bool is_error = false;
+};
+
+// Immutable copy of the radio that the gui can read without holding the radio lock
+// - A new snapshot is published after every frame with a higher version
+// - The database is shared between snapshots and only copied when the database updater reports a change
+// - A provisional database restored from the cache is shown until the radio's own database is complete
+// - Revisions let views cache work derived from the snapshot until something they depend on changes
+struct Radio_Snapshot {
+    std::shared_ptr<BasicRadio> radio;
+    uint64_t version = 0;
+    uint64_t database_revision = 0;
+    // advances when any channel's decode audio, play audio or decode data flags change
+    uint64_t channel_controls_revision = 0;
+    std::shared_ptr<const Radio_Database> database;
+    // a cached copy of the ensemble is shown until the live database is complete
+    bool is_database_provisional = false;
+    Radio_Database_Statistics statistics;
+    Radio_Misc_Info misc_info;
+    std::vector<Radio_Channel_Snapshot> channels;
+    // only rebuilt when the database or channel controls change
+    std::shared_ptr<const Cif_Usage> cif_usage;
+
+    const Radio_Channel_Snapshot* find_channel(subchannel_id_t subchannel_id) const {
+        for (const auto& channel: channels) {
+            if (channel.subchannel_id == subchannel_id) return &channel;
+        }
+        return nullptr;
+    }
+};
+
+// NOTE: Must be called while holding the radio lock
+//       The provisional database is used in place of the radio's database if it isn't nullptr
+std::shared_ptr<const Radio_Snapshot> create_radio_snapshot(
+    std::shared_ptr<BasicRadio> radio, const Radio_Snapshot* previous_snapshot,
+    std::shared_ptr<const Radio_Database> provisional_database=nullptr);
@@ -1,12 +1,17 @@
 #include "./render_radio_block.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
 #include <string_view>
 #include <fmt/core.h>
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
-#include <gui/widgets/constellation_diagram.h>
 #include <gui/tuner.h>
+#include <core.h>
 
 // NOTE: gui/gui.h for some reason has defines for min/max
 #include <gui/gui.h>
@@ -16,6 +21,16 @@
 #include "./radio_block.h"
 #include "./render_formatters.h"
 #include "./texture.h"
+#include "./image_decode_pool.h"
+#include "./slideshow_disk_cache.h"
+#include "./carrier_analyser.h"
+#include "./thread_pool_controller.h"
+#include "./pipeline_telemetry.h"
+#include "./radio_snapshot.h"
+#include "./audio_player.h"
+#include "./audio_jitter_buffer.h"
+#include "./audio_recorder.h"
+#include "./decode_scheduler.h"
 #include "ofdm/ofdm_demodulator.h"
 #include "basic_radio/basic_radio.h"
 #include "basic_radio/basic_audio_channel.h"
@@ -36,6 +51,14 @@ static T* find_by_callback(std::vector<T>& vec, F&& func) {
     return nullptr;
 }
 
+template <typename T, typename F>
+static const T* find_by_callback(const std::vector<T>& vec, F&& func) {
+    for (const auto& e: vec) {
+        if (func(e)) return &e;
+    }
+    return nullptr;
+}
+
 // We need to manually clamp values since ImGui_AlwaysClamp doesn't work
 static void ClampValue(int& value, int min, int max) {
     if (value < min) {
@@ -62,43 +85,147 @@ static std::string convert_frequency_to_string(freq_t freq) {
 constexpr float OFDM_DEMOD_SAMPLING_RATE = 2.048e6;
 static void RenderOFDMState(OFDM_Demod& demod);
 static void RenderOFDMControls(OFDM_Demod& demod);
-static void RenderOFDMConstellation(Radio_View_Controller& ctx, tcb::span<const std::complex<float>> data);
+static void RenderOFDMConstellation(Radio_View_Controller& ctx, Constellation_Accumulator& accumulator);
+static void RenderOFDMCarriers(Carrier_Analyser& analyser);
+static void RenderThreadPoolController(Radio_Block& block);
+static void RenderIQBufferState(Radio_Block& block);
+static void RenderOFDMSyncSeed(Radio_Block& block);
 // basic radio
-static void RenderRadioServices(BasicRadio& radio, Radio_View_Controller& ctx);
-static void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx);
-static void RenderRadioStatistics(BasicRadio& radio);
-static void RenderRadioEnsemble(BasicRadio& radio);
-static void RenderRadioDateTime(BasicRadio& radio);
+static void RenderRadioServices(const Radio_Snapshot& snapshot, Radio_View_Controller& ctx);
+static void RenderRadioService(const Radio_Snapshot& snapshot, Radio_View_Controller& ctx, Pipeline_Telemetry& telemetry, Audio_Recorder* recorder, Decode_Scheduler& scheduler);
+static void RenderDecodeScheduler(const Radio_Snapshot& snapshot, Decode_Scheduler& scheduler);
+static void RenderRadioStatistics(const Radio_Database_Statistics& stats);
+static void RenderRadioEnsemble(const Radio_Database& db);
+static void RenderRadioDateTime(const Radio_Misc_Info& info);
 // audio mixer
 static void RenderAudioControls(AudioPipeline& audio);
+static void RenderAudioOutputControls(Audio_Player_Stream& player);
+static void RenderAudioSources(Radio_Block& block);
+static void RenderAudioRecordings(Audio_Recorder& recorder);
+// telemetry
+static void RenderPipelineTelemetry(Pipeline_Telemetry& telemetry);
+static void RenderCifUsage(const Cif_Usage& usage);
+
+static bool IsDecodeScheduled(Decode_Scheduler& scheduler) {
+    auto lock = std::scoped_lock(scheduler.get_mutex());
+    return scheduler.get_settings().is_enabled;
+}
+
+// Changing channel controls races with the radio thread so it is done under the radio lock
+static auto LockRadio(BasicRadio& radio, Pipeline_Telemetry& telemetry) {
+    auto lock = std::unique_lock(radio.GetMutex(), std::defer_lock);
+    auto timer = Scoped_Stage_Timer(&telemetry.get_stage(Pipeline_Telemetry::Stage::GUI_LOCK_WAIT));
+    lock.lock();
+    return lock;
+}
+
+constexpr size_t TOTAL_SLIDESHOW_DECODE_THREADS = 2;
+// NOTE: Upload at least one image per frame and stop once this much time is spent
+constexpr auto SLIDESHOW_UPLOAD_BUDGET = std::chrono::milliseconds(2);
+// NOTE: Thumbnail widths are rounded up so resizing the window doesn't decode the image again for every pixel
+constexpr int SLIDESHOW_THUMBNAIL_WIDTH_STEP = 64;
+
+static uint64_t GetSlideshowTextureKey(subchannel_id_t subchannel_id, mot_transport_id_t transport_id, int width) {
+    const uint32_t slideshow_key = (uint32_t(subchannel_id) << 16) | uint32_t(transport_id);
+    return (uint64_t(width) << 32) | uint64_t(slideshow_key);
+}
 
-Texture* Radio_View_Controller::TryGetSlideshowTexture(
-    subchannel_id_t subchannel_id, mot_transport_id_t transport_id, 
-    tcb::span<const uint8_t> data)
+Radio_View_Controller::Radio_View_Controller()
+: slideshow_textures_cache(DEFAULT_SLIDESHOW_TEXTURE_BUDGET)
+{}
+
+Radio_View_Controller::~Radio_View_Controller() = default;
+
+Slideshow_Texture Radio_View_Controller::TryGetSlideshowTexture(
+    uint32_t service_id, subchannel_id_t subchannel_id, mot_transport_id_t transport_id, 
+    tcb::span<const uint8_t> data, int display_width)
 {
-    const uint32_t key = (subchannel_id << 16) | transport_id;
-    auto* res = slideshow_textures_cache.find(key);
-    if (res == nullptr) {
-        auto& v = slideshow_textures_cache.emplace(key, Texture::LoadFromMemory(data.data(), data.size()));
-        return v.get();
+    int thumbnail_width = 0;
+    if (display_width > 0) {
+        thumbnail_width = ((display_width + SLIDESHOW_THUMBNAIL_WIDTH_STEP-1) / SLIDESHOW_THUMBNAIL_WIDTH_STEP) * SLIDESHOW_THUMBNAIL_WIDTH_STEP;
+    }
+    const uint64_t key = GetSlideshowTextureKey(subchannel_id, transport_id, thumbnail_width);
+    const uint64_t full_key = GetSlideshowTextureKey(subchannel_id, transport_id, 0);
+
+    // NOTE: Images that are narrower than the thumbnail and images that failed to load are only stored at full resolution
+    Slideshow_Texture res;
+    for (const uint64_t cache_key: { key, full_key }) {
+        if (!slideshow_textures_cache.contains(cache_key)) continue;
+        res.texture = slideshow_textures_cache.find(cache_key);
+        res.status = (res.texture != nullptr) ? Slideshow_Texture_Status::READY : Slideshow_Texture_Status::FAILED;
+        return res;
+    }
+
+    auto it = pending_slideshow_textures.find(key);
+    if (it != pending_slideshow_textures.end()) {
+        it->second = frame_index;
+        return res;
+    }
+    // NOTE: Threads are only started once a slideshow is shown since there is a controller per ensemble
+    if (slideshow_decode_pool == nullptr) {
+        slideshow_decode_pool = std::make_unique<Image_Decode_Pool>(TOTAL_SLIDESHOW_DECODE_THREADS, slideshow_disk_cache);
+    }
+    Image_Decode_Pool::Disk_Cache_Id disk_cache_id;
+    disk_cache_id.service_id = service_id;
+    disk_cache_id.transport_id = uint16_t(transport_id);
+    slideshow_decode_pool->submit(key, data, thumbnail_width, disk_cache_id);
+    pending_slideshow_textures.insert({ key, frame_index });
+    return res;
+}
+
+void Radio_View_Controller::UpdateSlideshowTextures() {
+    frame_index++;
+    if (slideshow_decode_pool == nullptr) return;
+
+    // cancel images that weren't requested last frame since they have been scrolled away from
+    for (auto it = pending_slideshow_textures.begin(); it != pending_slideshow_textures.end();) {
+        if (it->second+1 < frame_index) {
+            slideshow_decode_pool->cancel(it->first);
+            it = pending_slideshow_textures.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    while (true) {
+        auto result = slideshow_decode_pool->pop_result();
+        if (!result.has_value()) break;
+        // NOTE: Cancelled images that were already being decoded are thrown away
+        auto it = pending_slideshow_textures.find(result->key);
+        if (it == pending_slideshow_textures.end()) continue;
+        pending_slideshow_textures.erase(it);
+        std::unique_ptr<Texture> texture = nullptr;
+        if (result->image != nullptr) {
+            texture = Texture::LoadFromImage(*result->image);
+        }
+        const uint64_t full_key = result->key & 0xFFFFFFFF;
+        slideshow_textures_cache.insert(result->is_downscaled ? result->key : full_key, std::move(texture));
+        if ((std::chrono::steady_clock::now() - start) >= SLIDESHOW_UPLOAD_BUDGET) break;
     }
-    return res->get();
 }
 
 void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx) {
+    auto telemetry = block.get_telemetry();
+    auto render_timer = Scoped_Stage_Timer(&telemetry->get_stage(Pipeline_Telemetry::Stage::GUI_RENDER));
+    ctx.UpdateSlideshowTextures();
     auto demod = block.get_ofdm_demodulator();
-    auto radio = block.get_basic_radio();
+    auto snapshot = block.get_radio_snapshot();
     auto audio_pipeline = block.get_audio_pipeline();
+    auto audio_recorder = block.get_audio_recorder();
+    auto decode_scheduler = block.get_decode_scheduler();
 
     if (ImGui::BeginTabBar("Tab bar")) {
         if (demod && ImGui::BeginTabItem("OFDM")) {
             if (ImGui::Button("Reset")) {
-                demod->Reset();
+                block.reset_ofdm_demodulator();
             }
 
             if (ImGui::BeginTabBar("OFDM tab bar")) {
                 if (ImGui::BeginTabItem("State")) {
                     RenderOFDMState(*demod);
+                    RenderIQBufferState(block);
+                    RenderOFDMSyncSeed(block);
                     ImGui::EndTabItem();
                 }
                 if (ImGui::BeginTabItem("Controls")) {
@@ -106,8 +233,15 @@ void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx) {
                     ImGui::EndTabItem();
                 }
                 if (ImGui::BeginTabItem("Constellation")) {
-                    const auto& constellation = demod->GetFrameDataVec();
-                    RenderOFDMConstellation(ctx, constellation);
+                    RenderOFDMConstellation(ctx, *block.get_constellation_accumulator());
+                    ImGui::EndTabItem();
+                }
+                if (ImGui::BeginTabItem("Carriers")) {
+                    RenderOFDMCarriers(*block.get_carrier_analyser());
+                    ImGui::EndTabItem();
+                }
+                if (ImGui::BeginTabItem("Threads")) {
+                    RenderThreadPoolController(block);
                     ImGui::EndTabItem();
                 }
                 ImGui::EndTabBar();
@@ -115,30 +249,37 @@ void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx) {
             ImGui::EndTabItem();
         }
 
-        if (radio && ImGui::BeginTabItem("DAB")) {
+        // NOTE: The dab tab is drawn from a snapshot so the radio lock is only taken when controls are changed
+        if (snapshot && snapshot->database && ImGui::BeginTabItem("DAB")) {
             if (ImGui::Button("Reset")) {
                 block.reset_radio();
                 ctx.focused_service_id = std::nullopt;
             }
 
-            auto lock = std::scoped_lock(radio->GetMutex());
             if (ImGui::BeginTabBar("DAB tab bar")) {
                 if (ImGui::BeginTabItem("Channels")) {
-                    RenderRadioServices(*radio, ctx);
+                    if (snapshot->is_database_provisional) {
+                        ImGui::TextDisabled("Showing cached services until the ensemble is received");
+                    }
+                    RenderRadioServices(*snapshot, ctx);
                     ImGui::Separator();
-                    RenderRadioService(*radio, ctx);
+                    RenderRadioService(*snapshot, ctx, *telemetry, audio_recorder.get(), *decode_scheduler);
                     ImGui::EndTabItem();
                 }
                 if (ImGui::BeginTabItem("Ensemble")) {
-                    RenderRadioEnsemble(*radio);
+                    RenderRadioEnsemble(*snapshot->database);
                     ImGui::EndTabItem();
                 }
                 if (ImGui::BeginTabItem("Date&Time")) {
-                    RenderRadioDateTime(*radio);
+                    RenderRadioDateTime(snapshot->misc_info);
                     ImGui::EndTabItem();
                 }
                 if (ImGui::BeginTabItem("Statistics")) {
-                    RenderRadioStatistics(*radio);
+                    RenderRadioStatistics(snapshot->statistics);
+                    ImGui::EndTabItem();
+                }
+                if (ImGui::BeginTabItem("Scheduler")) {
+                    RenderDecodeScheduler(*snapshot, *decode_scheduler);
                     ImGui::EndTabItem();
                 }
 
@@ -155,9 +296,11 @@ void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx) {
                     }
                     ImGui::SameLine();
                     if (ImGui::Button("Apply Settings")) {
-                        auto& db = radio->GetDatabase();
-                        for (auto& subchannel: db.subchannels) {
-                            auto* channel = radio->Get_Audio_Channel(subchannel.id);
+                        // NOTE: The scheduler decides which of these actually get decoded
+                        const bool is_scheduled = IsDecodeScheduled(*decode_scheduler);
+                        auto lock = LockRadio(*snapshot->radio, *telemetry);
+                        for (const auto& channel_snapshot: snapshot->channels) {
+                            auto* channel = channel_snapshot.audio_channel;
                             if (channel != nullptr) {
                                 auto& controls = channel->GetControls();
                                 if (is_play_audio) {
@@ -165,7 +308,11 @@ void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx) {
                                 } else {
                                     controls.SetIsDecodeAudio(false);
                                 }
-                                controls.SetIsDecodeData(is_decode_data);
+                                if (is_scheduled) {
+                                    decode_scheduler->set_is_data_requested(channel_snapshot.subchannel_id, is_decode_data);
+                                } else {
+                                    controls.SetIsDecodeData(is_decode_data);
+                                }
                             }
                         }
                     }
@@ -178,6 +325,26 @@ void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx) {
 
         if (ImGui::BeginTabItem("Audio")) {
             RenderAudioControls(*audio_pipeline);
+            ImGui::Separator();
+            RenderAudioSources(block);
+            if (audio_recorder != nullptr) {
+                ImGui::Separator();
+                RenderAudioRecordings(*audio_recorder);
+            }
+            auto* audio_player = ctx.GetAudioPlayer();
+            if (audio_player != nullptr) {
+                ImGui::Separator();
+                RenderAudioOutputControls(*audio_player);
+            }
+            ImGui::EndTabItem();
+        }
+
+        if (ImGui::BeginTabItem("Performance")) {
+            RenderPipelineTelemetry(*telemetry);
+            if (snapshot && snapshot->cif_usage) {
+                ImGui::Separator();
+                RenderCifUsage(*snapshot->cif_usage);
+            }
             ImGui::EndTabItem();
         }
 
@@ -209,6 +376,29 @@ void RenderOFDMState(OFDM_Demod& demod) {
     #undef ENUM_TO_STRING
 }
 
+void RenderIQBufferState(Radio_Block& block) {
+    const size_t capacity = block.get_iq_buffer_capacity();
+    const size_t available = block.get_iq_buffer_available();
+    const float fill_ratio = float(available) / float(capacity);
+    ImGui::Text("IQ buffer: %.1f ms", float(available) / OFDM_DEMOD_SAMPLING_RATE * 1e3f);
+    ImGui::SameLine();
+    ImGui::ProgressBar(fill_ratio, ImVec2(-1.0f, 0.0f));
+    ImGui::Text("IQ overruns: %zu (%.2f s dropped)",
+        block.get_total_iq_overruns(), float(block.get_total_iq_samples_dropped()) / OFDM_DEMOD_SAMPLING_RATE);
+}
+
+void RenderOFDMSyncSeed(Radio_Block& block) {
+    // NOTE: The demodulator's offsets above are measured after this rotation is removed
+    ImGui::Text("IQ rotation: %.2f Hz", block.get_iq_rotation_offset());
+    if (block.get_is_sync_seeded()) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.3f, 1.0f), "(seeded, waiting for lock)");
+    }
+    ImGui::Text("Last time to lock: %.1f ms", block.get_last_sync_lock_ms());
+    ImGui::Text("Sync seeds: %zu (%zu locked, %zu fell back)",
+        block.get_total_sync_seeds(), block.get_total_sync_seed_locks(), block.get_total_sync_seed_fallbacks());
+}
+
 void RenderOFDMControls(OFDM_Demod& demod) {
     auto& cfg = demod.GetConfig();
     auto params = demod.GetOFDMParams();
@@ -235,78 +425,125 @@ void RenderOFDMControls(OFDM_Demod& demod) {
     ImGui::SliderFloat("L1 signal update beta", &cfg.signal_l1.update_beta, 0.0f, 1.0f, "%.2f");
 }
 
-void RenderRadioServices(BasicRadio& radio, Radio_View_Controller& ctx) {
-    auto& db = radio.GetDatabase(); 
-    // Render channel list selector
-    auto* focused_service = find_by_callback(db.services, [&ctx](const auto& service) {
-        const auto& id = ctx.focused_service_id;
-        if (!id.has_value()) return false;
-        return service.id.get_unique_identifier() == id.value().get_unique_identifier();
-    });
-    const char* const SERVICE_LABEL_PLACEHOLDER = "[Unknown]";
-    const char* focused_service_label = "None selected";
-    if (focused_service != nullptr) {
-        if (focused_service->label.empty()) {
-            focused_service_label = SERVICE_LABEL_PLACEHOLDER;
+void RenderThreadPoolController(Radio_Block& block) {
+    auto controller = block.get_thread_pool_controller();
+    auto lock = std::scoped_lock(controller->get_mutex());
+    auto& settings = controller->get_settings();
+    ImGui::Text("Total cores: %zu", controller->get_total_cores());
+    ImGui::Checkbox("Adaptive thread count", &settings.is_adaptive);
+
+    auto render_pool = [](const char* name, const Thread_Pool_Controller::Pool& pool, size_t total_active_threads) {
+        ImGui::PushID(name);
+        if (total_active_threads == pool.total_threads) {
+            ImGui::Text("%s threads: %zu", name, total_active_threads);
         } else {
-            focused_service_label = focused_service->label.c_str();
-        }
-    }
-    const auto total_services = db.services.size();
-
-    const auto dropdown_label = fmt::format("Services ({})###services_dropdown", total_services);
-    if (ImGui::BeginCombo(dropdown_label.c_str(), focused_service_label)) {
-        static std::vector<Service*> service_list;
-        service_list.clear();
-        for (auto& service: db.services) {
-            if (service.label.empty()) {
-                continue;
+            ImGui::Text("%s threads: %zu (pending %zu)", name, total_active_threads, pool.total_threads);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Applied on the next reset or retune");
             }
-            service_list.push_back(&service);
         }
-        std::sort(service_list.begin(), service_list.end(), [](const auto* a, const auto* b) {
-            return (a->label.compare(b->label) < 0);
-        });
+        ImGui::Text("%s load: %.1f%%", name, pool.load_average*100.0f);
+        const float width = ImGui::GetContentRegionAvail().x;
+        ImGui::PlotLines(
+            "###frame_times", pool.frame_times_ms.data(), int(pool.frame_times_ms.size()), int(pool.frame_times_index),
+            "Frame time (ms)", 0.0f, Thread_Pool_Controller::REALTIME_FRAME_PERIOD_MS, ImVec2(width, 60.0f)
+        );
+        ImGui::PopID();
+    };
+    render_pool("OFDM", controller->get_ofdm_pool(), block.get_ofdm_total_threads());
+    ImGui::Separator();
+    render_pool("DAB", controller->get_dab_pool(), block.get_dab_total_threads());
+    ImGui::Text("Frames queued: %zu/%zu", block.get_total_frames_queued(), block.get_total_frame_slots());
+    ImGui::Text("Frames dropped: %zu", block.get_total_frames_dropped());
+
+    if (ImGui::CollapsingHeader("Controller settings")) {
+        ImGui::SliderFloat("Grow load threshold", &settings.grow_load_threshold, 0.0f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Shrink load threshold", &settings.shrink_load_threshold, 0.0f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Load update beta", &settings.load_update_beta, 0.0f, 1.0f, "%.2f");
+    }
+}
 
-        for (auto* service: service_list) {
-            ImGui::PushID(service->id.get_unique_identifier());
-            bool is_play_audio = false;
-            bool is_decode_data = false;
-            for (auto& component: db.service_components) {
-                if (component.service_id.get_unique_identifier() != service->id.get_unique_identifier()) continue;
-                auto* channel = radio.Get_Audio_Channel(component.subchannel_id);
-                if (channel != nullptr) {
-                    auto& controls = channel->GetControls();
-                    is_play_audio |= controls.GetIsPlayAudio();
-                    is_decode_data |= controls.GetIsDecodeData();
-                }
-            }
+void Radio_View_Controller::UpdateServiceList(const Radio_Snapshot& snapshot) {
+    const bool is_changed =
+        (service_list_database_revision != snapshot.database_revision) ||
+        (service_list_controls_revision != snapshot.channel_controls_revision);
+    if (!is_changed) return;
+    service_list_database_revision = snapshot.database_revision;
+    service_list_controls_revision = snapshot.channel_controls_revision;
+
+    const auto& db = *snapshot.database;
+    service_list_dropdown_label = fmt::format("Services ({})###services_dropdown", db.services.size());
+    // NOTE: Flags are gathered in a single pass over the components instead of a pass per service
+    struct Service_Flags {
+        bool is_play_audio = false;
+        bool is_decode_data = false;
+    };
+    std::unordered_map<uint32_t, Service_Flags> service_flags;
+    for (const auto& component: db.service_components) {
+        const auto* channel = snapshot.find_channel(component.subchannel_id);
+        if ((channel == nullptr) || (channel->audio_channel == nullptr)) continue;
+        auto& flags = service_flags[component.service_id.get_unique_identifier()];
+        flags.is_play_audio |= channel->is_play_audio;
+        flags.is_decode_data |= channel->is_decode_data;
+    }
 
-            auto label = fmt::format("{}###{}", service->label.empty() ? SERVICE_LABEL_PLACEHOLDER : service->label, service->id.get_unique_identifier());
-            const std::string status_label = fmt::format("{}/{}",
-                is_play_audio ? "A" : "-",
-                is_decode_data ? "D" : "-"
-            );
+    service_list.clear();
+    for (const auto& service: db.services) {
+        if (service.label.empty()) continue;
+        const uint32_t service_id = service.id.get_unique_identifier();
+        Service_Flags flags;
+        auto it = service_flags.find(service_id);
+        if (it != service_flags.end()) flags = it->second;
+        Service_List_Entry entry;
+        entry.id = service.id;
+        entry.label = fmt::format("{}###{}", service.label, service_id);
+        entry.status_label = fmt::format("{}/{}", flags.is_play_audio ? "A" : "-", flags.is_decode_data ? "D" : "-");
+        service_list.push_back(std::move(entry));
+    }
+    std::sort(service_list.begin(), service_list.end(), [](const auto& a, const auto& b) {
+        return a.label < b.label;
+    });
+}
 
-            const bool is_focused =
-                ctx.focused_service_id.has_value() &&
-                service->id.get_unique_identifier() == ctx.focused_service_id.value().get_unique_identifier();
-            if (ImGui::Selectable(label.c_str(), is_focused)) {
-                ctx.focused_service_id = service->id;
-            }
- 
-            const float offset = ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(status_label.c_str()).x;
-            ImGui::SameLine(offset);
-            ImGui::Text("%.*s", int(status_label.length()), status_label.c_str());
+void RenderRadioServices(const Radio_Snapshot& snapshot, Radio_View_Controller& ctx) {
+    ctx.UpdateServiceList(snapshot);
+    const auto& focused_id = ctx.focused_service_id;
+    auto is_focused = [&focused_id](const Service_List_Entry& entry) {
+        return focused_id.has_value() && (entry.id.get_unique_identifier() == focused_id.value().get_unique_identifier());
+    };
 
-            ImGui::PopID();
+    const char* focused_service_label = "None selected";
+    if (focused_id.has_value()) {
+        const auto* focused_service = find_by_callback(snapshot.database->services, [&focused_id](const auto& service) {
+            return service.id.get_unique_identifier() == focused_id.value().get_unique_identifier();
+        });
+        if (focused_service != nullptr) {
+            focused_service_label = focused_service->label.empty() ? "[Unknown]" : focused_service->label.c_str();
         }
+    }
 
+    if (ImGui::BeginCombo(ctx.service_list_dropdown_label.c_str(), focused_service_label)) {
+        // NOTE: Only the rows that are visible are submitted
+        ImGuiListClipper clipper;
+        clipper.Begin(int(ctx.service_list.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const auto& entry = ctx.service_list[size_t(i)];
+                ImGui::PushID(int(entry.id.get_unique_identifier()));
+                if (ImGui::Selectable(entry.label.c_str(), is_focused(entry))) {
+                    ctx.focused_service_id = entry.id;
+                }
+                const float offset = ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(entry.status_label.c_str()).x;
+                ImGui::SameLine(offset);
+                ImGui::Text("%.*s", int(entry.status_label.length()), entry.status_label.c_str());
+                ImGui::PopID();
+            }
+        }
         ImGui::EndCombo();
     }
 }
 
-static void RenderSlideshowManager(Basic_Slideshow_Manager& slideshow_manager, Radio_View_Controller& ctx, subchannel_id_t subchannel_id) {
+static void RenderSlideshowManager(Basic_Slideshow_Manager& slideshow_manager, Radio_View_Controller& ctx, uint32_t service_id, subchannel_id_t subchannel_id) {
     static std::vector<std::shared_ptr<Basic_Slideshow>> slideshows;
     {
         auto lock = std::unique_lock(slideshow_manager.GetSlideshowsMutex());
@@ -325,11 +562,13 @@ static void RenderSlideshowManager(Basic_Slideshow_Manager& slideshow_manager, R
         ClampValue(slideshow_index, 0, total_slideshows-1);
 
         auto slideshow = slideshows[slideshow_index];
-        const auto* texture = ctx.TryGetSlideshowTexture(subchannel_id, slideshow->transport_id, slideshow->image_data);
+        const ImVec2 region_min = ImGui::GetWindowContentRegionMin();
+        const ImVec2 region_max = ImGui::GetWindowContentRegionMax();
+        const float region_width = float(region_max.x - region_min.x);
+        const auto slideshow_texture = ctx.TryGetSlideshowTexture(
+            service_id, subchannel_id, slideshow->transport_id, slideshow->image_data, int(std::ceil(region_width)));
+        const auto* texture = slideshow_texture.texture;
         if (texture != nullptr) {
-            const ImVec2 region_min = ImGui::GetWindowContentRegionMin();
-            const ImVec2 region_max = ImGui::GetWindowContentRegionMax();
-            const float region_width = float(region_max.x - region_min.x);
             const float scale = region_width / static_cast<float>(texture->GetWidth());
             const auto texture_size = ImVec2(
                     static_cast<float>(texture->GetWidth()) * scale, 
@@ -338,8 +577,40 @@ static void RenderSlideshowManager(Basic_Slideshow_Manager& slideshow_manager, R
             const auto texture_id = reinterpret_cast<ImTextureID>(texture->GetTextureID());
             ImGui::Image(texture_id, texture_size);
             if (ImGui::IsItemHovered()) {
-                ImGui::SetTooltip("%.*s", int(slideshow->name.length()), slideshow->name.c_str());
+                ImGui::SetTooltip("%.*s\nClick to view at full resolution", int(slideshow->name.length()), slideshow->name.c_str());
+            }
+            if (ImGui::IsItemClicked()) {
+                ImGui::OpenPopup("###slideshow_full_resolution");
             }
+            // NOTE: The full resolution image is only loaded while this is open
+            if (ImGui::BeginPopup("###slideshow_full_resolution")) {
+                const auto full_texture = ctx.TryGetSlideshowTexture(service_id, subchannel_id, slideshow->transport_id, slideshow->image_data);
+                if (full_texture.texture != nullptr) {
+                    const auto full_texture_size = ImVec2(
+                        static_cast<float>(full_texture.texture->GetWidth()),
+                        static_cast<float>(full_texture.texture->GetHeight())
+                    );
+                    ImGui::Image(reinterpret_cast<ImTextureID>(full_texture.texture->GetTextureID()), full_texture_size);
+                } else if (full_texture.status == Slideshow_Texture_Status::LOADING) {
+                    ImGui::Text("Loading full resolution image...");
+                } else {
+                    ImGui::Text("Failed to load slideshow image");
+                }
+                ImGui::EndPopup();
+            }
+        } else if (slideshow_texture.status == Slideshow_Texture_Status::LOADING) {
+            // NOTE: Slideshows are usually 320x240 so reserve that aspect ratio to avoid the layout jumping
+            const auto placeholder_size = ImVec2(region_width, region_width * 0.75f);
+            const ImVec2 pos = ImGui::GetCursorScreenPos();
+            auto* draw_list = ImGui::GetWindowDrawList();
+            draw_list->AddRectFilled(pos, ImVec2(pos.x+placeholder_size.x, pos.y+placeholder_size.y), ImGui::GetColorU32(ImGuiCol_FrameBg));
+            const char* loading_label = "Loading slideshow image...";
+            const ImVec2 text_size = ImGui::CalcTextSize(loading_label);
+            draw_list->AddText(
+                ImVec2(pos.x + (placeholder_size.x-text_size.x)*0.5f, pos.y + (placeholder_size.y-text_size.y)*0.5f),
+                ImGui::GetColorU32(ImGuiCol_TextDisabled), loading_label
+            );
+            ImGui::Dummy(placeholder_size);
         } else {
             ImGui::Text("Failed to load slideshow image");
         }
@@ -370,9 +641,11 @@ static void RenderSlideshowManager(Basic_Slideshow_Manager& slideshow_manager, R
             FIELD_MACRO("Size", "%zu Bytes", slideshow->image_data.size());
 
             if (texture != NULL) {
-                FIELD_MACRO("Resolution", "%u x %u", texture->GetWidth(), texture->GetHeight());
+                FIELD_MACRO("Texture Resolution", "%u x %u", texture->GetWidth(), texture->GetHeight());
                 FIELD_MACRO("Internal Texture ID", "%" PRIu32, texture->GetTextureID());
             }
+            FIELD_MACRO("Texture Cache", "%.1f/%.1f MB",
+                float(ctx.GetSlideshowTextureBytes())*1e-6f, float(ctx.GetSlideshowTextureBudget())*1e-6f);
             ImGui::EndTable();
         }
 
@@ -383,35 +656,82 @@ static void RenderSlideshowManager(Basic_Slideshow_Manager& slideshow_manager, R
     }
 }
 
-static void RenderAudioChannelControls(Basic_Audio_Channel& channel) {
-    auto& controls = channel.GetControls();
-    const bool is_play_audio = controls.GetIsPlayAudio();
-    const bool is_decode_data = controls.GetIsDecodeData();
+static void RenderAudioChannelControls(const Radio_Snapshot& snapshot, const Radio_Channel_Snapshot& channel, Pipeline_Telemetry& telemetry, Decode_Scheduler& scheduler) {
+    auto& controls = channel.audio_channel->GetControls();
+    const auto subchannel_id = channel.subchannel_id;
+    // NOTE: When data decoding is scheduled the buttons make requests which are granted within the cpu budget
+    const bool is_scheduled = IsDecodeScheduled(scheduler);
+    auto set_is_decode_data = [&](bool is_decode_data) {
+        if (is_scheduled) {
+            scheduler.set_is_data_requested(subchannel_id, is_decode_data);
+        } else {
+            auto lock = LockRadio(*snapshot.radio, telemetry);
+            controls.SetIsDecodeData(is_decode_data);
+        }
+    };
+    const bool is_play_audio = channel.is_play_audio;
+    const bool is_decode_data = is_scheduled ? scheduler.get_is_data_requested(subchannel_id) : channel.is_decode_data;
     const bool is_all_enabled = is_play_audio && is_decode_data;
     if (is_all_enabled) {
-        if (ImGui::Button("Stop All")) controls.StopAll();
+        if (ImGui::Button("Stop All")) {
+            { auto lock = LockRadio(*snapshot.radio, telemetry); controls.SetIsDecodeAudio(false); }
+            set_is_decode_data(false);
+        }
     } else {
-        if (ImGui::Button("Run All")) controls.RunAll();
+        if (ImGui::Button("Run All")) {
+            { auto lock = LockRadio(*snapshot.radio, telemetry); controls.SetIsPlayAudio(true); }
+            set_is_decode_data(true);
+        }
     }
     ImGui::SameLine();
     if (is_play_audio) {
-        if (ImGui::Button("Mute Audio")) controls.SetIsDecodeAudio(false);
+        if (ImGui::Button("Mute Audio")) { auto lock = LockRadio(*snapshot.radio, telemetry); controls.SetIsDecodeAudio(false); }
     } else {
-        if (ImGui::Button("Play Audio")) controls.SetIsPlayAudio(true);
+        if (ImGui::Button("Play Audio")) { auto lock = LockRadio(*snapshot.radio, telemetry); controls.SetIsPlayAudio(true); }
     }
     ImGui::SameLine();
     if (is_decode_data) {
-        if (ImGui::Button("Stop Data Decode")) controls.SetIsDecodeData(false);
+        if (ImGui::Button("Stop Data Decode")) set_is_decode_data(false);
+    } else {
+        if (ImGui::Button("Start Data Decode")) set_is_decode_data(true);
+    }
+    if (is_scheduled) {
+        ImGui::SameLine();
+        bool is_pinned = scheduler.get_is_pinned(subchannel_id);
+        if (ImGui::Checkbox("Pin", &is_pinned)) scheduler.set_is_pinned(subchannel_id, is_pinned);
+        if (is_decode_data && !channel.is_decode_data) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(waiting for cpu budget)");
+        }
+    }
+}
+
+static void RenderAudioChannelRecording(Audio_Recorder& recorder, const Service& service, subchannel_id_t subchannel_id) {
+    if (recorder.is_recording(subchannel_id)) {
+        if (ImGui::Button("Stop Recording")) recorder.stop(subchannel_id);
+        const auto stats = recorder.get_stats();
+        for (const auto& recording: stats) {
+            if (recording.subchannel_id != subchannel_id) continue;
+            const float duration = (recording.sample_rate > 0.0f) ? float(recording.total_frames)/recording.sample_rate : 0.0f;
+            ImGui::SameLine();
+            ImGui::Text("%.1fs %.1f MB%s", duration, float(recording.total_bytes_written)*1e-6f, recording.is_error ? " (write error)" : "");
+        }
     } else {
-        if (ImGui::Button("Start Data Decode")) controls.SetIsDecodeData(true);
+        if (ImGui::Button("Start Recording")) {
+            // NOTE: Unlabelled services are recorded under their id
+            const auto name = service.label.empty() ?
+                fmt::format("{:08X}", service.id.get_unique_identifier()) :
+                fmt::format("{}_{:08X}", service.label, service.id.get_unique_identifier());
+            recorder.start(subchannel_id, name);
+        }
     }
 }
 
-static void RenderDABPlusChannelStatus(Basic_DAB_Plus_Channel& channel, Subchannel& subchannel) {
+static void RenderDABPlusChannelStatus(const Radio_Channel_Snapshot& channel, Subchannel& subchannel) {
     std::string codec_description = "DAB+ (no codec info)";
     const auto prot_label = GetSubchannelProtectionLabel(subchannel);
     const uint32_t bitrate_kbps = GetSubchannelBitrate(subchannel);
-    const auto& superframe_header = channel.GetSuperFrameHeader();
+    const auto& superframe_header = channel.superframe_header;
     const bool is_codec_found = superframe_header.sampling_rate != 0;
     const bool is_stereo = superframe_header.is_stereo || superframe_header.is_parametric_stereo;
     if (is_codec_found) {
@@ -422,26 +742,26 @@ static void RenderDABPlusChannelStatus(Basic_DAB_Plus_Channel& channel, Subchann
             GetMPEGSurroundString(superframe_header.mpeg_surround)
         );
     }
-    const auto& dynamic_label = channel.GetDynamicLabel();
+    const auto& dynamic_label = channel.dynamic_label;
     ImGui::TextWrapped("%.*s", int(codec_description.length()), codec_description.c_str());
     ImGui::TextWrapped("%.*s", int(dynamic_label.length()), dynamic_label.data());
 
     ImGui::Separator();
 
-    ImGui::RadioButton("Firecode", !channel.IsFirecodeError());
+    ImGui::RadioButton("Firecode", !channel.is_firecode_error);
     ImGui::SameLine();
-    ImGui::RadioButton("Reed Solomon", !channel.IsRSError());
+    ImGui::RadioButton("Reed Solomon", !channel.is_rs_error);
     ImGui::SameLine();
-    ImGui::RadioButton("Access Unit", !channel.IsAUError());
+    ImGui::RadioButton("Access Unit", !channel.is_au_error);
     ImGui::SameLine();
-    ImGui::RadioButton("Codec", !channel.IsCodecError());
+    ImGui::RadioButton("Codec", !channel.is_codec_error);
 }
 
-static void RenderDABChannelStatus(Basic_DAB_Channel& channel, Subchannel& subchannel) {
+static void RenderDABChannelStatus(const Radio_Channel_Snapshot& channel, Subchannel& subchannel) {
     std::string codec_description = "DAB (no codec info)";
     const auto prot_label = GetSubchannelProtectionLabel(subchannel);
     const uint32_t bitrate_kbps = GetSubchannelBitrate(subchannel);
-    const auto& audio_params_opt = channel.GetAudioParams();
+    const auto& audio_params_opt = channel.audio_params;
     if (audio_params_opt.has_value()) {
         const auto& params = audio_params_opt.value();
         const char* mpeg_version = nullptr;
@@ -467,28 +787,26 @@ static void RenderDABChannelStatus(Basic_DAB_Channel& channel, Subchannel& subch
             mpeg_version, mpeg_layer
         );
     }
-    const auto& dynamic_label = channel.GetDynamicLabel();
+    const auto& dynamic_label = channel.dynamic_label;
     ImGui::TextWrapped("%.*s", int(codec_description.length()), codec_description.c_str());
     ImGui::TextWrapped("%.*s", int(dynamic_label.length()), dynamic_label.data());
 
     ImGui::Separator();
 
-    ImGui::RadioButton("MP2 Decoder", !channel.GetIsError());
+    ImGui::RadioButton("MP2 Decoder", !channel.is_error);
 }
 
-static void RenderAudioChannelStatus(Basic_Audio_Channel& channel, Subchannel& subchannel) {
-    const auto type = channel.GetType();
+static void RenderAudioChannelStatus(const Radio_Channel_Snapshot& channel, Subchannel& subchannel) {
+    const auto type = channel.audio_type;
     if (type == AudioServiceType::DAB_PLUS) {
-        auto& dab_plus_channel = dynamic_cast<Basic_DAB_Plus_Channel&>(channel);
-        RenderDABPlusChannelStatus(dab_plus_channel, subchannel);
+        RenderDABPlusChannelStatus(channel, subchannel);
     } else if (type == AudioServiceType::DAB) {
-        auto& dab_channel = dynamic_cast<Basic_DAB_Channel&>(channel);
-        RenderDABChannelStatus(dab_channel, subchannel);
+        RenderDABChannelStatus(channel, subchannel);
     }
 }
 
-void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
-    auto& db = radio.GetDatabase();
+void RenderRadioService(const Radio_Snapshot& snapshot, Radio_View_Controller& ctx, Pipeline_Telemetry& telemetry, Audio_Recorder* recorder, Decode_Scheduler& scheduler) {
+    const auto& db = *snapshot.database;
 
     auto* service = find_by_callback(db.services, [&ctx](const auto& service) {
         const auto& id = ctx.focused_service_id;
@@ -496,13 +814,14 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
         return service.id.get_unique_identifier() == id.value().get_unique_identifier();
     });
     if (service == nullptr) {
+        scheduler.set_focused_subchannel(std::nullopt);
         ImGui::Text("Please select a service");
         return;
     }
 
-    static std::vector<ServiceComponent*> service_components;
+    static std::vector<const ServiceComponent*> service_components;
     service_components.clear();
-    for (auto& service_component: db.service_components) {
+    for (const auto& service_component: db.service_components) {
         if (service_component.service_id.get_unique_identifier() != service->id.get_unique_identifier()) continue;
         service_components.push_back(&service_component);
     }
@@ -521,22 +840,32 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
     auto* service_component = service_components[selected_index];
 
     const auto subchannel_id = service_component->subchannel_id;
-    auto* subchannel = find_by_callback(db.subchannels, [subchannel_id](const auto& subchannel) {
+    scheduler.set_focused_subchannel(subchannel_id);
+    const auto* subchannel_entry = find_by_callback(db.subchannels, [subchannel_id](const auto& subchannel) {
         return subchannel.id == subchannel_id;
     });
-    if (subchannel == nullptr) {
+    const auto* channel = snapshot.find_channel(subchannel_id);
+    if ((subchannel_entry == nullptr) || (channel == nullptr)) {
         ImGui::Text("Subchannel is not available yet");
         return;
     }
+    // NOTE: The formatters take a mutable subchannel
+    auto subchannel_copy = *subchannel_entry;
+    auto* subchannel = &subchannel_copy;
 
-    auto* audio_channel = radio.Get_Audio_Channel(subchannel->id);
-    auto* data_packet_channel = radio.Get_Data_Packet_Channel(subchannel->id);
+    auto* audio_channel = channel->audio_channel;
+    auto* data_packet_channel = channel->data_packet_channel;
     if (audio_channel != nullptr) {
-        RenderAudioChannelControls(*audio_channel);
+        RenderAudioChannelControls(snapshot, *channel, telemetry, scheduler);
+        if (recorder != nullptr) {
+            RenderAudioChannelRecording(*recorder, *service, subchannel_id);
+        }
         ImGui::Separator();
-        RenderAudioChannelStatus(*audio_channel, *subchannel);
+        RenderAudioChannelStatus(*channel, *subchannel);
     } else if (data_packet_channel != nullptr) {
         ImGui::Text("Data Packet Channel");
+    } else if (snapshot.is_database_provisional) {
+        ImGui::Text("Waiting for the ensemble to confirm this cached service");
     }
     ImGui::Separator();
 
@@ -588,9 +917,9 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
     if (ImGui::BeginTabBar("channel_tabs")) {
         if (ImGui::BeginTabItem("Slideshow")) {
             if (audio_channel != nullptr) {
-                RenderSlideshowManager(audio_channel->GetSlideshowManager(), ctx, subchannel->id);
+                RenderSlideshowManager(audio_channel->GetSlideshowManager(), ctx, service->id.get_unique_identifier(), subchannel->id);
             } else if (data_packet_channel != nullptr) {
-                RenderSlideshowManager(data_packet_channel->GetSlideshowManager(), ctx, subchannel->id);
+                RenderSlideshowManager(data_packet_channel->GetSlideshowManager(), ctx, service->id.get_unique_identifier(), subchannel->id);
             }
             ImGui::EndTabItem();
         }
@@ -623,9 +952,9 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
                         ImGui::EndTable();
                     }
 
-                    static std::vector<FM_Service*> fm_services;
+                    static std::vector<const FM_Service*> fm_services;
                     fm_services.clear();
-                    for (auto& fm_service: db.fm_services) {
+                    for (const auto& fm_service: db.fm_services) {
                         if (fm_service.linkage_set_number != link_service->id) continue;
                         fm_services.push_back(&fm_service);
                     }
@@ -647,7 +976,7 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
                                 ImGui::TableSetColumnIndex(1);
                                 ImGui::TextWrapped("%s", fm_service->is_time_compensated ? "Yes" : "No");
                                 ImGui::TableSetColumnIndex(2);
-                                auto& frequencies = fm_service->frequencies;
+                                const auto& frequencies = fm_service->frequencies;
                                 for (auto& freq: frequencies) {
                                     std::string label = convert_frequency_to_string(freq);
                                     if (ImGui::Selectable(label.c_str(), false)) {
@@ -662,9 +991,9 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
                         ImGui::Text("No linked FM services");
                     }
 
-                    static std::vector<DRM_Service*> drm_services;
+                    static std::vector<const DRM_Service*> drm_services;
                     drm_services.clear();
-                    for (auto& drm_service: db.drm_services) {
+                    for (const auto& drm_service: db.drm_services) {
                         if (drm_service.linkage_set_number != link_service->id) continue;
                         drm_services.push_back(&drm_service);
                     }
@@ -686,7 +1015,7 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
                                 ImGui::TableSetColumnIndex(1);
                                 ImGui::TextWrapped("%s", drm_service->is_time_compensated ? "Yes" : "No");
                                 ImGui::TableSetColumnIndex(2);
-                                auto& frequencies = drm_service->frequencies;
+                                const auto& frequencies = drm_service->frequencies;
                                 for (auto& freq: frequencies) {
                                     std::string label = convert_frequency_to_string(freq);
                                     if (ImGui::Selectable(label.c_str(), false)) {
@@ -751,8 +1080,7 @@ void RenderRadioService(BasicRadio& radio, Radio_View_Controller& ctx) {
     #undef FIELD_MACRO
 }
 
-void RenderRadioStatistics(BasicRadio& radio) {
-    const auto& stats = radio.GetDatabaseStatistics();
+void RenderRadioStatistics(const Radio_Database_Statistics& stats) {
     ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
     if (ImGui::BeginTable("Date & Time", 2, flags)) {
         #define FIELD_MACRO(name, fmt, ...) {\
@@ -777,9 +1105,8 @@ void RenderRadioStatistics(BasicRadio& radio) {
     }
 }
 
-void RenderRadioEnsemble(BasicRadio& radio) {
-    auto& db = radio.GetDatabase();
-    auto& ensemble = db.ensemble;
+void RenderRadioEnsemble(const Radio_Database& db) {
+    const auto& ensemble = db.ensemble;
 
     ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
     if (ImGui::BeginTable("Ensemble description", 2, flags)) {
@@ -810,8 +1137,7 @@ void RenderRadioEnsemble(BasicRadio& radio) {
     }
 }
 
-void RenderRadioDateTime(BasicRadio& radio) {
-    const auto& info = radio.GetMiscInfo();
+void RenderRadioDateTime(const Radio_Misc_Info& info) {
     ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
     if (ImGui::BeginTable("Date & Time", 2, flags)) {
         #define FIELD_MACRO(name, fmt, ...) {\
@@ -884,35 +1210,388 @@ void RenderAudioControls(AudioPipeline& audio) {
     }
 }
 
-void RenderOFDMConstellation(Radio_View_Controller& ctx, tcb::span<const std::complex<float>> data) {
-    const float menuWidth = ImGui::GetContentRegionAvail().x;
-    ImGui::SetNextItemWidth(menuWidth);
+void RenderAudioOutputControls(Audio_Player_Stream& player) {
+    const float block_size_seconds = player.get_block_size_seconds();
+    const float target_latency_seconds = player.get_target_latency_seconds();
+    // NOTE: Values from the sliders are rounded to the nearest millisecond
+    auto is_profile_selected = [block_size_seconds, target_latency_seconds](const Audio_Player_Profile& profile) {
+        return (std::abs(profile.block_size_seconds - block_size_seconds) < 0.5e-3f) && 
+               (std::abs(profile.target_latency_seconds - target_latency_seconds) < 0.5e-3f);
+    };
+    const char* profile_label = "Custom";
+    for (const auto& profile: Audio_Player_Stream::PROFILES) {
+        if (is_profile_selected(profile)) profile_label = profile.label;
+    }
+
+    ImGui::Text("Output");
+    if (ImGui::BeginCombo("Profile", profile_label)) {
+        for (const auto& profile: Audio_Player_Stream::PROFILES) {
+            const auto label = fmt::format("{} ({:.0f} ms)", profile.label, profile.target_latency_seconds*1e3f);
+            if (ImGui::Selectable(label.c_str(), is_profile_selected(profile))) {
+                player.set_block_size_seconds(profile.block_size_seconds);
+                player.set_target_latency_seconds(profile.target_latency_seconds);
+            }
+        }
+        ImGui::EndCombo();
+    }
+    float block_size_ms = block_size_seconds*1e3f;
+    if (ImGui::SliderFloat(
+        "Block size", &block_size_ms, 
+        Audio_Player_Stream::MIN_BLOCK_SIZE_SECONDS*1e3f, Audio_Player_Stream::MAX_BLOCK_SIZE_SECONDS*1e3f, 
+        "%.0f ms", ImGuiSliderFlags_AlwaysClamp)) 
+    {
+        player.set_block_size_seconds(std::round(block_size_ms)*1e-3f);
+    }
+    float target_latency_ms = target_latency_seconds*1e3f;
+    if (ImGui::SliderFloat(
+        "Target latency", &target_latency_ms, 
+        Audio_Player_Stream::MIN_TARGET_LATENCY_SECONDS*1e3f, Audio_Player_Stream::MAX_TARGET_LATENCY_SECONDS*1e3f, 
+        "%.0f ms", ImGuiSliderFlags_AlwaysClamp)) 
+    {
+        player.set_target_latency_seconds(std::round(target_latency_ms)*1e-3f);
+    }
+    const float sample_rate = player.get_sample_rate();
+    if (sample_rate == Audio_Player_Stream::PIPELINE_SAMPLE_RATE) {
+        ImGui::Text("Sink: %.0f Hz", sample_rate);
+    } else {
+        ImGui::Text("Sink: %.0f Hz (resampled from %.0f Hz)", sample_rate, Audio_Player_Stream::PIPELINE_SAMPLE_RATE);
+    }
+
+    const auto& jitter_buffer = player.get_jitter_buffer();
+    ImGui::Text("Jitter buffer: %.0f/%.0f ms (%s)", 
+        jitter_buffer.get_fill_seconds()*1e3f, target_latency_seconds*1e3f,
+        jitter_buffer.get_is_playing() ? "playing" : "buffering");
+    ImGui::Text("Clock drift: %+.1f ppm (trim %+.1f ppm)", jitter_buffer.get_drift_ppm(), jitter_buffer.get_rate_adjustment_ppm());
+    ImGui::Text("Underruns: %zu", jitter_buffer.get_total_underruns());
+    ImGui::Text("Overruns: %zu", jitter_buffer.get_total_overruns());
+}
+
+void RenderAudioSources(Radio_Block& block) {
+    static const char* OVERFLOW_POLICY_LABELS[] = { "Drop oldest", "Drop newest" };
+    int policy = int(block.get_audio_overflow_policy());
+    ImGui::Text("Sources");
+    if (ImGui::Combo("Overflow", &policy, OVERFLOW_POLICY_LABELS, IM_ARRAYSIZE(OVERFLOW_POLICY_LABELS))) {
+        block.set_audio_overflow_policy(Audio_Overflow_Policy(policy));
+    }
+
+    const auto stats = block.get_audio_source_stats();
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable("Audio sources", 5, flags)) {
+        ImGui::TableSetupColumn("Subchannel", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Rate", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Buffered (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Overflows", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Dropped (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        int row_id = 0;
+        for (const auto& source: stats) {
+            // NOTE: Sources that haven't produced audio yet have no sample rate
+            const float sample_rate = (source.sample_rate > 0.0f) ? source.sample_rate : 48000.0f;
+            ImGui::PushID(row_id++);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%u", uint32_t(source.subchannel_id));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.0f Hz", source.sample_rate);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.0f/%.0f", float(source.total_buffered)/sample_rate*1e3f, float(source.capacity)/sample_rate*1e3f);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%zu", source.total_overflows);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.0f", float(source.total_frames_dropped)/sample_rate*1e3f);
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+}
+
+void RenderAudioRecordings(Audio_Recorder& recorder) {
+    const auto stats = recorder.get_stats();
+    ImGui::Text("Recordings (%zu)", stats.size());
+    if (stats.empty()) return;
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable("Audio recordings", 5, flags)) {
+        ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Duration", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Written (MB)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Dropped (kB)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Disk (MB/s)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        int row_id = 0;
+        for (const auto& recording: stats) {
+            const float duration = (recording.sample_rate > 0.0f) ? float(recording.total_frames)/recording.sample_rate : 0.0f;
+            const auto filename = std::filesystem::path(recording.filepath).filename().string();
+            ImGui::PushID(row_id++);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextWrapped("%s%s", filename.c_str(), recording.is_error ? " (write error)" : "");
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.1f s", duration);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2f", float(recording.total_bytes_written)*1e-6f);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.1f", float(recording.total_bytes_dropped)*1e-3f);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.1f", float(recording.write_throughput)*1e-6f);
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+}
+
+void RenderDecodeScheduler(const Radio_Snapshot& snapshot, Decode_Scheduler& scheduler) {
+    // NOTE: The radio lock must never be taken while holding the scheduler lock since the radio thread takes them in that order
+    auto lock = std::scoped_lock(scheduler.get_mutex());
+    auto& settings = scheduler.get_settings();
+    ImGui::Checkbox("Schedule data decoding", &settings.is_enabled);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Data decoding is granted to requested channels while the radio thread keeps within the cpu budget");
+    }
+    float budget_percent = settings.budget * 100.0f;
+    if (ImGui::SliderFloat("Budget", &budget_percent, 10.0f, 100.0f, "%.0f%% of realtime", ImGuiSliderFlags_AlwaysClamp)) {
+        settings.budget = budget_percent / 100.0f;
+    }
+
+    const float load_ms = scheduler.get_load_ms();
+    const float budget_ms = scheduler.get_budget_ms();
+    const auto label = fmt::format("{:.2f}/{:.2f} ms", load_ms, budget_ms);
+    ImGui::ProgressBar((budget_ms > 0.0f) ? (load_ms / budget_ms) : 0.0f, ImVec2(-1.0f, 0.0f), label.c_str());
+    if (scheduler.get_is_base_cost_init()) {
+        ImGui::Text("Base cost: %.2f ms", scheduler.get_base_cost_ms());
+    } else {
+        ImGui::Text("Base cost: waiting for a frame without decoded channels");
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip(
+            "Frame time when only the fic is decoded\n"
+            "Channel costs are measured from the change in frame time when a channel starts or stops decoding\n"
+            "Channels that haven't been measured are estimated from the frame time above the base cost by capacity units");
+    }
+    ImGui::Text("Total sheds: %zu", scheduler.get_total_sheds());
+
+    const auto& db = *snapshot.database;
+    auto get_service_label = [&db](subchannel_id_t subchannel_id) -> std::string_view {
+        const auto* component = find_by_callback(db.service_components, [subchannel_id](const auto& component) {
+            return component.subchannel_id == subchannel_id;
+        });
+        if (component == nullptr) return "";
+        const auto* service = find_by_callback(db.services, [component](const auto& service) {
+            return service.id.get_unique_identifier() == component->service_id.get_unique_identifier();
+        });
+        if (service == nullptr) return "";
+        return service->label;
+    };
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp;
+    if (ImGui::BeginTable("Decode Scheduler", 8, flags)) {
+        ImGui::TableSetupColumn("Subchannel", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Service", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("CUs", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Cost", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Requested", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Granted", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Pinned", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Sheds", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableHeadersRow();
+
+        for (const auto& channel: scheduler.get_channels()) {
+            const auto service_label = get_service_label(channel.subchannel_id);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%u", uint32_t(channel.subchannel_id));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.*s", int(service_label.length()), service_label.data());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%zu", channel.total_capacity_units);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.2f ms%s", channel.estimated_cost_ms, channel.is_cost_measured ? "" : " (est.)");
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%s", channel.is_data_requested ? "Yes" : "No");
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%s", channel.is_data_granted ? "Yes" : (channel.is_audio_decoded ? "Audio" : "No"));
+            ImGui::TableSetColumnIndex(6);
+            ImGui::Text("%s", channel.is_pinned ? "Yes" : "No");
+            ImGui::TableSetColumnIndex(7);
+            ImGui::Text("%zu", channel.total_sheds);
+        }
+        ImGui::EndTable();
+    }
+}
+
+void RenderCifUsage(const Cif_Usage& usage) {
+    const size_t total_units = Cif_Usage::TOTAL_CAPACITY_UNITS;
+    ImGui::Text("CIF usage: %zu subchannels in %zu/%zu capacity units (multiplex uses %zu)",
+        usage.subchannels.size(), usage.total_capacity_units, total_units, usage.total_multiplex_capacity_units);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip(
+            "Subchannels with audio or data enabled in their channel controls\n"
+            "Display only, this doesn't change what the decoder processes");
+    }
+    const float fraction = float(usage.total_capacity_units) / float(total_units);
+    const auto label = fmt::format("{:.1f}% of the CIF", fraction*100.0f);
+    ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), label.c_str());
+    ImGui::Text("Data packet channels: %zu capacity units (no channel controls)", usage.total_data_packet_capacity_units);
+}
+
+void RenderPipelineTelemetry(Pipeline_Telemetry& telemetry) {
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable("Stages", 7, flags)) {
+        ImGui::TableSetupColumn("Stage", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("P50 (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("P90 (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("P99 (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Max (ms)", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Thread CPU", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        int row_id = 0;
+        for (const auto& stage: telemetry.get_stages()) {
+            const auto& histogram = stage->get_histogram();
+            const auto name = stage->get_name();
+            ImGui::PushID(row_id++);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%.*s", int(name.length()), name.data());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%" PRIu64, histogram.get_total_count());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2f", float(histogram.get_quantile(0.5))*1e-3f);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.2f", float(histogram.get_quantile(0.9))*1e-3f);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.2f", float(histogram.get_quantile(0.99))*1e-3f);
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%.2f", float(histogram.get_max_value())*1e-3f);
+            ImGui::TableSetColumnIndex(6);
+            ImGui::Text("%.1f%%", stage->get_cpu_usage()*100.0f);
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("Process CPU: %.1f%%", telemetry.get_process_cpu_usage()*100.0f);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip(
+            "Thread CPU only counts the thread that runs each stage and leaves out the ofdm and dab worker pools\n"
+            "Process CPU counts every thread in sdr++ relative to a single core");
+    }
+    for (const auto& gauge: telemetry.get_gauges()) {
+        const size_t used = gauge.get_used();
+        const size_t capacity = gauge.get_capacity();
+        const float fill_ratio = (capacity > 0) ? float(used)/float(capacity) : 0.0f;
+        const auto label = fmt::format("{}/{}", used, capacity);
+        ImGui::Text("%.*s", int(gauge.name.length()), gauge.name.c_str());
+        ImGui::SameLine();
+        ImGui::ProgressBar(fill_ratio, ImVec2(-1.0f, 0.0f), label.c_str());
+    }
+
+    if (ImGui::Button("Reset")) {
+        telemetry.reset();
+    }
+    ImGui::SameLine();
+    static std::string dump_status;
+    if (ImGui::Button("Dump JSON")) {
+        const auto filepath = core::args["root"].s() + "/dab_plugin_telemetry.json";
+        auto file = std::ofstream(filepath);
+        if (file) {
+            file << telemetry.to_json();
+            dump_status = fmt::format("Wrote {}", filepath);
+        } else {
+            dump_status = fmt::format("Failed to open {}", filepath);
+        }
+    }
+    if (!dump_status.empty()) {
+        ImGui::TextWrapped("%.*s", int(dump_status.length()), dump_status.c_str());
+    }
+}
+
+void RenderOFDMConstellation(Radio_View_Controller& ctx, Constellation_Accumulator& accumulator) {
+    // NOTE: Binning and colour mapping is done on the demodulator thread so we only upload the result
+    auto& image = ctx.constellation_image;
+    const bool is_updated = accumulator.get_image(image, image.version);
+    const int total_bins = int(Constellation_Accumulator::TOTAL_BINS);
+    if (is_updated) {
+        const auto* pixels = reinterpret_cast<const uint8_t*>(image.rgba.data());
+        if (ctx.constellation_texture == nullptr) {
+            ctx.constellation_texture = Texture::LoadFromPixels(pixels, total_bins, total_bins);
+        } else {
+            ctx.constellation_texture->Update(pixels);
+        }
+    }
 
-    const size_t N = data.size();
+    float decay = accumulator.get_decay();
+    if (ImGui::SliderFloat("Decay", &decay, 0.0f, 0.99f)) {
+        accumulator.set_decay(decay);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        accumulator.reset();
+    }
 
-    ImGui::SliderFloat("Scale", &ctx.constellation_scale, 0.0f, 1.0f);
-    
-    // NOTE: This is hard coded into ImGui::ConstellationDiagram
-    //       Taken from sdrplusplus/core/src/gui/widgets/constellation_diagram.h
-    const size_t M = 1024;
-    const size_t K = std::min(M,N);
-    auto& diagram = ctx.constellation_diagram;
-    dsp::complex_t *buf = diagram.acquireBuffer();
+    if (image.version == 0) {
+        ImGui::Text("Waiting for ofdm frames");
+        return;
+    }
+    ImGui::Text("EVM: %.2f%%  MER: %.2f dB  Points: %zu", image.evm_rms, image.mer_db, image.total_points);
+    if (ctx.constellation_texture == nullptr) return;
+    const float width = std::max(std::min(ImGui::GetContentRegionAvail().x, ImGui::GetContentRegionAvail().y), 64.0f);
+    const auto texture_id = reinterpret_cast<ImTextureID>(ctx.constellation_texture->GetTextureID());
+    ImGui::Image(texture_id, ImVec2(width, width));
+}
 
-    const float scale = ctx.constellation_scale / ctx.average_constellation_magnitude;
-    // we compute the average magnitude over time
-    float magnitude = 0.0f;
-    for (size_t i = 0; i < K; i++) {
-        const float I = data[i].real();
-        const float Q = data[i].imag();
-        magnitude += (std::abs(I) + std::abs(Q));
-        buf[i].re = I * scale;
-        buf[i].im = Q * scale;
+void RenderOFDMCarriers(Carrier_Analyser& analyser) {
+    auto analysis = analyser.get_analysis();
+    if (ImGui::Button("Reset")) {
+        analyser.reset();
+    }
+    if (analysis == nullptr) {
+        ImGui::Text("Waiting for ofdm frames");
+        return;
     }
-    diagram.releaseBuffer();
 
-    const float average_magnitude = magnitude / float(K);
-    ctx.average_constellation_magnitude = average_magnitude;
+    ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+    if (ImGui::BeginTable("Carrier summary", 2, flags)) {
+        int row_id = 0;
+        #define FIELD_MACRO(name, fmt, ...) {\
+            ImGui::PushID(row_id++);\
+            ImGui::TableNextRow();\
+            ImGui::TableSetColumnIndex(0);\
+            ImGui::TextWrapped(name);\
+            ImGui::TableSetColumnIndex(1);\
+            ImGui::TextWrapped(fmt, __VA_ARGS__);\
+            ImGui::PopID();\
+        }\
+
+        FIELD_MACRO("Frames", "%" PRIu64, analysis->total_frames);
+        FIELD_MACRO("Average MER", "%.1f dB", analysis->average_mer_db);
+        FIELD_MACRO("Worst MER", "%.1f dB (carrier %zu)", analysis->min_mer_db, analysis->min_mer_carrier);
+        FIELD_MACRO("Magnitude Ripple", "%.1f dB", analysis->magnitude_ripple_db);
+        FIELD_MACRO("Strongest Echo", "%.1f us (%.1f dB)", analysis->echo_delay_us, analysis->echo_level_db);
+        #undef FIELD_MACRO
+        ImGui::EndTable();
+    }
 
-    diagram.draw();
+    const float width = ImGui::GetContentRegionAvail().x;
+    const auto plot_size = ImVec2(width, 120.0f);
+    ImGui::Text("MER per carrier (dB)");
+    ImGui::PlotLines(
+        "###carrier_mer", analysis->mer_db.data(), int(analysis->mer_db.size()), 0,
+        nullptr, 0.0f, 40.0f, plot_size
+    );
+    ImGui::Text("Magnitude per carrier (dB)");
+    ImGui::PlotLines(
+        "###carrier_magnitude", analysis->magnitude_db.data(), int(analysis->magnitude_db.size()), 0,
+        nullptr, -20.0f, 10.0f, plot_size
+    );
+    const float min_delay_us = analysis->impulse_response_start_us;
+    const float max_delay_us = min_delay_us + float(analysis->impulse_response_db.size()) * analysis->impulse_response_resolution_us;
+    ImGui::Text("Impulse response from the PRS (dB, %.0f to %.0f us from the main peak)", min_delay_us, max_delay_us);
+    ImGui::PlotLines(
+        "###impulse_response", analysis->impulse_response_db.data(), int(analysis->impulse_response_db.size()), 0,
+        nullptr, -40.0f, 0.0f, plot_size
+    );
 }
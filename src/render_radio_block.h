@@ -3,32 +3,83 @@
 #include <stdint.h>
 #include <memory>
 #include <optional>
-#include <gui/widgets/constellation_diagram.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "dab/database/dab_database_entities.h"
 #include "dab/mot/MOT_entities.h"
-#include "utility/lru_cache.h"
 #include "utility/span.h"
 #include "./texture.h"
+#include "./texture_cache.h"
+#include "./constellation_accumulator.h"
 
 class Radio_Block;
+struct Radio_Snapshot;
+class Image_Decode_Pool;
+class Slideshow_Disk_Cache;
+class Audio_Player_Stream;
+
+enum class Slideshow_Texture_Status {
+    LOADING, READY, FAILED
+};
+
+struct Slideshow_Texture {
+    Slideshow_Texture_Status status = Slideshow_Texture_Status::LOADING;
+    Texture* texture = nullptr;
+};
+
+// Row in the services dropdown with its labels formatted ahead of time
+struct Service_List_Entry {
+    ServiceId id;
+    std::string label;        // has the service id appended so imgui ids stay unique
+    std::string status_label; // audio and data decode flags
+};
 
 class Radio_View_Controller 
 {
 public:
-    float constellation_scale = 1.0f;
-    float average_constellation_magnitude = 1.0f;
-    ImGui::ConstellationDiagram constellation_diagram;
+    // latest constellation heatmap which is only uploaded when a new frame has been accumulated
+    Constellation_Accumulator::Image constellation_image;
+    std::unique_ptr<Texture> constellation_texture = nullptr;
     std::optional<ServiceId> focused_service_id = std::nullopt;
+    // sorted service list that is only rebuilt when the snapshot's revisions change
+    std::vector<Service_List_Entry> service_list;
+    std::string service_list_dropdown_label;
+    std::optional<uint64_t> service_list_database_revision = std::nullopt;
+    std::optional<uint64_t> service_list_controls_revision = std::nullopt;
+    static constexpr size_t DEFAULT_SLIDESHOW_TEXTURE_BUDGET = 32*1024*1024;
 private:
-    LRU_Cache<uint32_t, std::unique_ptr<Texture>> slideshow_textures_cache;
+    // NOTE: Textures are keyed by their width so thumbnails and full resolution images are cached separately
+    Texture_Cache slideshow_textures_cache;
+    // NOTE: Images are decoded in the background and uploaded a few at a time on the gui thread
+    std::unique_ptr<Image_Decode_Pool> slideshow_decode_pool;
+    std::shared_ptr<Slideshow_Disk_Cache> slideshow_disk_cache;
+    // key to the last frame that the image was requested in
+    std::unordered_map<uint64_t, uint64_t> pending_slideshow_textures;
+    uint64_t frame_index = 0;
+    Audio_Player_Stream* audio_player = nullptr;
 public:
-    Radio_View_Controller() {
-        slideshow_textures_cache.set_max_size(100);
-    }
-    Texture* TryGetSlideshowTexture(
-        subchannel_id_t subchannel_id, mot_transport_id_t transport_id, 
-        tcb::span<const uint8_t> data
+    Radio_View_Controller();
+    ~Radio_View_Controller();
+    // display_width is the width the image is drawn at so a thumbnail can be used instead
+    // a display_width of 0 loads the full resolution image
+    // service_id is used to key images in the disk cache
+    Slideshow_Texture TryGetSlideshowTexture(
+        uint32_t service_id, subchannel_id_t subchannel_id, mot_transport_id_t transport_id, 
+        tcb::span<const uint8_t> data, int display_width=0
     );
+    // NOTE: Must be set before any slideshow is requested since the decode workers are given it when started
+    void SetSlideshowDiskCache(std::shared_ptr<Slideshow_Disk_Cache> disk_cache) { slideshow_disk_cache = disk_cache; }
+    void SetSlideshowTextureBudget(size_t max_bytes) { slideshow_textures_cache.set_max_bytes(max_bytes); }
+    size_t GetSlideshowTextureBudget() const { return slideshow_textures_cache.get_max_bytes(); }
+    size_t GetSlideshowTextureBytes() const { return slideshow_textures_cache.get_total_bytes(); }
+    // shows the output latency controls in the audio tab if set
+    void SetAudioPlayer(Audio_Player_Stream* player) { audio_player = player; }
+    Audio_Player_Stream* GetAudioPlayer() { return audio_player; }
+    // cancels requests that are no longer shown and uploads decoded images
+    // NOTE: Call this once per frame before rendering
+    void UpdateSlideshowTextures();
+    void UpdateServiceList(const Radio_Snapshot& snapshot);
 };
 
 void Render_Radio_Block(Radio_Block& block, Radio_View_Controller& ctx);
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "./slideshow_disk_cache.h"
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <fmt/core.h>
+
+constexpr char INDEX_MAGIC[8] = { 'D','A','B','S','L','D','0','1' };
+constexpr const char* INDEX_FILENAME = "index.bin";
+constexpr const char* PIXELS_EXTENSION = ".rgba";
+// NOTE: Reject corrupt index entries instead of allocating huge images
+constexpr uint32_t MAX_IMAGE_DIMENSION = 8192;
+
+Slideshow_Disk_Cache::Slideshow_Disk_Cache(const std::string& directory, size_t max_bytes)
+: m_directory(directory), m_max_bytes(max_bytes), m_total_bytes(0), m_access_counter(0), m_is_index_dirty(false)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    load_index();
+    evict();
+}
+
+Slideshow_Disk_Cache::~Slideshow_Disk_Cache() {
+    auto lock = std::unique_lock(m_mutex);
+    if (m_is_index_dirty) save_index();
+}
+
+Slideshow_Disk_Cache::Key Slideshow_Disk_Cache::get_key(tcb::span<const uint8_t> data, uint32_t service_id, uint16_t transport_id) {
+    // fnv-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const uint8_t x: data) {
+        hash ^= uint64_t(x);
+        hash *= 0x100000001b3ull;
+    }
+    Key key;
+    key.content_hash = hash;
+    key.content_size = uint32_t(data.size());
+    key.service_id = service_id;
+    key.transport_id = transport_id;
+    return key;
+}
+
+std::string Slideshow_Disk_Cache::get_filename(const Key& key) {
+    // NOTE: The content size is part of the name to make hash collisions even less likely
+    return fmt::format("{:016x}_{:08x}_{:08x}_{:04x}{}",
+        key.content_hash, key.content_size, key.service_id, key.transport_id, PIXELS_EXTENSION);
+}
+
+std::unique_ptr<Texture_Image> Slideshow_Disk_Cache::load(const Key& key) {
+    const auto filename = get_filename(key);
+    uint32_t width = 0;
+    uint32_t height = 0;
+    {
+        auto lock = std::unique_lock(m_mutex);
+        auto it = m_entries.find(filename);
+        if (it == m_entries.end()) return nullptr;
+        auto& entry = it->second;
+        entry.last_access = ++m_access_counter;
+        m_is_index_dirty = true;
+        width = entry.width;
+        height = entry.height;
+    }
+
+    auto image = Texture_Image::Create(int(width), int(height));
+    if (image == nullptr) return nullptr;
+    // NOTE: The file can be evicted by another thread while it is read which just counts as a miss
+    auto file = std::ifstream((std::filesystem::path(m_directory) / filename), std::ios::binary);
+    if (!file.is_open()) return nullptr;
+    const size_t total_bytes = size_t(width)*size_t(height)*4;
+    file.read(reinterpret_cast<char*>(image->GetPixels()), std::streamsize(total_bytes));
+    if (!file) return nullptr;
+    return image;
+}
+
+void Slideshow_Disk_Cache::store(const Key& key, const Texture_Image& image) {
+    const auto filename = get_filename(key);
+    Entry entry;
+    entry.key = key;
+    entry.width = uint32_t(image.GetWidth());
+    entry.height = uint32_t(image.GetHeight());
+    const size_t total_bytes = get_entry_bytes(entry);
+    if (total_bytes > m_max_bytes) return;
+
+    auto lock = std::unique_lock(m_mutex);
+    if (m_entries.find(filename) != m_entries.end()) return;
+    // NOTE: Write to a temporary file so a crash never leaves a truncated image behind
+    const auto filepath = std::filesystem::path(m_directory) / filename;
+    auto temp_filepath = filepath;
+    temp_filepath += ".tmp";
+    {
+        auto file = std::ofstream(temp_filepath, std::ios::binary);
+        if (!file.is_open()) return;
+        file.write(reinterpret_cast<const char*>(image.GetPixels()), std::streamsize(total_bytes));
+        if (!file) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filepath, filepath, ec);
+    if (ec) {
+        std::filesystem::remove(temp_filepath, ec);
+        return;
+    }
+    entry.last_access = ++m_access_counter;
+    m_entries.insert({ filename, entry });
+    m_total_bytes += total_bytes;
+    evict();
+    save_index();
+}
+
+void Slideshow_Disk_Cache::set_max_bytes(size_t max_bytes) {
+    auto lock = std::unique_lock(m_mutex);
+    m_max_bytes = max_bytes;
+    evict();
+}
+
+size_t Slideshow_Disk_Cache::get_max_bytes() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_max_bytes;
+}
+
+size_t Slideshow_Disk_Cache::get_total_bytes() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_total_bytes;
+}
+
+size_t Slideshow_Disk_Cache::get_total_entries() {
+    auto lock = std::unique_lock(m_mutex);
+    return m_entries.size();
+}
+
+void Slideshow_Disk_Cache::load_index() {
+    auto file = std::ifstream(std::filesystem::path(m_directory) / INDEX_FILENAME, std::ios::binary);
+    if (file.is_open()) {
+        char magic[sizeof(INDEX_MAGIC)];
+        uint64_t access_counter = 0;
+        uint64_t total_entries = 0;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&access_counter), sizeof(access_counter));
+        file.read(reinterpret_cast<char*>(&total_entries), sizeof(total_entries));
+        const bool is_valid = file && (memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0);
+        for (uint64_t i = 0; is_valid && (i < total_entries); i++) {
+            Entry entry;
+            uint32_t transport_id = 0;
+            file.read(reinterpret_cast<char*>(&entry.key.content_hash), sizeof(entry.key.content_hash));
+            file.read(reinterpret_cast<char*>(&entry.key.content_size), sizeof(entry.key.content_size));
+            file.read(reinterpret_cast<char*>(&entry.key.service_id), sizeof(entry.key.service_id));
+            file.read(reinterpret_cast<char*>(&transport_id), sizeof(transport_id));
+            file.read(reinterpret_cast<char*>(&entry.width), sizeof(entry.width));
+            file.read(reinterpret_cast<char*>(&entry.height), sizeof(entry.height));
+            file.read(reinterpret_cast<char*>(&entry.last_access), sizeof(entry.last_access));
+            if (!file) break;
+            entry.key.transport_id = uint16_t(transport_id);
+            if ((entry.width == 0) || (entry.height == 0)) continue;
+            if ((entry.width > MAX_IMAGE_DIMENSION) || (entry.height > MAX_IMAGE_DIMENSION)) continue;
+            // NOTE: Skip images that were deleted or only partially written
+            const auto filename = get_filename(entry.key);
+            std::error_code ec;
+            const auto file_size = std::filesystem::file_size(std::filesystem::path(m_directory) / filename, ec);
+            if (ec || (file_size != get_entry_bytes(entry))) continue;
+            m_entries.insert({ filename, entry });
+            m_total_bytes += get_entry_bytes(entry);
+        }
+        if (is_valid) m_access_counter = access_counter;
+    }
+
+    // remove images that aren't in the index
+    std::error_code ec;
+    std::vector<std::filesystem::path> orphans;
+    for (const auto& it: std::filesystem::directory_iterator(m_directory, ec)) {
+        const auto& path = it.path();
+        const auto extension = path.extension().string();
+        if ((extension != PIXELS_EXTENSION) && (extension != ".tmp")) continue;
+        if (m_entries.find(path.filename().string()) != m_entries.end()) continue;
+        orphans.push_back(path);
+    }
+    for (const auto& path: orphans) {
+        std::filesystem::remove(path, ec);
+    }
+}
+
+void Slideshow_Disk_Cache::save_index() {
+    const auto filepath = std::filesystem::path(m_directory) / INDEX_FILENAME;
+    auto temp_filepath = filepath;
+    temp_filepath += ".tmp";
+    {
+        auto file = std::ofstream(temp_filepath, std::ios::binary);
+        if (!file.is_open()) return;
+        const uint64_t total_entries = uint64_t(m_entries.size());
+        file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        file.write(reinterpret_cast<const char*>(&m_access_counter), sizeof(m_access_counter));
+        file.write(reinterpret_cast<const char*>(&total_entries), sizeof(total_entries));
+        for (const auto& [_, entry]: m_entries) {
+            const uint32_t transport_id = uint32_t(entry.key.transport_id);
+            file.write(reinterpret_cast<const char*>(&entry.key.content_hash), sizeof(entry.key.content_hash));
+            file.write(reinterpret_cast<const char*>(&entry.key.content_size), sizeof(entry.key.content_size));
+            file.write(reinterpret_cast<const char*>(&entry.key.service_id), sizeof(entry.key.service_id));
+            file.write(reinterpret_cast<const char*>(&transport_id), sizeof(transport_id));
+            file.write(reinterpret_cast<const char*>(&entry.width), sizeof(entry.width));
+            file.write(reinterpret_cast<const char*>(&entry.height), sizeof(entry.height));
+            file.write(reinterpret_cast<const char*>(&entry.last_access), sizeof(entry.last_access));
+        }
+        if (!file) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_filepath, filepath, ec);
+    if (!ec) m_is_index_dirty = false;
+}
+
+void Slideshow_Disk_Cache::evict() {
+    if (m_total_bytes <= m_max_bytes) return;
+    std::vector<std::pair<uint64_t, std::string>> entries;
+    entries.reserve(m_entries.size());
+    for (const auto& [filename, entry]: m_entries) {
+        entries.push_back({ entry.last_access, filename });
+    }
+    std::sort(entries.begin(), entries.end());
+    for (const auto& [_, filename]: entries) {
+        if (m_total_bytes <= m_max_bytes) break;
+        auto it = m_entries.find(filename);
+        m_total_bytes -= get_entry_bytes(it->second);
+        m_entries.erase(it);
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::path(m_directory) / filename, ec);
+        m_is_index_dirty = true;
+    }
+}
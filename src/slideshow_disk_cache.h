@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "utility/span.h"
+#include "./texture.h"
+
+// Decoded slideshow images stored on disk so they survive restarts and retuning
+// - Images are keyed by a hash of their compressed data along with the service and transport id
+// - Pixels are stored as raw rgba so a hit skips decoding entirely
+// - An index file tracks when each image was last used and the least recently used images
+//   are deleted once the cache is over its size limit
+class Slideshow_Disk_Cache
+{
+public:
+    struct Key {
+        uint64_t content_hash = 0;
+        uint32_t content_size = 0;
+        uint32_t service_id = 0;
+        uint16_t transport_id = 0;
+    };
+private:
+    struct Entry {
+        Key key;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint64_t last_access = 0;
+    };
+    const std::string m_directory;
+    size_t m_max_bytes;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    size_t m_total_bytes;
+    uint64_t m_access_counter;
+    bool m_is_index_dirty;
+public:
+    Slideshow_Disk_Cache(const std::string& directory, size_t max_bytes);
+    ~Slideshow_Disk_Cache();
+    Slideshow_Disk_Cache(const Slideshow_Disk_Cache&) = delete;
+    Slideshow_Disk_Cache& operator=(const Slideshow_Disk_Cache&) = delete;
+    static Key get_key(tcb::span<const uint8_t> data, uint32_t service_id, uint16_t transport_id);
+    // returns nullptr if the image isn't cached
+    std::unique_ptr<Texture_Image> load(const Key& key);
+    void store(const Key& key, const Texture_Image& image);
+    void set_max_bytes(size_t max_bytes);
+    size_t get_max_bytes();
+    size_t get_total_bytes();
+    size_t get_total_entries();
+private:
+    static std::string get_filename(const Key& key);
+    static size_t get_entry_bytes(const Entry& entry) {
+        return size_t(entry.width) * size_t(entry.height) * 4;
+    }
+    void load_index();
+    void save_index();
+    void evict();
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "utility/span.h"
+
+// Lock free single producer single consumer ring buffer
+// - The producer never blocks and the consumer can optionally wait for data
+// - Reads can be done in place if the capacity is a multiple of the read size
+template <typename T>
+class Spsc_Ring_Buffer
+{
+private:
+    std::vector<T> m_buffer;
+    // monotonic counters so that full and empty are distinguishable
+    alignas(64) std::atomic<size_t> m_write_index;
+    alignas(64) std::atomic<size_t> m_read_index;
+    alignas(64) std::atomic<bool> m_is_reader_waiting;
+    std::atomic<bool> m_is_writer_waiting;
+    std::atomic<bool> m_is_closed;
+    std::mutex m_mutex_wait;
+    std::condition_variable m_cv_wait;
+public:
+    explicit Spsc_Ring_Buffer(size_t capacity)
+    : m_buffer(capacity), m_write_index(0), m_read_index(0), m_is_reader_waiting(false), m_is_writer_waiting(false), m_is_closed(false)
+    {
+        assert(capacity > 0);
+    }
+    Spsc_Ring_Buffer(const Spsc_Ring_Buffer&) = delete;
+    Spsc_Ring_Buffer& operator=(const Spsc_Ring_Buffer&) = delete;
+    size_t get_capacity() const { return m_buffer.size(); }
+    size_t get_total_available() const { return m_write_index.load() - m_read_index.load(); }
+    bool is_closed() const { return m_is_closed; }
+    // producer
+    size_t get_total_free() const { return get_capacity() - get_total_available(); }
+    size_t write(tcb::span<const T> src) {
+        const size_t N = std::min(src.size(), get_total_free());
+        const size_t write_index = m_write_index.load(std::memory_order_relaxed);
+        const size_t offset = write_index % m_buffer.size();
+        const size_t total_head = std::min(N, m_buffer.size()-offset);
+        std::copy_n(src.begin(), total_head, m_buffer.begin() + offset);
+        std::copy_n(src.begin() + total_head, N-total_head, m_buffer.begin());
+        m_write_index.store(write_index + N);
+        notify_reader();
+        return N;
+    }
+    // returns false if the buffer was closed before enough space was free
+    // NOTE: Only for producers that can be throttled, e.g. reading from a file
+    bool wait_for_free(size_t length) {
+        assert(length <= get_capacity());
+        while (get_total_free() < length) {
+            if (m_is_closed) return false;
+            m_is_writer_waiting = true;
+            auto lock = std::unique_lock(m_mutex_wait);
+            if ((get_total_free() < length) && !m_is_closed) {
+                m_cv_wait.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            m_is_writer_waiting = false;
+        }
+        return !m_is_closed;
+    }
+    void close() {
+        m_is_closed = true;
+        auto lock = std::unique_lock(m_mutex_wait);
+        m_cv_wait.notify_all();
+    }
+    // consumer
+    // returns the largest contiguous block that can be read in place up to max_length
+    tcb::span<const T> peek(size_t max_length) const {
+        const size_t read_index = m_read_index.load(std::memory_order_relaxed);
+        const size_t offset = read_index % m_buffer.size();
+        const size_t N = std::min({max_length, get_total_available(), m_buffer.size()-offset});
+        return tcb::span<const T>(m_buffer.data() + offset, N);
+    }
+    void consume(size_t length) {
+        assert(length <= get_total_available());
+        m_read_index.store(m_read_index.load(std::memory_order_relaxed) + length);
+        notify_writer();
+    }
+    size_t read(tcb::span<T> dest) {
+        size_t total_read = 0;
+        while (total_read < dest.size()) {
+            auto block = peek(dest.size()-total_read);
+            if (block.empty()) break;
+            std::copy_n(block.begin(), block.size(), dest.begin() + total_read);
+            consume(block.size());
+            total_read += block.size();
+        }
+        return total_read;
+    }
+    // returns false if the buffer was closed before enough data was available
+    bool wait_for_available(size_t length) {
+        while (get_total_available() < length) {
+            if (m_is_closed) return false;
+            m_is_reader_waiting = true;
+            auto lock = std::unique_lock(m_mutex_wait);
+            // recheck after setting the flag since the producer might have written before it was set
+            if ((get_total_available() < length) && !m_is_closed) {
+                // NOTE: Timeout as a fallback incase the producer stops without closing the buffer
+                m_cv_wait.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            m_is_reader_waiting = false;
+        }
+        return true;
+    }
+private:
+    void notify_reader() {
+        if (!m_is_reader_waiting) return;
+        auto lock = std::unique_lock(m_mutex_wait);
+        m_cv_wait.notify_all();
+    }
+    void notify_writer() {
+        if (!m_is_writer_waiting) return;
+        auto lock = std::unique_lock(m_mutex_wait);
+        m_cv_wait.notify_all();
+    }
+};
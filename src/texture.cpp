@@ -1,7 +1,9 @@
 #include "./texture.h"
+#include <algorithm>
 
 #if _WIN32
 #define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
 #include <windows.h>
 #endif 
 
@@ -26,8 +28,27 @@ Texture::~Texture() {
     glDeleteTextures(1, &id);
 }
 
+Texture_Image::Texture_Image(uint8_t* pixels, int width, int height)
+: m_pixels(pixels), m_width(width), m_height(height)
+{}
 
-std::unique_ptr<Texture> Texture::LoadFromMemory(const uint8_t* data, const size_t total_bytes) {
+Texture_Image::~Texture_Image() {
+    stbi_image_free(m_pixels);
+}
+
+std::unique_ptr<Texture_Image> Texture_Image::Create(int width, int height) {
+    if ((width <= 0) || (height <= 0)) {
+        return nullptr;
+    }
+    // NOTE: Allocate with stb so the destructor can free both decoded and created images
+    auto* pixels = reinterpret_cast<uint8_t*>(STBI_MALLOC(size_t(width)*size_t(height)*4));
+    if (pixels == nullptr) {
+        return nullptr;
+    }
+    return std::make_unique<Texture_Image>(pixels, width, height);
+}
+
+std::unique_ptr<Texture_Image> Texture_Image::DecodeFromMemory(const uint8_t* data, const size_t total_bytes) {
     int width = 0;
     int height = 0;
     int bits_per_pixel = 0;
@@ -39,7 +60,61 @@ std::unique_ptr<Texture> Texture::LoadFromMemory(const uint8_t* data, const size
     if (image_data == nullptr) {
         return nullptr;
     }
-    
+    return std::make_unique<Texture_Image>(image_data, width, height);
+}
+
+std::unique_ptr<Texture_Image> Texture_Image::Downscale(int max_width) const {
+    if ((max_width <= 0) || (m_width <= max_width)) {
+        return nullptr;
+    }
+    const int width = max_width;
+    const int height = std::max(int((int64_t(m_height)*int64_t(width)) / int64_t(m_width)), 1);
+    auto image = Create(width, height);
+    if (image == nullptr) {
+        return nullptr;
+    }
+    uint8_t* pixels = image->GetPixels();
+
+    for (int y = 0; y < height; y++) {
+        const int y0 = int((int64_t(y)*m_height) / height);
+        const int y1 = std::max(int((int64_t(y+1)*m_height) / height), y0+1);
+        for (int x = 0; x < width; x++) {
+            const int x0 = int((int64_t(x)*m_width) / width);
+            const int x1 = std::max(int((int64_t(x+1)*m_width) / width), x0+1);
+            uint32_t sum[4] = {0,0,0,0};
+            for (int sy = y0; sy < y1; sy++) {
+                const uint8_t* src = &m_pixels[(size_t(sy)*size_t(m_width) + size_t(x0))*4];
+                for (int sx = x0; sx < x1; sx++) {
+                    sum[0] += src[0];
+                    sum[1] += src[1];
+                    sum[2] += src[2];
+                    sum[3] += src[3];
+                    src += 4;
+                }
+            }
+            const uint32_t total = uint32_t((y1-y0)*(x1-x0));
+            uint8_t* dst = &pixels[(size_t(y)*size_t(width) + size_t(x))*4];
+            for (int i = 0; i < 4; i++) {
+                dst[i] = uint8_t((sum[i] + total/2) / total);
+            }
+        }
+    }
+    return image;
+}
+
+std::unique_ptr<Texture> Texture::LoadFromMemory(const uint8_t* data, const size_t total_bytes) {
+    auto image = Texture_Image::DecodeFromMemory(data, total_bytes);
+    if (image == nullptr) {
+        return nullptr;
+    }
+    return LoadFromImage(*image);
+}
+
+std::unique_ptr<Texture> Texture::LoadFromImage(const Texture_Image& image) {
+    return LoadFromPixels(image.GetPixels(), image.GetWidth(), image.GetHeight());
+}
+
+std::unique_ptr<Texture> Texture::LoadFromPixels(const uint8_t* rgba, int width, int height) {
     GLuint id = 0;
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
@@ -57,7 +132,11 @@ std::unique_ptr<Texture> Texture::LoadFromMemory(const uint8_t* data, const size
 
     // give image buffer to opengl
     // stbi_set_flip_vertically_on_load(1);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-    stbi_image_free(image_data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
     return std::make_unique<Texture>(id, width, height);
 }
+
+void Texture::Update(const uint8_t* rgba) {
+    glBindTexture(GL_TEXTURE_2D, GLuint(m_id));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
@@ -5,6 +5,34 @@
 #include <memory>
 #include "imgui.h"
 
+// RGBA8 pixels decoded on the cpu which can be uploaded into a texture later
+// NOTE: Decoding doesn't touch opengl so this can be done off the gui thread
+class Texture_Image
+{
+private:
+    uint8_t* m_pixels;
+    const int m_width;
+    const int m_height;
+public:
+    Texture_Image(uint8_t* pixels, int width, int height);
+    ~Texture_Image();
+    Texture_Image(Texture_Image&) = delete;
+    Texture_Image(Texture_Image&&) = delete;
+    Texture_Image& operator=(Texture_Image&) = delete;
+    Texture_Image& operator=(Texture_Image&&) = delete;
+    uint8_t* GetPixels() { return m_pixels; }
+    const uint8_t* GetPixels() const { return m_pixels; }
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+public:
+    // uninitialised pixels which the caller fills in
+    static std::unique_ptr<Texture_Image> Create(int width, int height);
+    static std::unique_ptr<Texture_Image> DecodeFromMemory(const uint8_t* data, const size_t total_bytes);
+    // box filter down to the width while keeping the aspect ratio
+    // returns nullptr if the image is already narrow enough
+    std::unique_ptr<Texture_Image> Downscale(int max_width) const;
+};
+
 class Texture
 {
 private:
@@ -23,4 +51,9 @@ public:
     inline int GetHeight() const { return m_height; }
 public:
     static std::unique_ptr<Texture> LoadFromMemory(const uint8_t* data, const size_t total_bytes);
+    // NOTE: These must be called from the thread that owns the opengl context
+    static std::unique_ptr<Texture> LoadFromImage(const Texture_Image& image);
+    static std::unique_ptr<Texture> LoadFromPixels(const uint8_t* rgba, int width, int height);
+    // replace the pixels without reallocating the texture
+    void Update(const uint8_t* rgba);
 };
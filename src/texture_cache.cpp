@@ -0,0 +1,52 @@
+#include "./texture_cache.h"
+#include <algorithm>
+
+Texture_Cache::Texture_Cache(size_t max_bytes, size_t max_entries)
+: m_max_bytes(max_bytes), m_total_bytes(0), m_max_entries(std::max(max_entries, size_t(1)))
+{}
+
+Texture* Texture_Cache::find(uint64_t key) {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) return nullptr;
+    auto& entry = it->second;
+    m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+    return entry.texture.get();
+}
+
+void Texture_Cache::insert(uint64_t key, std::unique_ptr<Texture> texture) {
+    const size_t total_bytes = (texture != nullptr) ? get_texture_bytes(*texture) : 0;
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        auto& entry = it->second;
+        m_total_bytes -= entry.total_bytes;
+        entry.texture = std::move(texture);
+        entry.total_bytes = total_bytes;
+        m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+    } else {
+        m_lru.push_front(key);
+        Entry entry;
+        entry.texture = std::move(texture);
+        entry.total_bytes = total_bytes;
+        entry.lru_it = m_lru.begin();
+        m_entries.emplace(key, std::move(entry));
+    }
+    m_total_bytes += total_bytes;
+    evict(key);
+}
+
+void Texture_Cache::set_max_bytes(size_t max_bytes) {
+    m_max_bytes = max_bytes;
+    if (m_lru.empty()) return;
+    evict(m_lru.front());
+}
+
+void Texture_Cache::evict(uint64_t keep_key) {
+    while (((m_total_bytes > m_max_bytes) || (m_entries.size() > m_max_entries)) && !m_lru.empty()) {
+        const uint64_t key = m_lru.back();
+        if (key == keep_key) break;
+        auto it = m_entries.find(key);
+        m_total_bytes -= it->second.total_bytes;
+        m_lru.pop_back();
+        m_entries.erase(it);
+    }
+}
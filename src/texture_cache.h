@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "./texture.h"
+
+// Least recently used cache of textures that is limited by the total size of the textures
+// - Entries without a texture are kept so that images which failed to load aren't retried
+// - The most recently inserted entry is never evicted even if it is larger than the budget
+class Texture_Cache
+{
+private:
+    struct Entry {
+        std::unique_ptr<Texture> texture;
+        size_t total_bytes = 0;
+        std::list<uint64_t>::iterator lru_it;
+    };
+    std::list<uint64_t> m_lru; // front is most recently used
+    std::unordered_map<uint64_t, Entry> m_entries;
+    size_t m_max_bytes;
+    size_t m_total_bytes;
+    size_t m_max_entries;
+public:
+    explicit Texture_Cache(size_t max_bytes, size_t max_entries=1024);
+    Texture_Cache(const Texture_Cache&) = delete;
+    Texture_Cache& operator=(const Texture_Cache&) = delete;
+    bool contains(uint64_t key) const { return m_entries.find(key) != m_entries.end(); }
+    // returns nullptr if there is no entry or the entry has no texture
+    Texture* find(uint64_t key);
+    void insert(uint64_t key, std::unique_ptr<Texture> texture);
+    void set_max_bytes(size_t max_bytes);
+    size_t get_max_bytes() const { return m_max_bytes; }
+    size_t get_total_bytes() const { return m_total_bytes; }
+    size_t get_total_entries() const { return m_entries.size(); }
+    static size_t get_texture_bytes(const Texture& texture) {
+        return size_t(texture.GetWidth()) * size_t(texture.GetHeight()) * 4;
+    }
+private:
+    void evict(uint64_t keep_key);
+};
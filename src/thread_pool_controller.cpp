@@ -0,0 +1,74 @@
+#include "./thread_pool_controller.h"
+#include <algorithm>
+#include <thread>
+
+static size_t clamp_threads(size_t value, size_t min, size_t max) {
+    return std::max(min, std::min(value, max));
+}
+
+Thread_Pool_Controller::Thread_Pool_Controller(size_t total_radio_blocks)
+: m_total_cores(std::max(size_t(std::thread::hardware_concurrency()), size_t(1)))
+{
+    const size_t total_blocks = std::max(total_radio_blocks, size_t(1));
+    // NOTE: Leave half of the cores for sdr++ and the audio pipeline
+    const size_t max_threads = clamp_threads(m_total_cores/2/total_blocks, 1, 8);
+    // NOTE: A quarter of the cores for each pool is enough to keep up with a full ensemble
+    //       on most machines, and the adaptive controller will grow the pools if this is not the case
+    const size_t initial_threads = clamp_threads(m_total_cores/4/total_blocks, 1, max_threads);
+    for (auto* pool: {&m_ofdm, &m_dab}) {
+        pool->min_threads = 1;
+        pool->max_threads = max_threads;
+        pool->total_threads = initial_threads;
+        pool->frame_times_ms.resize(TOTAL_FRAME_TIMES, 0.0f);
+    }
+}
+
+void Thread_Pool_Controller::update(Pool& pool, float frame_time_ms, size_t queue_depth, size_t total_active_threads) {
+    auto lock = std::scoped_lock(m_mutex);
+    pool.frame_times_ms[pool.frame_times_index] = frame_time_ms;
+    pool.frame_times_index = (pool.frame_times_index+1) % pool.frame_times_ms.size();
+
+    const float load = frame_time_ms / REALTIME_FRAME_PERIOD_MS;
+    const float beta = m_settings.load_update_beta;
+    pool.load_average = (1.0f-beta)*pool.load_average + beta*load;
+    // NOTE: Wait for the last change to be applied since the load doesn't reflect it until then
+    if (!m_settings.is_adaptive || (total_active_threads != pool.total_threads)) {
+        pool.total_grow_ticks = 0;
+        pool.total_shrink_ticks = 0;
+        return;
+    }
+
+    // hysteresis so that we don't flip flop between thread counts
+    const bool is_behind =
+        (pool.load_average > m_settings.grow_load_threshold) ||
+        (queue_depth >= m_settings.grow_queue_depth);
+    const bool is_idle =
+        (pool.load_average < m_settings.shrink_load_threshold) &&
+        (queue_depth == 0);
+    pool.total_grow_ticks = is_behind ? (pool.total_grow_ticks+1) : 0;
+    pool.total_shrink_ticks = is_idle ? (pool.total_shrink_ticks+1) : 0;
+
+    if (pool.total_grow_ticks >= m_settings.total_ticks_to_grow) {
+        pool.total_grow_ticks = 0;
+        pool.total_threads = clamp_threads(pool.total_threads+1, pool.min_threads, pool.max_threads);
+    } else if (pool.total_shrink_ticks >= m_settings.total_ticks_to_shrink) {
+        pool.total_shrink_ticks = 0;
+        // NOTE: Check against the load we would have with one less thread
+        //       This assumes the work is split evenly between the threads
+        const size_t new_threads = clamp_threads(pool.total_threads-1, pool.min_threads, pool.max_threads);
+        const float new_load = pool.load_average * float(pool.total_threads) / float(new_threads);
+        if (new_load < m_settings.grow_load_threshold) {
+            pool.total_threads = new_threads;
+        }
+    }
+}
+
+void Thread_Pool_Controller::set_total_threads(Pool& pool, size_t total_threads) {
+    auto lock = std::scoped_lock(m_mutex);
+    total_threads = std::max(total_threads, size_t(1));
+    pool.min_threads = std::min(pool.min_threads, total_threads);
+    pool.max_threads = std::max(pool.max_threads, total_threads);
+    pool.total_threads = total_threads;
+    pool.total_grow_ticks = 0;
+    pool.total_shrink_ticks = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+// Picks the number of worker threads for the ofdm demodulator and dab decoder
+// Initial values are sized from the number of cores on the host
+// Each radio block has its own controller so one overloaded ensemble can't resize the pools of another
+// When adaptive it looks at per-frame processing time and queue depth to grow or shrink each pool
+// NOTE: The pools can't be resized in place so a new size only takes effect on the next reset or retune
+class Thread_Pool_Controller
+{
+public:
+    struct Pool {
+        size_t total_threads = 1;
+        size_t min_threads = 1;
+        size_t max_threads = 1;
+        float load_average = 0.0f;       // processing time relative to realtime frame period
+        size_t total_grow_ticks = 0;
+        size_t total_shrink_ticks = 0;
+        std::vector<float> frame_times_ms; // circular buffer of recent per-frame times
+        size_t frame_times_index = 0;
+    };
+    struct Settings {
+        bool is_adaptive = false;
+        float grow_load_threshold = 0.8f;
+        float shrink_load_threshold = 0.3f;
+        float load_update_beta = 0.1f;
+        size_t grow_queue_depth = 2;
+        size_t total_ticks_to_grow = 10;
+        size_t total_ticks_to_shrink = 100;
+    };
+    static constexpr size_t TOTAL_FRAME_TIMES = 128;
+    // DAB transmission mode I frames are 96ms long
+    static constexpr float REALTIME_FRAME_PERIOD_MS = 96.0f;
+private:
+    std::mutex m_mutex;
+    const size_t m_total_cores;
+    Settings m_settings;
+    Pool m_ofdm;
+    Pool m_dab;
+public:
+    // the cores are split evenly between the radio blocks that run at the same time
+    explicit Thread_Pool_Controller(size_t total_radio_blocks=1);
+    // called from the thread that runs each stage once per frame with the thread count it is running with
+    void update_ofdm(float frame_time_ms, size_t queue_depth, size_t total_active_threads) {
+        update(m_ofdm, frame_time_ms, queue_depth, total_active_threads);
+    }
+    void update_dab(float frame_time_ms, size_t queue_depth, size_t total_active_threads) {
+        update(m_dab, frame_time_ms, queue_depth, total_active_threads);
+    }
+    size_t get_ofdm_total_threads() { auto lock = std::scoped_lock(m_mutex); return m_ofdm.total_threads; }
+    size_t get_dab_total_threads() { auto lock = std::scoped_lock(m_mutex); return m_dab.total_threads; }
+    size_t get_total_cores() const { return m_total_cores; }
+    // pin a pool to a thread count, this widens the pool's limits if needed
+    void set_ofdm_total_threads(size_t total_threads) { set_total_threads(m_ofdm, total_threads); }
+    void set_dab_total_threads(size_t total_threads) { set_total_threads(m_dab, total_threads); }
+    // gui access
+    std::mutex& get_mutex() { return m_mutex; }
+    Settings& get_settings() { return m_settings; }
+    const Pool& get_ofdm_pool() const { return m_ofdm; }
+    const Pool& get_dab_pool() const { return m_dab; }
+private:
+    void update(Pool& pool, float frame_time_ms, size_t queue_depth, size_t total_active_threads);
+    void set_total_threads(Pool& pool, size_t total_threads);
+};
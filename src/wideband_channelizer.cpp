@@ -0,0 +1,159 @@
+#include "./wideband_channelizer.h"
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <volk/volk.h>
+
+constexpr float PI = 3.14159265358979323846f;
+// NOTE: Bins are spaced at most an eighth of the output rate apart so the widened prototype
+//       still rejects the aliases of the neighbouring ensembles
+constexpr size_t MIN_BINS_PER_DECIMATION = 8;
+// NOTE: The new input is filtered in blocks of this size so the history never has to grow
+constexpr size_t MAX_INPUT_BLOCK_SIZE = 8192;
+
+// windowed sinc lowpass filter
+static void create_prototype_filter(tcb::span<float> taps, float cutoff_norm) {
+    const size_t N = taps.size();
+    const float M = float(N-1);
+    float sum = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        const float n = float(i) - M/2.0f;
+        const float x = 2.0f*cutoff_norm*n;
+        const float sinc = (n == 0.0f) ? 1.0f : std::sin(PI*x)/(PI*x);
+        // blackman window
+        const float k = 2.0f*PI*float(i)/M;
+        const float window = 0.42f - 0.5f*std::cos(k) + 0.08f*std::cos(2.0f*k);
+        taps[i] = 2.0f*cutoff_norm*sinc*window;
+        sum += taps[i];
+    }
+    // unity gain at DC
+    for (auto& tap: taps) {
+        tap /= sum;
+    }
+}
+
+static size_t get_fft_size(size_t decimation_factor) {
+    size_t total_bins = 1;
+    while (total_bins < decimation_factor*MIN_BINS_PER_DECIMATION) total_bins <<= 1;
+    return total_bins;
+}
+
+static size_t round_up(size_t value, size_t multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+Wideband_Channelizer::Wideband_Channelizer(size_t decimation_factor, size_t taps_per_phase, float cutoff_norm)
+: m_decimation_factor(decimation_factor),
+  m_total_bins(get_fft_size(decimation_factor)),
+  m_total_taps(round_up(decimation_factor*taps_per_phase, m_total_bins))
+{
+    assert(m_decimation_factor > 0);
+    assert(m_total_taps > 0);
+    const size_t M = m_total_bins;
+    const size_t T = m_total_taps;
+    // NOTE: A channel can be up to half a bin away from the centre of its bin
+    std::vector<float> prototype(T);
+    create_prototype_filter(prototype, cutoff_norm + 0.5f/float(M));
+    m_taps.resize(T);
+    for (size_t i = 0; i < T; i++) {
+        m_taps[T-1-i] = prototype[i];
+    }
+    m_history.resize(T-1 + MAX_INPUT_BLOCK_SIZE, std::complex<float>(0.0f, 0.0f));
+    m_next_output_index = T-1;
+    m_product.resize(T);
+    m_bins.resize(M);
+    // radix-2 inverse fft tables
+    m_twiddles.resize(M/2);
+    for (size_t i = 0; i < M/2; i++) {
+        const float angle = 2.0f*PI*float(i)/float(M);
+        m_twiddles[i] = std::complex<float>(std::cos(angle), std::sin(angle));
+    }
+    m_bit_reverse.resize(M);
+    size_t total_bits = 0;
+    while ((size_t(1) << total_bits) < M) total_bits++;
+    for (size_t i = 0; i < M; i++) {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < total_bits; bit++) {
+            if (i & (size_t(1) << bit)) reversed |= size_t(1) << (total_bits-1-bit);
+        }
+        m_bit_reverse[i] = reversed;
+    }
+}
+
+void Wideband_Channelizer::set_channel_frequencies(tcb::span<const float> frequencies_norm) {
+    auto lock = std::unique_lock(m_mutex_channels);
+    const size_t total_existing = m_channels.size();
+    m_channels.resize(frequencies_norm.size());
+    const long M = long(m_total_bins);
+    for (size_t i = 0; i < m_channels.size(); i++) {
+        auto& channel = m_channels[i];
+        const float frequency = frequencies_norm[i];
+        if ((i < total_existing) && (channel.frequency_norm == frequency)) continue;
+        channel.frequency_norm = frequency;
+        const long bin = long(std::lround(frequency*float(M)));
+        channel.bin = size_t(((bin % M) + M) % M);
+        // mix the channel back down to baseband at the decimated rate
+        // this also removes the offset between the channel and the centre of its bin
+        const float step = -2.0f*PI*frequency*float(m_decimation_factor);
+        channel.phasor = 1.0f;
+        channel.phasor_step = std::complex<float>(std::cos(step), std::sin(step));
+    }
+}
+
+void Wideband_Channelizer::compute_bins(const std::complex<float>* window) {
+    const size_t M = m_total_bins;
+    const size_t T = m_total_taps;
+    volk_32fc_32f_multiply_32fc(
+        reinterpret_cast<lv_32fc_t*>(m_product.data()), reinterpret_cast<const lv_32fc_t*>(window),
+        m_taps.data(), (unsigned int)T);
+    // sum the polyphase branches, taps are a multiple of the bins so each branch is M apart
+    auto* sum = reinterpret_cast<float*>(m_product.data());
+    for (size_t offset = M; offset < T; offset += M) {
+        const auto* branch = reinterpret_cast<const float*>(m_product.data() + offset);
+        volk_32f_x2_add_32f(sum, sum, branch, (unsigned int)(2*M));
+    }
+    // NOTE: The product is in reverse order so branch r is at (M-1-r)
+    for (size_t r = 0; r < M; r++) {
+        m_bins[m_bit_reverse[r]] = m_product[M-1-r];
+    }
+    // in place radix-2 inverse fft without scaling, bin k is the bandpass filter at k/M
+    for (size_t length = 2; length <= M; length <<= 1) {
+        const size_t stride = M/length;
+        for (size_t i = 0; i < M; i += length) {
+            for (size_t j = 0; j < length/2; j++) {
+                const auto u = m_bins[i+j];
+                const auto v = m_bins[i+j+length/2] * m_twiddles[j*stride];
+                m_bins[i+j] = u + v;
+                m_bins[i+j+length/2] = u - v;
+            }
+        }
+    }
+}
+
+void Wideband_Channelizer::filter(tcb::span<const std::complex<float>> input) {
+    const size_t T = m_total_taps;
+    const size_t D = m_decimation_factor;
+    for (auto& channel: m_channels) {
+        channel.output.clear();
+    }
+    while (!input.empty()) {
+        const size_t N = std::min(input.size(), MAX_INPUT_BLOCK_SIZE);
+        std::copy_n(input.begin(), N, m_history.begin() + (T-1));
+        const size_t end = (T-1) + N;
+        for (; m_next_output_index < end; m_next_output_index += D) {
+            compute_bins(&m_history[m_next_output_index-(T-1)]);
+            for (auto& channel: m_channels) {
+                channel.output.push_back(m_bins[channel.bin] * channel.phasor);
+                channel.phasor *= channel.phasor_step;
+            }
+        }
+        // keep the last (T-1) samples as history
+        std::copy(m_history.begin() + N, m_history.begin() + end, m_history.begin());
+        m_next_output_index -= N;
+        input = input.subspan(N);
+    }
+    // prevent magnitude of phasor from drifting due to rounding errors
+    for (auto& channel: m_channels) {
+        channel.phasor = channel.phasor / std::abs(channel.phasor);
+    }
+}
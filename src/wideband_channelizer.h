@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <complex>
+#include <mutex>
+#include <vector>
+#include "utility/span.h"
+
+// Splits a wideband iq stream into multiple narrowband streams
+// This is an oversampled polyphase fft channelizer so the filtering is shared by every channel
+// - The lowpass prototype is split into M polyphase branches and one M point fft per output sample
+//   gives the decimated output of M bandpass filters spaced fs/M apart
+// - Each channel reads the bin closest to its centre frequency and the prototype is widened by half
+//   a bin so the channel still fits in the passband when it is between two bins
+// - The output is mixed back down to baseband at the decimated rate which also removes the offset from the bin
+// - Per output sample the cost is one real prototype fir and one fft for all channels plus a mixer per channel
+class Wideband_Channelizer
+{
+private:
+    struct Channel {
+        float frequency_norm = 0.0f;
+        size_t bin = 0;
+        std::complex<float> phasor = 1.0f;
+        std::complex<float> phasor_step = 1.0f;
+        std::vector<std::complex<float>> output;
+    };
+    const size_t m_decimation_factor;
+    const size_t m_total_bins;
+    const size_t m_total_taps;
+    // reversed so that the product runs over contiguous samples in the history
+    std::vector<float> m_taps;
+    std::mutex m_mutex_channels;
+    std::vector<Channel> m_channels;
+    // (T-1) samples of history followed by up to a block of new input
+    std::vector<std::complex<float>> m_history;
+    size_t m_next_output_index;
+    // NOTE: Scratch buffers for a single output sample
+    std::vector<std::complex<float>> m_product;
+    std::vector<std::complex<float>> m_bins;
+    std::vector<std::complex<float>> m_twiddles;
+    std::vector<size_t> m_bit_reverse;
+public:
+    // cutoff_norm is the lowpass cutoff relative to the input sample rate
+    Wideband_Channelizer(size_t decimation_factor, size_t taps_per_phase, float cutoff_norm);
+    // frequency offsets are relative to the input sample rate and in the range [-0.5,+0.5]
+    void set_channel_frequencies(tcb::span<const float> frequencies_norm);
+    size_t get_decimation_factor() const { return m_decimation_factor; }
+    size_t get_total_taps() const { return m_total_taps; }
+    size_t get_total_bins() const { return m_total_bins; }
+    // on_output(channel_index, span<const std::complex<float>>)
+    template <typename F>
+    void process(tcb::span<const std::complex<float>> input, F&& on_output) {
+        auto lock = std::unique_lock(m_mutex_channels);
+        filter(input);
+        for (size_t i = 0; i < m_channels.size(); i++) {
+            auto& channel = m_channels[i];
+            on_output(i, tcb::span<const std::complex<float>>(channel.output.data(), channel.output.size()));
+        }
+    }
+private:
+    void filter(tcb::span<const std::complex<float>> input);
+    void compute_bins(const std::complex<float>* window);
+};